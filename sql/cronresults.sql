@@ -30,7 +30,9 @@ CREATE TABLE IF NOT EXISTS cronresults (
     exit_status INT NOT NULL,
 
     -- the output logged by the process to stdout/stderr (if enabled)
-    log text NULL
+    log text NULL,
+    -- like "log", but a zstd frame (setting "compress_log")
+    log_zstd bytea NULL
 );
 
 CREATE INDEX IF NOT EXISTS cronresults_job ON cronresults(cronjob_id);
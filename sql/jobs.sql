@@ -56,6 +56,10 @@ CREATE TABLE IF NOT EXISTS jobs (
     env varchar(4096)[] NULL,
     -- optional data fed into stdin
     stdin bytea NULL,
+    -- optional large object fed into stdin (instead of "stdin");
+    -- Workshop never unlinks it, the client must do that when it
+    -- deletes the job
+    stdin_oid oid NULL,
 
     --------------------------------
     -- Scheduler control (Workshop internal)
@@ -79,8 +83,24 @@ CREATE TABLE IF NOT EXISTS jobs (
     time_done timestamp NULL,
     -- CPU usage in microseconds
     cpu_usage interval NULL,
+    -- peak memory usage in bytes; NULL if the process has run other
+    -- jobs before (reused worker/prefork process, batch)
+    memory_peak bigint NULL,
+    -- number of bytes read from/written to block devices
+    io_read_bytes bigint NULL,
+    io_write_bytes bigint NULL,
+    -- the time this job was stalled waiting for CPU, memory or I/O
+    -- (Linux pressure stall information, "some")
+    cpu_pressure interval NULL,
+    memory_pressure interval NULL,
+    io_pressure interval NULL,
     -- the output logged by the process to stderr
     log text NULL,
+    -- like "log", but a zstd frame (setting "compress_log")
+    log_zstd bytea NULL,
+    -- the path of the file containing the complete stderr output
+    -- (only if "log_spool" is configured)
+    log_file varchar(4096) NULL,
     -- the process' exit code
     exit_status int NULL
 );
@@ -89,6 +109,10 @@ CREATE TABLE IF NOT EXISTS jobs (
 CREATE INDEX IF NOT EXISTS jobs_sorted2 ON jobs(priority, time_created)
     WHERE enabled AND node_name IS NULL AND time_done IS NULL AND exit_status IS NULL;
 
+-- this index is used when selecting the next free job of a set of plans
+CREATE INDEX IF NOT EXISTS jobs_plan_sorted ON jobs(plan_name, priority, time_created)
+    WHERE enabled AND node_name IS NULL AND time_done IS NULL AND exit_status IS NULL;
+
 -- find scheduled jobs
 CREATE INDEX IF NOT EXISTS jobs_scheduled2 ON jobs(scheduled_time)
     WHERE enabled AND node_name IS NULL AND time_done IS NULL AND exit_status IS NULL AND scheduled_time IS NOT NULL;
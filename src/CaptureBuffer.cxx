@@ -3,33 +3,148 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "CaptureBuffer.hxx"
-#include "util/AllocatedString.hxx"
-#include "util/CharUtil.hxx"
+
+#include <fmt/core.h>
 
 #include <algorithm>
+#include <iterator> // for std::back_inserter()
+
+/**
+ * The number of tail bytes sacrificed for the truncation marker, so
+ * the text does not exceed the capacity.
+ */
+static constexpr std::size_t MARKER_RESERVE = 48;
 
 static constexpr bool
-IsAllowedNonPrintableChar(char ch) noexcept
+IsUTF8Continuation(char ch) noexcept
 {
-	return ch == '\r' || ch == '\n' || ch == '\t';
+	return (static_cast<unsigned char>(ch) & 0xc0) == 0x80;
 }
 
-static constexpr bool
-IsDisallowedChar(char ch) noexcept
+/**
+ * Remove an incomplete UTF-8 sequence at the end.
+ */
+static std::size_t
+TrimIncompleteUTF8(const char *p, std::size_t size) noexcept
 {
-	return !IsPrintableASCII(ch) && !IsAllowedNonPrintableChar(ch);
+	/* find the last lead byte */
+	std::size_t n = 0;
+	while (n < size && n < 4 && IsUTF8Continuation(p[size - 1 - n]))
+		++n;
+
+	if (n >= size)
+		return size;
+
+	const auto lead = static_cast<unsigned char>(p[size - 1 - n]);
+	std::size_t expected;
+	if (lead < 0x80)
+		return size;
+	else if ((lead & 0xe0) == 0xc0)
+		expected = 1;
+	else if ((lead & 0xf0) == 0xe0)
+		expected = 2;
+	else if ((lead & 0xf8) == 0xf0)
+		expected = 3;
+	else
+		/* not valid UTF-8 anyway */
+		return size;
+
+	return n < expected ? size - 1 - n : size;
 }
 
-AllocatedString
-CaptureBuffer::NormalizeASCII() && noexcept
+CaptureBuffer::CaptureBuffer(std::size_t capacity,
+			     UTF8Sanitizer::Mode mode) noexcept
+	:head_capacity(capacity / 4),
+	 tail_capacity(capacity - head_capacity),
+	 data(new char[capacity]),
+	 sanitizer(mode)
 {
-	if (size == capacity)
-		/* crop the last character to make room for the null
-		   terminator */
-		size = capacity - 1;
-
-	std::replace_if(data.get(), std::next(data.get(), size),
-			IsDisallowedChar, ' ');
-	data[size] = 0;
-	return AllocatedString::Donate(data.release());
+}
+
+void
+CaptureBuffer::Write(std::string_view src) noexcept
+{
+	if (head_size < head_capacity) {
+		const std::size_t n = std::min(src.size(), head_capacity - head_size);
+		std::copy_n(src.begin(), n, data.get() + head_size);
+		head_size += n;
+		src.remove_prefix(n);
+	}
+
+	if (src.empty() || tail_capacity == 0)
+		return;
+
+	char *const tail = GetTail();
+
+	if (src.size() >= tail_capacity) {
+		/* the new data replaces the whole tail */
+		const std::size_t skip = src.size() - tail_capacity;
+		discarded += tail_size + skip;
+		std::copy_n(src.begin() + skip, tail_capacity, tail);
+		tail_start = 0;
+		tail_size = tail_capacity;
+		return;
+	}
+
+	/* copy to the end of the ring buffer (may wrap around) */
+	const std::size_t write_position = (tail_start + tail_size) % tail_capacity;
+	const std::size_t first = std::min(src.size(), tail_capacity - write_position);
+	std::copy_n(src.begin(), first, tail + write_position);
+	std::copy(src.begin() + first, src.end(), tail);
+
+	tail_size += src.size();
+	if (tail_size > tail_capacity) {
+		/* overwrote the oldest data */
+		const std::size_t overflow = tail_size - tail_capacity;
+		discarded += overflow;
+		tail_start = (tail_start + overflow) % tail_capacity;
+		tail_size = tail_capacity;
+	}
+}
+
+std::string
+CaptureBuffer::GetText() const noexcept
+{
+	std::string result;
+
+	if (!IsTruncated()) {
+		result.reserve(head_size + tail_size);
+		result.append(data.get(), head_size);
+	} else {
+		/* don't split a UTF-8 sequence at the truncation
+		   point */
+		const std::size_t size = TrimIncompleteUTF8(data.get(), head_size);
+		result.reserve(head_capacity + tail_capacity);
+		result.append(data.get(), size);
+	}
+
+	/* linearize the ring buffer */
+	const char *const tail = GetTail();
+	std::string tail_text;
+	tail_text.reserve(tail_size);
+	const std::size_t first = std::min(tail_size, tail_capacity - tail_start);
+	tail_text.append(tail + tail_start, first);
+	tail_text.append(tail, tail_size - first);
+
+	if (IsTruncated()) {
+		/* make room for the marker, and don't start the tail
+		   in the middle of a UTF-8 sequence */
+		std::size_t skip = std::min(tail_text.size(), MARKER_RESERVE);
+		while (skip < tail_text.size() && IsUTF8Continuation(tail_text[skip]))
+			++skip;
+
+		tail_text.erase(0, skip);
+
+		fmt::format_to(std::back_inserter(result),
+			       "\n[... {} bytes omitted ...]\n",
+			       discarded + skip);
+	}
+
+	result.append(tail_text);
+
+	if (sanitizer.HasPending())
+		/* the stream ended with an incomplete sequence */
+		result.append(sanitizer.GetReplacement());
+
+	return result;
 }
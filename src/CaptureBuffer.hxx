@@ -4,48 +4,105 @@
 
 #pragma once
 
+#include "UTF8Sanitizer.hxx"
+
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <span>
-
-class AllocatedString;
+#include <string>
+#include <string_view>
 
 /**
- * A buffer which helps capture up to 8 kB of data.
+ * A fixed-size buffer which captures the beginning and the end of a
+ * data stream (e.g. the output of a child process).  The first
+ * quarter of the capacity keeps the head; the rest is a ring buffer
+ * which keeps the tail.  Data in between is discarded and replaced
+ * with a marker line when the text is retrieved.
+ *
+ * Incoming data is sanitized (see #UTF8Sanitizer) before it is
+ * stored, so the text is always valid UTF-8 (or ASCII).
+ *
+ * After construction, this class never allocates memory until the
+ * text is retrieved.
  */
 class CaptureBuffer final {
-	const size_t capacity;
+	const std::size_t head_capacity, tail_capacity;
+
+	/**
+	 * The head (#head_capacity bytes) followed by the tail ring
+	 * buffer (#tail_capacity bytes).
+	 */
+	const std::unique_ptr<char[]> data;
+
+	std::size_t head_size = 0;
 
-	size_t size = 0;
+	/**
+	 * The start position and size of the data in the tail ring
+	 * buffer.
+	 */
+	std::size_t tail_start = 0, tail_size = 0;
+
+	/**
+	 * The number of bytes which were dropped from the tail ring
+	 * buffer.
+	 */
+	uint_least64_t discarded = 0;
 
-	std::unique_ptr<char[]> data;
+	UTF8Sanitizer sanitizer;
 
 public:
-	explicit CaptureBuffer(size_t _capacity) noexcept
-		:capacity(_capacity),
-		 data(new char[capacity]) {}
+	/**
+	 * @param capacity the maximum size of the text (including
+	 * the truncation marker)
+	 */
+	explicit CaptureBuffer(std::size_t capacity,
+			       UTF8Sanitizer::Mode mode=UTF8Sanitizer::Mode::UTF8) noexcept;
+
+	CaptureBuffer(const CaptureBuffer &) = delete;
+	CaptureBuffer &operator=(const CaptureBuffer &) = delete;
 
-	bool IsFull() const noexcept {
-		return size == capacity;
+	bool IsEmpty() const noexcept {
+		return head_size == 0;
 	}
 
-	std::span<char> Write() noexcept {
-		return { &data[size], capacity - size };
+	/**
+	 * Has data been discarded?
+	 */
+	bool IsTruncated() const noexcept {
+		return discarded > 0;
 	}
 
-	void Append(size_t n) noexcept {
-		size += n;
+	void Clear() noexcept {
+		head_size = tail_start = tail_size = 0;
+		discarded = 0;
+		sanitizer.Reset();
 	}
 
-	std::span<char> GetData() noexcept {
-		return {data.get(), size};
+	/**
+	 * Sanitize and append data.  An incomplete UTF-8 sequence at
+	 * the end is held back until the next call.
+	 */
+	void Append(std::span<const char> src) noexcept {
+		sanitizer.Feed({src.data(), src.size()},
+			       [this](std::string_view s){ Write(s); });
 	}
 
 	/**
-	 * Convert all non-printable and non-ASCII characters except for
-	 * CR/LF and tab to a space and null-terminate the string.  This
-	 * modifies this object's buffer.
-	 *
-	 * @return the null-terminated ASCII string
+	 * Return the captured text: the head, a truncation marker (if
+	 * data has been discarded) and the tail.  Incomplete UTF-8
+	 * sequences at the truncation points are removed, and one
+	 * which was held back at the end is replaced.
 	 */
-	AllocatedString NormalizeASCII() && noexcept;
+	std::string GetText() const noexcept;
+
+private:
+	/**
+	 * Append sanitized data.
+	 */
+	void Write(std::string_view src) noexcept;
+
+	char *GetTail() const noexcept {
+		return data.get() + head_capacity;
+	}
 };
@@ -3,10 +3,14 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "CgroupAccounting.hxx"
+#include "io/FileAt.hxx"
 #include "io/SmallTextFile.hxx"
+#include "io/UniqueFileDescriptor.hxx"
 #include "util/NumberParser.hxx"
 #include "util/StringCompare.hxx"
 
+#include <concepts> // for std::invocable
+
 using std::string_view_literals::operator""sv;
 
 std::chrono::microseconds
@@ -24,3 +28,73 @@ ReadCgroupCpuUsage(FileDescriptor fd)
 
 	return std::chrono::microseconds::min();
 }
+
+/**
+ * Invoke a function for each line of a file in the cgroup
+ * directory.  Errors are ignored, because all counters are
+ * optional.
+ */
+static bool
+ForEachCgroupLine(FileDescriptor cgroup_fd, const char *name,
+		  std::invocable<std::string_view> auto f) noexcept
+{
+	UniqueFileDescriptor fd;
+	if (!fd.OpenReadOnly({cgroup_fd, name}))
+		return false;
+
+	try {
+		for (std::string_view line : IterableSmallTextFile<4096>(fd))
+			f(line);
+	} catch (...) {
+		return false;
+	}
+
+	return true;
+}
+
+static std::optional<uint_least64_t>
+ReadCgroupNumber(FileDescriptor cgroup_fd, const char *name) noexcept
+{
+	std::optional<uint_least64_t> result;
+	ForEachCgroupLine(cgroup_fd, name, [&result](std::string_view line){
+		result = ParseInteger<uint_least64_t>(line);
+	});
+	return result;
+}
+
+std::optional<std::chrono::microseconds>
+ReadPressureTotal(FileDescriptor directory_fd, const char *name) noexcept
+{
+	std::optional<std::chrono::microseconds> result;
+	ForEachCgroupLine(directory_fd, name, [&result](std::string_view line){
+		if (const auto total = ParsePressureTotal(line))
+			result = total;
+	});
+	return result;
+}
+
+CgroupResourceUsage
+ReadCgroupResourceUsage(FileDescriptor cgroup_fd) noexcept
+{
+	CgroupResourceUsage result;
+
+	result.memory_peak = ReadCgroupNumber(cgroup_fd, "memory.peak");
+	if (!result.memory_peak)
+		result.memory_peak = ReadCgroupNumber(cgroup_fd, "memory.current");
+
+	if (ForEachCgroupLine(cgroup_fd, "io.stat", [&result](std::string_view line){
+		result.AddIoStatLine(line);
+	})) {
+		/* devices without I/O are not listed */
+		if (!result.io_read_bytes)
+			result.io_read_bytes = 0;
+		if (!result.io_write_bytes)
+			result.io_write_bytes = 0;
+	}
+
+	result.cpu_pressure = ReadPressureTotal(cgroup_fd, "cpu.pressure");
+	result.memory_pressure = ReadPressureTotal(cgroup_fd, "memory.pressure");
+	result.io_pressure = ReadPressureTotal(cgroup_fd, "io.pressure");
+
+	return result;
+}
@@ -4,9 +4,28 @@
 
 #pragma once
 
+#include "CgroupResourceUsage.hxx"
+
 #include <chrono>
+#include <optional>
 
 class FileDescriptor;
 
 std::chrono::microseconds
 ReadCgroupCpuUsage(FileDescriptor fd);
+
+/**
+ * Parse the "total" value of the "some" line of a PSI file
+ * (e.g. "cpu.pressure" in a cgroup2 directory or "cpu" in
+ * /proc/pressure).
+ *
+ * @return the total stall time or std::nullopt on error
+ */
+std::optional<std::chrono::microseconds>
+ReadPressureTotal(FileDescriptor directory_fd, const char *name) noexcept;
+
+/**
+ * Read the resource usage counters of the given cgroup2 directory.
+ */
+CgroupResourceUsage
+ReadCgroupResourceUsage(FileDescriptor cgroup_fd) noexcept;
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "CgroupResourceUsage.hxx"
+#include "util/IterableSplitString.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringCompare.hxx"
+
+#include <algorithm> // for std::max()
+
+using std::string_view_literals::operator""sv;
+
+void
+CgroupResourceUsage::Update(const CgroupResourceUsage &newer) noexcept
+{
+	if (newer.memory_peak)
+		memory_peak = std::max(memory_peak.value_or(0), *newer.memory_peak);
+
+	if (newer.io_read_bytes)
+		io_read_bytes = newer.io_read_bytes;
+	if (newer.io_write_bytes)
+		io_write_bytes = newer.io_write_bytes;
+
+	if (newer.cpu_pressure)
+		cpu_pressure = newer.cpu_pressure;
+	if (newer.memory_pressure)
+		memory_pressure = newer.memory_pressure;
+	if (newer.io_pressure)
+		io_pressure = newer.io_pressure;
+}
+
+template<typename T>
+static constexpr std::optional<T>
+Difference(const std::optional<T> &end, const std::optional<T> &start) noexcept
+{
+	if (!end)
+		return std::nullopt;
+
+	/* counters may have been reset (e.g. a new cgroup) */
+	if (!start || *start > *end)
+		return end;
+
+	return *end - *start;
+}
+
+CgroupResourceUsage
+CgroupResourceUsage::Since(const CgroupResourceUsage &start) const noexcept
+{
+	return {
+		.memory_peak = memory_peak,
+		.io_read_bytes = Difference(io_read_bytes, start.io_read_bytes),
+		.io_write_bytes = Difference(io_write_bytes, start.io_write_bytes),
+		.cpu_pressure = Difference(cpu_pressure, start.cpu_pressure),
+		.memory_pressure = Difference(memory_pressure, start.memory_pressure),
+		.io_pressure = Difference(io_pressure, start.io_pressure),
+	};
+}
+
+void
+CgroupResourceUsage::AddIoStatLine(std::string_view line) noexcept
+{
+	/* example: "8:0 rbytes=1459200 wbytes=314773504 rios=192
+	   wios=353 dbytes=0 dios=0" */
+	for (std::string_view i : IterableSplitString(line, ' ')) {
+		if (SkipPrefix(i, "rbytes="sv)) {
+			if (const auto n = ParseInteger<uint_least64_t>(i))
+				io_read_bytes = io_read_bytes.value_or(0) + *n;
+		} else if (SkipPrefix(i, "wbytes="sv)) {
+			if (const auto n = ParseInteger<uint_least64_t>(i))
+				io_write_bytes = io_write_bytes.value_or(0) + *n;
+		}
+	}
+}
+
+std::optional<std::chrono::microseconds>
+ParsePressureTotal(std::string_view line) noexcept
+{
+	if (!SkipPrefix(line, "some "sv))
+		return std::nullopt;
+
+	for (std::string_view i : IterableSplitString(line, ' '))
+		if (SkipPrefix(i, "total="sv))
+			if (const auto usec = ParseInteger<uint_least64_t>(i))
+				return std::chrono::microseconds(*usec);
+
+	return std::nullopt;
+}
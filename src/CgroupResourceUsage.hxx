@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/**
+ * Resource usage counters of a cgroup2.  Each field is empty if the
+ * value is not available (e.g. because the controller is not
+ * enabled in this cgroup).
+ */
+struct CgroupResourceUsage {
+	/**
+	 * The peak memory usage in bytes ("memory.peak", or the
+	 * largest "memory.current" sample on kernels without
+	 * "memory.peak").
+	 */
+	std::optional<uint_least64_t> memory_peak;
+
+	/**
+	 * The number of bytes read/written ("io.stat", summed over
+	 * all devices).
+	 */
+	std::optional<uint_least64_t> io_read_bytes, io_write_bytes;
+
+	/**
+	 * The total "some" stall time from "cpu.pressure",
+	 * "memory.pressure" and "io.pressure".
+	 */
+	std::optional<std::chrono::microseconds> cpu_pressure,
+		memory_pressure, io_pressure;
+
+	/**
+	 * Merge a newer sample into this object: cumulative counters
+	 * are replaced and the peak keeps the maximum.  Values missing
+	 * in the newer sample are kept.
+	 */
+	void Update(const CgroupResourceUsage &newer) noexcept;
+
+	/**
+	 * Calculate the usage since the given (older) sample.
+	 */
+	[[gnu::pure]]
+	CgroupResourceUsage Since(const CgroupResourceUsage &start) const noexcept;
+
+	/**
+	 * Parse one line of "io.stat" and add its "rbytes" and
+	 * "wbytes" values to #io_read_bytes and #io_write_bytes.
+	 */
+	void AddIoStatLine(std::string_view line) noexcept;
+};
+
+/**
+ * Parse the "total" value of a PSI line, but only if it is the
+ * "some" line (e.g. "some avg10=0.00 avg60=0.00 avg300=0.00
+ * total=1234").
+ *
+ * @return the total stall time or std::nullopt if this is not a
+ * (valid) "some" line
+ */
+[[gnu::pure]]
+std::optional<std::chrono::microseconds>
+ParsePressureTotal(std::string_view line) noexcept;
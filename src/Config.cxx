@@ -137,6 +137,25 @@ private:
 	void CreateControl(FileLineParser &line);
 };
 
+static AllocatedSocketAddress
+ResolveStreamConnect(const char *host, int default_port)
+{
+	if (*host == '/' || *host == '@') {
+		AllocatedSocketAddress result;
+		result.SetLocal(host);
+		return result;
+	} else {
+		static constexpr struct addrinfo hints{
+			.ai_flags = AI_ADDRCONFIG,
+			.ai_family = AF_UNSPEC,
+			.ai_socktype = SOCK_STREAM,
+		};
+
+		return AllocatedSocketAddress(Resolve(host, default_port,
+						      &hints).GetBest());
+	}
+}
+
 void
 WorkshopConfigParser::Partition::ParseLine(FileLineParser &line)
 {
@@ -147,14 +166,35 @@ WorkshopConfigParser::Partition::ParseLine(FileLineParser &line)
 	} else if (StringIsEqual(word, "database_schema")) {
 		config.database.schema = line.ExpectValueAndEnd();
 	} else if (StringIsEqual(word, "translation_server")) {
-		config.translation_socket.SetLocal(line.ExpectValueAndEnd());
+		config.translation_sockets.emplace_back().SetLocal(line.ExpectValueAndEnd());
+	} else if (StringIsEqual(word, "translation_connections")) {
+		config.translation_connections = line.NextPositiveInteger();
+		line.ExpectEnd();
 	} else if (StringIsEqual(word, "tag")) {
 		config.tag = line.ExpectValueAndEnd();
+	} else if (StringIsEqual(word, "translation_cache_size")) {
+		/* 0 disables the cache */
+		config.translation_cache_size = ParseSize(line.ExpectValueAndEnd());
 	} else if (StringIsEqual(word, "max_log")) {
 		config.max_log = ParseSize(line.ExpectValueAndEnd());
+	} else if (StringIsEqual(word, "log_spool")) {
+		config.log_spool = line.ExpectValueAndEnd();
+	} else if (StringIsEqual(word, "pond_server")) {
+		config.pond_server = ResolveStreamConnect(line.ExpectValueAndEnd(),
+							  Net::Log::DEFAULT_PORT);
 	} else if (StringIsEqual(word, "journal")) {
 		config.enable_journal = line.NextBool();
 		line.ExpectEnd();
+	} else if (StringIsEqual(word, "journal_rate")) {
+		config.journal_rate = line.NextPositiveInteger();
+		line.ExpectEnd();
+	} else if (StringIsEqual(word, "compress_log")) {
+		config.compress_log = line.NextBool();
+		line.ExpectEnd();
+#ifndef HAVE_ZSTD
+		if (config.compress_log)
+			throw LineParser::Error{"zstd support is disabled at compile time"};
+#endif
 #ifdef HAVE_AVAHI
 	} else if (StringIsEqual(word, "sticky")) {
 		config.sticky = line.NextBool();
@@ -178,25 +218,6 @@ WorkshopConfigParser::Partition::Finish()
 	ConfigParser::Finish();
 }
 
-static AllocatedSocketAddress
-ResolveStreamConnect(const char *host, int default_port)
-{
-	if (*host == '/' || *host == '@') {
-		AllocatedSocketAddress result;
-		result.SetLocal(host);
-		return result;
-	} else {
-		static constexpr struct addrinfo hints{
-			.ai_flags = AI_ADDRCONFIG,
-			.ai_family = AF_UNSPEC,
-			.ai_socktype = SOCK_STREAM,
-		};
-
-		return AllocatedSocketAddress(Resolve(host, default_port,
-						      &hints).GetBest());
-	}
-}
-
 void
 WorkshopConfigParser::CronPartition::ParseLine(FileLineParser &line)
 {
@@ -207,7 +228,10 @@ WorkshopConfigParser::CronPartition::ParseLine(FileLineParser &line)
 	} else if (StringIsEqual(word, "database_schema")) {
 		config.database.schema = line.ExpectValueAndEnd();
 	} else if (StringIsEqual(word, "translation_server")) {
-		config.translation_socket.SetLocal(line.ExpectValueAndEnd());
+		config.translation_sockets.emplace_back().SetLocal(line.ExpectValueAndEnd());
+	} else if (StringIsEqual(word, "translation_connections")) {
+		config.translation_connections = line.NextPositiveInteger();
+		line.ExpectEnd();
 	} else if (StringIsEqual(word, "qmqp_server")) {
 		config.qmqp_server = ResolveStreamConnect(line.ExpectValueAndEnd(),
 							  628);
@@ -229,6 +253,13 @@ WorkshopConfigParser::CronPartition::ParseLine(FileLineParser &line)
 	} else if (StringIsEqual(word, "use_qrelay")) {
 		config.use_qrelay = line.NextBool();
 		line.ExpectEnd();
+	} else if (StringIsEqual(word, "compress_log")) {
+		config.compress_log = line.NextBool();
+		line.ExpectEnd();
+#ifndef HAVE_ZSTD
+		if (config.compress_log)
+			throw LineParser::Error{"zstd support is disabled at compile time"};
+#endif
 #ifdef HAVE_AVAHI
 	} else if (StringIsEqual(word, "sticky")) {
 		config.sticky = line.NextBool();
@@ -316,6 +347,9 @@ WorkshopConfigParser::ParseLine2(FileLineParser &line)
 	} else if (StringIsEqual(word, "concurrency")) {
 		config.concurrency = ParsePositiveLong(line.ExpectValueAndEnd(),
 						       256);
+	} else if (StringIsEqual(word, "pressure_limit")) {
+		config.pressure_limit = ParsePositiveLong(line.ExpectValueAndEnd(),
+							  100);
 	} else if (StringIsEqual(word, "spawn")) {
 		line.ExpectSymbolAndEol('{');
 		SetChild(std::make_unique<SpawnConfigParser>(config.spawn));
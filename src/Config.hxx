@@ -17,6 +17,13 @@ struct Config {
 	std::string node_name;
 	unsigned concurrency = 2;
 
+	/**
+	 * If non-zero, then the number of concurrent jobs is lowered
+	 * while the pressure stall time exceeds this percentage (see
+	 * #PressureController).
+	 */
+	unsigned pressure_limit = 0;
+
 	SpawnConfig spawn;
 
 	std::forward_list<WorkshopPartitionConfig> partitions;
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "EventFD.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "system/Error.hxx"
+
+#include <sys/eventfd.h>
+
+UniqueFileDescriptor
+CreateEventFD()
+{
+	int fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	if (fd < 0)
+		throw MakeErrno("eventfd() failed");
+
+	return UniqueFileDescriptor{AdoptTag{}, fd};
+}
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+class UniqueFileDescriptor;
+
+/**
+ * Create a non-blocking eventfd which a worker thread can use to
+ * wake up the #EventLoop.
+ *
+ * Throws on error.
+ */
+UniqueFileDescriptor
+CreateEventFD();
@@ -30,3 +30,52 @@ Expand(std::string &p, const StringMap &vars) noexcept
 
 	p.append(src.begin() + start, src.end());
 }
+
+ExpandTemplate::ExpandTemplate(std::string_view src,
+			       std::span<const std::string_view> names) noexcept
+{
+	std::string_view::size_type start = 0, pos;
+	while ((pos = src.find("${"sv, start)) != src.npos) {
+		std::string_view::size_type end = src.find('}', pos + 2);
+		if (end == src.npos)
+			break;
+
+		const std::string_view key = src.substr(pos + 2, end - pos - 2);
+
+		int variable = -1;
+		for (std::size_t i = 0; i < names.size(); ++i) {
+			if (names[i] == key) {
+				variable = static_cast<int>(i);
+				break;
+			}
+		}
+
+		segments.push_back({std::string{src.substr(start, pos - start)}, variable});
+
+		start = end + 1;
+	}
+
+	segments.push_back({std::string{src.substr(start)}, -1});
+}
+
+std::string
+ExpandTemplate::Expand(std::span<const std::string_view> values) const noexcept
+{
+	std::size_t length = 0;
+	for (const auto &i : segments) {
+		length += i.literal.size();
+		if (i.variable >= 0)
+			length += values[i.variable].size();
+	}
+
+	std::string result;
+	result.reserve(length);
+
+	for (const auto &i : segments) {
+		result.append(i.literal);
+		if (i.variable >= 0)
+			result.append(values[i.variable]);
+	}
+
+	return result;
+}
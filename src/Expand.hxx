@@ -5,9 +5,54 @@
 #pragma once
 
 #include <map>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 using StringMap = std::map<std::string_view, std::string_view, std::less<>>;
 
 void
 Expand(std::string &p, const StringMap &vars) noexcept;
+
+/**
+ * A string with "${NAME}" references which has been parsed in
+ * advance, to be expanded many times with different values.  The
+ * result is the same as with Expand().
+ */
+class ExpandTemplate {
+	struct Segment {
+		/**
+		 * Literal text which precedes the variable.
+		 */
+		std::string literal;
+
+		/**
+		 * An index into the "values" parameter of Expand() or
+		 * -1 if this is the last segment or if the variable
+		 * is unknown (which expands to an empty string).
+		 */
+		int variable;
+	};
+
+	std::vector<Segment> segments;
+
+public:
+	/**
+	 * @param names the names of all variables; their values are
+	 * later passed to Expand() in the same order
+	 */
+	ExpandTemplate(std::string_view src,
+		       std::span<const std::string_view> names) noexcept;
+
+	/**
+	 * Does the source string contain no variable references at
+	 * all?  Then expanding would return the source string.
+	 */
+	bool IsConstant() const noexcept {
+		return segments.size() == 1;
+	}
+
+	[[gnu::pure]]
+	std::string Expand(std::span<const std::string_view> values) const noexcept;
+};
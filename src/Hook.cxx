@@ -30,6 +30,8 @@ WorkshopSpawnHook::Verify(const PreparedChildProcess &p)
 	if (p.hook_info != nullptr && library) {
 		const auto now = std::chrono::steady_clock::now();
 
+		/* apply pending inotify events; this is cheap if
+		   nothing has been modified */
 		library->Update(now, false);
 
 		const char *plan_name = p.hook_info;
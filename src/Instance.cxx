@@ -7,6 +7,7 @@
 #include "event/net/control/Server.hxx"
 #include "workshop/MultiLibrary.hxx"
 #include "workshop/Partition.hxx"
+#include "workshop/PressureController.hxx"
 #include "cron/Partition.hxx"
 #include "spawn/Client.hxx"
 #include "util/SpanCast.hxx"
@@ -17,6 +18,10 @@
 #include "lib/avahi/Publisher.hxx"
 #endif
 
+#ifdef HAVE_URING
+#include <liburing.h>
+#endif
+
 #include <fmt/core.h>
 
 #include <signal.h>
@@ -37,11 +42,23 @@ Instance::Instance(const Config &config,
 					     /* disable "verify", we
 						do it via SpawnHook */
 					     false)),
-	 library(std::move(_library))
+	 library(std::move(_library)),
+	 library_event(event_loop, BIND_THIS_METHOD(OnLibraryReady)),
+	 library_timer(event_loop, BIND_THIS_METHOD(OnLibraryTimer))
 {
 	shutdown_listener.Enable();
 	sighup_event.Enable();
 
+#ifdef HAVE_URING
+	try {
+		/* used by PipeReader to read job output */
+		event_loop.EnableUring(1024,
+				       IORING_SETUP_SINGLE_ISSUER|IORING_SETUP_COOP_TASKRUN);
+	} catch (...) {
+		logger(1, "Failed to initialize io_uring: ", std::current_exception());
+	}
+#endif
+
 #ifdef HAVE_AVAHI
 	Avahi::ErrorHandler &avahi_error_handler = *this;
 	if (config.UsesZeroconf()) {
@@ -61,6 +78,18 @@ Instance::Instance(const Config &config,
 					 config, i,
 					 BIND_THIS_METHOD(OnPartitionIdle));
 
+	if (config.pressure_limit > 0 && !partitions.empty()) {
+		try {
+			pressure = std::make_unique<PressureController>(event_loop,
+									config.pressure_limit,
+									config.concurrency,
+									BIND_THIS_METHOD(OnPressureSlots));
+		} catch (...) {
+			logger(1, "Failed to enable adaptive admission control: ",
+			       std::current_exception());
+		}
+	}
+
 	for (const auto &i : config.cron_partitions)
 		cron_partitions.emplace_front(event_loop, *spawn_service,
 #ifdef HAVE_AVAHI
@@ -87,8 +116,27 @@ Instance::Start()
 	for (auto &i : partitions)
 		i.Start();
 
-	if (library)
+	if (library) {
+		/* load plan files in a worker thread; this is only
+		   done now, after the spawner process has been
+		   launched */
+		library->EnableLoaderThread(event_loop,
+					    BIND_THIS_METHOD(OnLibraryModified));
+
 		UpdateLibraryAndFilter(true);
+
+		/* the inotify file descriptor has been created by the
+		   first MultiLibrary::Update() call (unless that
+		   failed; then only #library_timer applies
+		   modifications) */
+		if (const auto fd = library->GetInotifyFileDescriptor();
+		    fd.IsDefined()) {
+			library_event.Open(fd);
+			library_event.ScheduleRead();
+		}
+
+		library_timer.Schedule(std::chrono::minutes{1});
+	}
 }
 
 void
@@ -123,8 +171,18 @@ Instance::OnExit() noexcept
 	shutdown_listener.Disable();
 	sighup_event.Disable();
 
+	/* don't close the file descriptor, it is owned by
+	   MultiLibrary */
+	library_event.Cancel();
+	library_timer.Cancel();
+
+	if (library)
+		library->StopLoaderThread();
+
 	spawn_service->Shutdown();
 
+	pressure.reset();
+
 	for (auto &i : partitions)
 		i.BeginShutdown();
 
@@ -175,6 +233,34 @@ Instance::OnReload(int) noexcept
 	ReloadState();
 }
 
+void
+Instance::OnLibraryReady(unsigned) noexcept
+{
+	UpdateLibraryAndFilter(false);
+}
+
+void
+Instance::OnLibraryModified() noexcept
+{
+	UpdateFilter(true);
+}
+
+void
+Instance::OnLibraryTimer() noexcept
+{
+	UpdateLibraryAndFilter(false);
+	library_timer.Schedule(std::chrono::minutes{1});
+}
+
+void
+Instance::OnPressureSlots(std::size_t slots) noexcept
+{
+	logger.Fmt(4, "Pressure changed the number of slots to {}"sv, slots);
+
+	for (auto &i : partitions)
+		i.SetSlotLimit(slots);
+}
+
 void
 Instance::OnPartitionIdle() noexcept
 {
@@ -214,6 +300,11 @@ Instance::OnControlPacket(BengControl::Command command,
 		break;
 
 	case Command::TCACHE_INVALIDATE:
+		if (is_privileged)
+			for (auto &i : partitions)
+				i.InvalidateTranslationCache(payload);
+		break;
+
 	case Command::EXPIRE_TCACHE_TAG:
 	case Command::DUMP_POOLS:
 	case Command::ENABLE_NODE:
@@ -229,13 +320,21 @@ Instance::OnControlPacket(BengControl::Command command,
 	case Command::DISCARD_SESSION:
 	case Command::FLUSH_HTTP_CACHE:
 	case Command::DISCONNECT_DATABASE:
-	case Command::DISABLE_URING:
 	case Command::RESET_LIMITER:
 	case Command::REJECT_CLIENT:
 	case Command::TARPIT_CLIENT:
 		// not applicable
 		break;
 
+	case Command::DISABLE_URING:
+#ifdef HAVE_URING
+		if (is_privileged) {
+			logger(2, "Disabling io_uring");
+			event_loop.DisableUring();
+		}
+#endif
+		break;
+
 	case Command::VERBOSE:
 		if (is_privileged) {
 			const auto *log_level = (const uint8_t *)payload.data();
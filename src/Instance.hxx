@@ -9,6 +9,8 @@
 #include "event/ShutdownListener.hxx"
 #include "event/SignalEvent.hxx"
 #include "event/DeferEvent.hxx"
+#include "event/PipeEvent.hxx"
+#include "event/CoarseTimerEvent.hxx"
 #include "lib/curl/Init.hxx"
 #include "io/Logger.hxx"
 #include "io/StateDirectories.hxx"
@@ -32,6 +34,7 @@ namespace Avahi { class Client; class Publisher; }
 namespace BengControl { class Server; }
 class WorkshopPartition;
 class CronPartition;
+class PressureController;
 
 class Instance final
 	: BengControl::Handler
@@ -64,8 +67,25 @@ class Instance final
 
 	std::unique_ptr<MultiLibrary> library;
 
+	/**
+	 * Watches the library's inotify file descriptor.
+	 */
+	PipeEvent library_event;
+
+	/**
+	 * Calls MultiLibrary::Update() periodically to revalidate
+	 * all plans.
+	 */
+	CoarseTimerEvent library_timer;
+
 	std::forward_list<WorkshopPartition> partitions;
 
+	/**
+	 * Adaptive admission control (setting "pressure_limit") for
+	 * all #WorkshopPartition instances; nullptr if disabled.
+	 */
+	std::unique_ptr<PressureController> pressure;
+
 	std::forward_list<CronPartition> cron_partitions;
 
 	std::forward_list<BengControl::Server> control_servers;
@@ -99,6 +119,12 @@ private:
 	void OnExit() noexcept;
 	void OnReload(int) noexcept;
 
+	void OnLibraryReady(unsigned events) noexcept;
+	void OnLibraryModified() noexcept;
+	void OnLibraryTimer() noexcept;
+
+	void OnPressureSlots(std::size_t slots) noexcept;
+
 	void OnPartitionIdle() noexcept;
 	void RemoveIdlePartitions() noexcept;
 
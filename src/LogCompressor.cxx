@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "LogCompressor.hxx"
+#include "EventFD.hxx"
+
+#include <zstd.h>
+
+#include <cassert>
+#include <cstdint>
+
+static std::vector<std::byte>
+Compress(std::string_view src) noexcept
+{
+	std::vector<std::byte> dest;
+
+	try {
+		dest.resize(ZSTD_compressBound(src.size()));
+	} catch (...) {
+		return {};
+	}
+
+	const std::size_t nbytes = ZSTD_compress(dest.data(), dest.size(),
+						 src.data(), src.size(),
+						 ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(nbytes))
+		return {};
+
+	dest.resize(nbytes);
+	return dest;
+}
+
+LogCompressor::LogCompressor(EventLoop &event_loop) noexcept
+	:event(event_loop, BIND_THIS_METHOD(OnEventReady))
+{
+}
+
+void
+LogCompressor::Start()
+{
+	assert(!stopped);
+
+	if (thread.joinable())
+		return;
+
+	if (!event_fd.IsDefined()) {
+		event_fd = CreateEventFD();
+		event.Open(event_fd);
+		event.ScheduleRead();
+	}
+
+	thread = std::thread(&LogCompressor::Run, this);
+}
+
+void
+LogCompressor::Stop() noexcept
+{
+	if (stopped)
+		return;
+
+	stopped = true;
+
+	if (thread.joinable()) {
+		{
+			const std::scoped_lock lock{mutex};
+			quit = true;
+		}
+
+		cond.notify_one();
+		thread.join();
+	}
+
+	/* don't close the file descriptor, it is owned by
+	   #event_fd */
+	event.Cancel();
+
+	/* the worker thread has finished all requests; submit the
+	   last results now, or they would be lost */
+	DeliverResults();
+}
+
+void
+LogCompressor::Submit(std::unique_ptr<Request> request) noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		requests.emplace_back(std::move(request));
+	}
+
+	cond.notify_one();
+}
+
+void
+LogCompressor::Run() noexcept
+{
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		cond.wait(lock, [this]{ return quit || !requests.empty(); });
+		if (requests.empty())
+			/* quit only after all requests have been
+			   handled */
+			break;
+
+		auto request = std::move(requests.front());
+		requests.pop_front();
+
+		lock.unlock();
+
+		request->compressed = Compress(request->text);
+
+		lock.lock();
+		results.emplace_back(std::move(request));
+
+		/* wake up the event loop thread */
+		static constexpr uint64_t one = 1;
+		(void)event_fd.Write(std::as_bytes(std::span{&one, 1}));
+	}
+}
+
+void
+LogCompressor::DeliverResults() noexcept
+{
+	std::vector<std::unique_ptr<Request>> r;
+
+	{
+		const std::scoped_lock lock{mutex};
+		r.swap(results);
+	}
+
+	for (auto &i : r)
+		i->OnCompressed(i->compressed);
+}
+
+void
+LogCompressor::OnEventReady(unsigned) noexcept
+{
+	uint64_t value;
+	(void)event_fd.Read(std::as_writable_bytes(std::span{&value, 1}));
+
+	DeliverResults();
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/PipeEvent.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits> // for std::decay_t
+#include <utility> // for std::forward()
+#include <vector>
+
+/**
+ * Compresses log texts with zstd in a worker thread, because
+ * compressing large logs would block the #EventLoop for too long.
+ * Results are delivered in the #EventLoop thread.  The worker
+ * thread is started on demand.
+ *
+ * Stop() waits for all pending requests and delivers their results,
+ * so the owner can still store them; it should be called by the
+ * owner's destructor while everything used by the callbacks is still
+ * alive.  This means a result is written only some time after
+ * Submit(); if the process crashes in between, it is lost.
+ */
+class LogCompressor {
+	class Request {
+		friend class LogCompressor;
+
+		const std::string text;
+
+		std::vector<std::byte> compressed;
+
+	public:
+		explicit Request(std::string_view _text) noexcept
+			:text(_text) {}
+
+		virtual ~Request() noexcept = default;
+
+	protected:
+		const std::string &GetText() const noexcept {
+			return text;
+		}
+
+		virtual void OnCompressed(std::span<const std::byte> compressed) noexcept = 0;
+	};
+
+	template<typename F>
+	class CallbackRequest final : public Request {
+		F callback;
+
+	public:
+		CallbackRequest(std::string_view _text, F _callback) noexcept
+			:Request(_text), callback(std::move(_callback)) {}
+
+	protected:
+		void OnCompressed(std::span<const std::byte> compressed) noexcept override {
+			callback(GetText().c_str(), compressed);
+		}
+	};
+
+	/**
+	 * An eventfd which is signalled by the worker thread after it
+	 * has added an item to #results.
+	 */
+	UniqueFileDescriptor event_fd;
+
+	PipeEvent event;
+
+	/**
+	 * Protects #requests, #results and #quit.
+	 */
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	std::deque<std::unique_ptr<Request>> requests;
+	std::vector<std::unique_ptr<Request>> results;
+
+	bool quit = false;
+
+	/**
+	 * Has Stop() been called?  Only accessed by the #EventLoop
+	 * thread.
+	 */
+	bool stopped = false;
+
+	std::thread thread;
+
+public:
+	explicit LogCompressor(EventLoop &event_loop) noexcept;
+
+	~LogCompressor() noexcept {
+		Stop();
+	}
+
+	/**
+	 * Compresses all pending requests and delivers the results
+	 * before returning.  After that, Submit() must not be called
+	 * again.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Is the result being delivered by Stop()?  Callbacks
+	 * should then only store the result and not schedule any
+	 * further work, because the owner is being destroyed.
+	 */
+	bool IsStopped() const noexcept {
+		return stopped;
+	}
+
+	/**
+	 * Submit a text to be compressed by the worker thread.
+	 *
+	 * Throws if the worker thread could not be started.
+	 *
+	 * @param callback a function which gets the text (as a
+	 * null-terminated string) and a zstd frame (empty if
+	 * compression has failed; then the text should be stored
+	 * instead); it is invoked in the #EventLoop thread
+	 */
+	template<typename F>
+	void Submit(std::string_view text, F &&callback) {
+		Start();
+		Submit(std::make_unique<CallbackRequest<std::decay_t<F>>>(text, std::forward<F>(callback)));
+	}
+
+private:
+	/**
+	 * Start the worker thread unless it is already running.
+	 *
+	 * Throws on error.
+	 */
+	void Start();
+
+	void Submit(std::unique_ptr<Request> request) noexcept;
+
+	void Run() noexcept;
+
+	void DeliverResults() noexcept;
+
+	void OnEventReady(unsigned) noexcept;
+};
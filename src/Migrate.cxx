@@ -61,6 +61,20 @@ MigrateWorkshopDatabase(Pg::Connection &c, const char *schema)
 
 	// since Workshop 7.7
 	c.Execute("ALTER TABLE jobs ADD COLUMN IF NOT EXISTS sticky_id varchar(256) NULL");
+
+	// since Workshop 7.15
+	c.Execute("CREATE INDEX IF NOT EXISTS jobs_plan_sorted ON jobs(plan_name, priority, time_created)"
+		  " WHERE enabled AND node_name IS NULL AND time_done IS NULL AND exit_status IS NULL");
+	c.Execute("ALTER TABLE jobs ADD COLUMN IF NOT EXISTS stdin_oid oid NULL");
+	c.Execute("ALTER TABLE jobs ADD COLUMN IF NOT EXISTS log_file varchar(4096) NULL");
+	c.Execute("ALTER TABLE jobs ADD COLUMN IF NOT EXISTS log_zstd bytea NULL");
+	c.Execute("ALTER TABLE jobs"
+		  " ADD COLUMN IF NOT EXISTS memory_peak bigint NULL,"
+		  " ADD COLUMN IF NOT EXISTS io_read_bytes bigint NULL,"
+		  " ADD COLUMN IF NOT EXISTS io_write_bytes bigint NULL,"
+		  " ADD COLUMN IF NOT EXISTS cpu_pressure interval NULL,"
+		  " ADD COLUMN IF NOT EXISTS memory_pressure interval NULL,"
+		  " ADD COLUMN IF NOT EXISTS io_pressure interval NULL");
 }
 
 static void
@@ -137,6 +151,9 @@ MigrateCronDatabase(Pg::Connection &c, const char *schema)
 
 	// since Workshop 7.4
 	c.Execute("ALTER TABLE cronjobs ADD COLUMN IF NOT EXISTS sticky_id varchar(256) NULL");
+
+	// since Workshop 7.15
+	c.Execute("ALTER TABLE cronresults ADD COLUMN IF NOT EXISTS log_zstd bytea NULL");
 }
 
 int
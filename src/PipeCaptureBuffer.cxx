@@ -4,40 +4,27 @@
 
 #include "PipeCaptureBuffer.hxx"
 #include "io/UniqueFileDescriptor.hxx"
+#include "util/SpanCast.hxx"
 
 PipeCaptureBuffer::PipeCaptureBuffer(EventLoop &event_loop,
 				     UniqueFileDescriptor _fd,
 				     size_t capacity) noexcept
-	:event(event_loop, BIND_THIS_METHOD(OnSocket), _fd.Release()),
-	 buffer(capacity)
+	:reader(event_loop, std::move(_fd), *this),
+	 buffer(capacity, UTF8Sanitizer::Mode::ASCII)
 {
-	event.ScheduleRead();
 }
 
-void
-PipeCaptureBuffer::OnSocket(unsigned) noexcept
+bool
+PipeCaptureBuffer::OnPipeData(std::span<const std::byte> src) noexcept
 {
-	FileDescriptor fd(event.GetFileDescriptor());
-
-	auto w = buffer.Write();
-	if (!w.empty()) {
-		ssize_t nbytes = fd.Read(std::as_writable_bytes(w));
-		if (nbytes <= 0) {
-			Close();
-			OnEnd();
-			return;
-		}
-
-		buffer.Append(nbytes);
-		OnAppend();
+	const auto chars = ToStringView(src);
+	buffer.Append(chars);
+	OnAppend(chars);
+	return true;
+}
 
-		if (IsFull())
-			OnEnd();
-	} else {
-		/* buffer is full: discard data to keep the pipe from blocking
-		   the other end */
-		std::byte discard[4096];
-		if (fd.Read(discard) <= 0)
-			Close();
-	}
+void
+PipeCaptureBuffer::OnPipeEnd() noexcept
+{
+	OnEnd();
 }
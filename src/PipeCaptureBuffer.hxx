@@ -5,17 +5,19 @@
 #pragma once
 
 #include "CaptureBuffer.hxx"
-#include "event/PipeEvent.hxx"
+#include "PipeReader.hxx"
 #include "util/AllocatedString.hxx"
 
 class UniqueFileDescriptor;
 
 /**
- * Capture up to 8 kB of data from a pipe asynchronously.  This is
- * useful to capture the output of a child process.
+ * Capture the head and the tail of the data from a pipe
+ * asynchronously (see #CaptureBuffer).  This is useful to capture
+ * the output of a child process.  Non-ASCII characters are replaced
+ * with a space.
  */
-class PipeCaptureBuffer {
-	PipeEvent event;
+class PipeCaptureBuffer : PipeReaderHandler {
+	PipeReader reader;
 
 	CaptureBuffer buffer;
 
@@ -23,42 +25,29 @@ public:
 	explicit PipeCaptureBuffer(EventLoop &event_loop,
 				   UniqueFileDescriptor _fd,
 				   size_t capacity) noexcept;
-	virtual ~PipeCaptureBuffer() noexcept {
-		Close();
-	}
+	virtual ~PipeCaptureBuffer() noexcept = default;
 
 	auto &GetEventLoop() const noexcept {
-		return event.GetEventLoop();
-	}
-
-	bool IsFull() const noexcept {
-		return buffer.IsFull();
+		return reader.GetEventLoop();
 	}
 
-	std::span<char> GetData() noexcept {
-		return buffer.GetData();
-	}
-
-	AllocatedString NormalizeASCII() && noexcept {
-		return std::move(buffer).NormalizeASCII();
+	AllocatedString GetText() const noexcept {
+		return AllocatedString{buffer.GetText()};
 	}
 
 protected:
 	/**
 	 * This method is called whenever new data was appended.
 	 */
-	virtual void OnAppend() noexcept {}
+	virtual void OnAppend([[maybe_unused]] std::span<const char> src) noexcept {}
 
 	/**
-	 * This method is called at the end of the pipe, or when the
-	 * buffer has become full.
+	 * This method is called at the end of the pipe.
 	 */
 	virtual void OnEnd() noexcept {}
 
 private:
-	void Close() noexcept {
-		event.Close();
-	}
-
-	void OnSocket(unsigned events) noexcept;
+	/* virtual methods from class PipeReaderHandler */
+	bool OnPipeData(std::span<const std::byte> src) noexcept override;
+	void OnPipeEnd() noexcept override;
 };
@@ -4,11 +4,14 @@
 
 #include "PipePondAdapter.hxx"
 #include "event/Loop.hxx"
-#include "net/log/Send.hxx"
 #include "net/log/Datagram.hxx"
-#include "util/PrintException.hxx"
+#include "io/Logger.hxx"
 
-#include <string.h>
+#include <fmt/core.h>
+
+#include <algorithm> // for std::min()
+
+using std::string_view_literals::operator""sv;
 
 static constexpr bool
 HasNullByte(std::string_view s) noexcept
@@ -27,7 +30,7 @@ PipePondAdapter::OnLine(std::string_view line) noexcept
 		   the logging protocol requires null-terminated
 		   strings, and if a line contains a null byte, it's
 		   likely to be garbage anyway */
-		pond_socket.SetUndefined();
+		pond.Disable();
 		return;
 	}
 
@@ -44,39 +47,72 @@ PipePondAdapter::OnLine(std::string_view line) noexcept
 		d.site = site.c_str();
 
 	try {
-		Net::Log::Send(pond_socket, d);
+		pond.Add(d);
 	} catch (...) {
-		PrintException(std::current_exception());
-		pond_socket.SetUndefined();
+		logger(2, "Failed to send to Pond: ", std::current_exception());
+		pond.Disable();
 	}
 }
 
 void
-PipePondAdapter::SendLines(bool flush) noexcept
+PipePondAdapter::FlushPond() noexcept
 {
-	if (!pond_socket.IsDefined())
-		return;
+	try {
+		pond.Flush();
+	} catch (...) {
+		logger(2, "Failed to send to Pond: ", std::current_exception());
+		pond.Disable();
+	}
+}
 
-	auto r = GetData().subspan(position);
-
-	while (!r.empty()) {
-		char *newline = (char *)memchr(r.data(), '\n', r.size());
-		if (newline != nullptr) {
-			const std::string_view line{(const char *)r.data(), newline};
-			position += line.size() + 1;
-			r = r.subspan(line.size() + 1);
-			OnLine(line);
-
-			/* check the socket again - it may have been closed by
-			   OnLine() if an error occurred */
-			if (!pond_socket.IsDefined())
-				break;
-		} else if (flush) {
-			const std::string_view line{(const char *)r.data(), r.size()};
-			position += r.size();
-			OnLine(line);
-			break;
-		} else
+void
+PipePondAdapter::OnAppend(std::span<const char> src) noexcept
+{
+	/* lines longer than this are truncated by OnLine() anyway */
+	static constexpr std::size_t MAX_LINE = 1024;
+
+	std::string_view r{src.data(), src.size()};
+
+	while (pond.IsDefined() && !r.empty()) {
+		const auto newline = r.find('\n');
+		const auto line = r.substr(0, newline);
+
+		if (!partial_line_truncated) {
+			const std::size_t n = std::min(line.size(),
+						       MAX_LINE - partial_line.size());
+			partial_line.append(line.substr(0, n));
+			partial_line_truncated = n < line.size();
+		}
+
+		if (newline == r.npos)
 			break;
+
+		r = r.substr(newline + 1);
+		OnLine(partial_line);
+		partial_line.clear();
+		partial_line_truncated = false;
+	}
+
+	if (pond.IsDefined())
+		FlushPond();
+}
+
+void
+PipePondAdapter::OnEnd() noexcept
+{
+	if (pond.IsDefined()) {
+		OnLine(partial_line);
+
+		if (const auto n_dropped = pond.TakeDropped(); n_dropped > 0)
+			OnLine(fmt::format("[{} lines dropped]"sv, n_dropped));
+
+		if (pond.IsDefined())
+			FlushPond();
+
+		if (pond.IsDefined())
+			if (const auto n_lost = pond.DiscardQueued(); n_lost > 0)
+				logger(2, "Failed to send ", n_lost, " lines to Pond");
 	}
+
+	partial_line.clear();
 }
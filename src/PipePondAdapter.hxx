@@ -5,42 +5,56 @@
 #pragma once
 
 #include "PipeCaptureBuffer.hxx"
+#include "PondBatch.hxx"
 #include "net/SocketDescriptor.hxx"
 #include "io/UniqueFileDescriptor.hxx"
 
 #include <string>
 #include <string_view>
 
+class LazyDomainLogger;
+
 /**
- * A derivation from #PipeCaptureBuffer which adds Pond logging.
+ * A derivation from #PipeCaptureBuffer which adds Pond logging.  The
+ * lines of each pipe read are sent in one batch (see #PondBatch).
  */
 class PipePondAdapter : public PipeCaptureBuffer {
-	SocketDescriptor pond_socket;
+	const LazyDomainLogger &logger;
+
+	PondBatch pond;
 
 	const std::string site;
 
-	size_t position = 0;
+	/**
+	 * An incomplete line which was received by the previous
+	 * OnAppend() call.  Its size is limited, because long lines
+	 * get truncated by OnLine() anyway.
+	 */
+	std::string partial_line;
+
+	/**
+	 * Has #partial_line been truncated?  Then the rest of the line
+	 * is discarded.
+	 */
+	bool partial_line_truncated = false;
 
 public:
 	template<typename S>
 	explicit PipePondAdapter(EventLoop &event_loop,
 				 UniqueFileDescriptor &&_fd,
 				 size_t capacity,
+				 const LazyDomainLogger &_logger,
 				 SocketDescriptor _pond_socket,
 				 S &&_site)
 		:PipeCaptureBuffer(event_loop, std::move(_fd), capacity),
-		 pond_socket(_pond_socket), site(std::forward<S>(_site)) {}
+		 logger(_logger),
+		 pond(_pond_socket), site(std::forward<S>(_site)) {}
 
 protected:
-	void OnAppend() noexcept override {
-		SendLines(false);
-	}
-
-	void OnEnd() noexcept override {
-		SendLines(true);
-	}
+	void OnAppend(std::span<const char> src) noexcept override;
+	void OnEnd() noexcept override;
 
 private:
 	void OnLine(std::string_view line) noexcept;
-	void SendLines(bool flush) noexcept;
+	void FlushPond() noexcept;
 };
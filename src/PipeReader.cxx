@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PipeReader.hxx"
+#include "event/Loop.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#ifdef HAVE_URING
+#include "io/uring/Operation.hxx"
+#include "io/uring/Queue.hxx"
+
+#include <liburing.h>
+#endif
+
+#include <array>
+#include <cassert>
+#include <utility> // for std::exchange()
+
+#ifdef HAVE_URING
+
+class PipeReader::UringRead final : public Uring::Operation {
+	/**
+	 * The owning #PipeReader; nullptr if it has been closed
+	 * while this operation was pending.
+	 */
+	PipeReader *reader;
+
+	bool pending = false;
+
+	std::array<std::byte, 16384> buffer;
+
+public:
+	explicit UringRead(PipeReader &_reader) noexcept
+		:reader(&_reader) {}
+
+	bool IsPending() const noexcept {
+		return pending;
+	}
+
+	/**
+	 * The #PipeReader is being closed; cancel the pending read
+	 * and free this object as soon as it completes.
+	 */
+	void Detach(Uring::Queue &queue, FileDescriptor fd) noexcept {
+		assert(pending);
+
+		reader = nullptr;
+
+		/* without this, the read would remain pending (and
+		   keep the pipe open) as long as a writer exists;
+		   this must be submitted before the file descriptor
+		   gets closed */
+		if (auto *s = queue.GetSubmitEntry()) {
+			io_uring_prep_cancel_fd(s, fd.Get(), 0);
+			/* no completion callback for the cancel
+			   request itself */
+			io_uring_sqe_set_data(s, nullptr);
+			queue.Submit();
+		}
+	}
+
+	/**
+	 * Throws if the submission queue is full.
+	 */
+	void Start(Uring::Queue &queue, FileDescriptor fd) {
+		assert(!pending);
+
+		auto &s = queue.RequireSubmitEntry();
+		io_uring_prep_read(&s, fd.Get(), buffer.data(), buffer.size(), -1);
+		queue.Push(s, *this);
+		pending = true;
+	}
+
+private:
+	/* virtual methods from class Uring::Operation */
+	void OnUringCompletion(int res) noexcept override {
+		assert(pending);
+		pending = false;
+
+		if (reader == nullptr) {
+			delete this;
+			return;
+		}
+
+		/* this may delete this object, so it must be the last
+		   statement */
+		reader->OnUringCompletion(std::span{buffer}.first(res > 0 ? res : 0),
+					  res);
+	}
+};
+
+#endif // HAVE_URING
+
+PipeReader::PipeReader(EventLoop &event_loop, UniqueFileDescriptor _fd,
+		       PipeReaderHandler &_handler) noexcept
+	:event(event_loop, BIND_THIS_METHOD(OnPipeReady), _fd.Release()),
+	 handler(_handler)
+{
+	ScheduleRead();
+}
+
+void
+PipeReader::Close() noexcept
+{
+#ifdef HAVE_URING
+	if (auto *op = std::exchange(uring_read, nullptr)) {
+		if (op->IsPending())
+			/* the kernel still owns the buffer; the
+			   operation will free itself after the
+			   cancellation has completed */
+			op->Detach(*GetEventLoop().GetUring(),
+				   event.GetFileDescriptor());
+		else
+			delete op;
+	}
+#endif
+
+	event.Close();
+}
+
+void
+PipeReader::ScheduleRead() noexcept
+{
+#ifdef HAVE_URING
+	if (auto *queue = GetEventLoop().GetUring()) {
+		try {
+			if (uring_read == nullptr)
+				uring_read = new UringRead(*this);
+
+			uring_read->Start(*queue, event.GetFileDescriptor());
+			return;
+		} catch (...) {
+			/* the submission queue is full - fall back to
+			   PipeEvent */
+		}
+	}
+
+	/* io_uring is not (or no longer) available */
+	delete std::exchange(uring_read, nullptr);
+#endif
+
+	event.ScheduleRead();
+}
+
+#ifdef HAVE_URING
+
+inline void
+PipeReader::OnUringCompletion(std::span<const std::byte> src, int res) noexcept
+{
+	if (res <= 0) {
+		Close();
+		handler.OnPipeEnd();
+		return;
+	}
+
+	if (!handler.OnPipeData(src))
+		return;
+
+	ScheduleRead();
+}
+
+#endif // HAVE_URING
+
+void
+PipeReader::OnPipeReady(unsigned) noexcept
+{
+	std::array<std::byte, 8192> buffer;
+
+	FileDescriptor fd(event.GetFileDescriptor());
+	const auto nbytes = fd.Read(buffer);
+	if (nbytes <= 0) {
+		Close();
+		handler.OnPipeEnd();
+		return;
+	}
+
+	handler.OnPipeData(std::span{buffer}.first(nbytes));
+}
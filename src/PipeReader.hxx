@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/PipeEvent.hxx"
+#include "config.h"
+
+#include <cstddef>
+#include <span>
+
+class UniqueFileDescriptor;
+
+class PipeReaderHandler {
+public:
+	/**
+	 * New data has been read from the pipe.
+	 *
+	 * @return false if the #PipeReader has been closed or
+	 * destroyed
+	 */
+	virtual bool OnPipeData(std::span<const std::byte> src) noexcept = 0;
+
+	/**
+	 * The pipe has reached end-of-file (or a read error has
+	 * occurred).  The #PipeReader has already been closed.
+	 */
+	virtual void OnPipeEnd() noexcept = 0;
+};
+
+/**
+ * Read data from a pipe asynchronously and pass it to a
+ * #PipeReaderHandler.
+ *
+ * If io_uring is enabled in the #EventLoop, a read operation is kept
+ * pending on the pipe all the time, which saves the epoll
+ * registration and one system call per wakeup.  Otherwise, this
+ * falls back to #PipeEvent.
+ */
+class PipeReader {
+	PipeEvent event;
+
+	PipeReaderHandler &handler;
+
+#ifdef HAVE_URING
+	class UringRead;
+
+	/**
+	 * The pending io_uring read operation.  It is allocated on
+	 * the heap because it may outlive this object: Close()
+	 * submits a cancel request and detaches it, and it frees
+	 * itself after its (canceled) completion.  Data it may have
+	 * read meanwhile is discarded.
+	 */
+	UringRead *uring_read = nullptr;
+#endif
+
+public:
+	PipeReader(EventLoop &event_loop, UniqueFileDescriptor _fd,
+		   PipeReaderHandler &_handler) noexcept;
+
+	~PipeReader() noexcept {
+		Close();
+	}
+
+	PipeReader(const PipeReader &) = delete;
+	PipeReader &operator=(const PipeReader &) = delete;
+
+	auto &GetEventLoop() const noexcept {
+		return event.GetEventLoop();
+	}
+
+	bool IsDefined() const noexcept {
+#ifdef HAVE_URING
+		if (uring_read != nullptr)
+			return true;
+#endif
+
+		return event.IsDefined();
+	}
+
+	void Close() noexcept;
+
+private:
+	void ScheduleRead() noexcept;
+
+#ifdef HAVE_URING
+	void OnUringCompletion(std::span<const std::byte> src, int res) noexcept;
+#endif
+
+	void OnPipeReady(unsigned events) noexcept;
+};
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PondBatch.hxx"
+#include "net/SocketError.hxx"
+#include "net/log/Datagram.hxx"
+#include "net/log/Serializer.hxx"
+
+#include <algorithm> // for std::copy()
+#include <cerrno>
+
+#include <sys/socket.h>
+
+PondBatch::PondBatch(SocketDescriptor _socket) noexcept
+	:socket(_socket),
+	 buffer(new std::byte[BUFFER_SIZE])
+{
+}
+
+PondBatch::~PondBatch() noexcept = default;
+
+void
+PondBatch::Add(const Net::Log::Datagram &d)
+{
+	if (n_queued == MAX_DATAGRAMS || BUFFER_SIZE - fill < MAX_DATAGRAM_SIZE)
+		Flush();
+
+	if (n_queued == MAX_DATAGRAMS || BUFFER_SIZE - fill < MAX_DATAGRAM_SIZE) {
+		/* the socket is still full */
+		++n_dropped;
+		return;
+	}
+
+	std::size_t size;
+	try {
+		size = Net::Log::Serialize({buffer.get() + fill, MAX_DATAGRAM_SIZE}, d);
+	} catch (const Net::Log::BufferTooSmall &) {
+		++n_dropped;
+		return;
+	}
+
+	fill += size;
+	ends[n_queued++] = fill;
+}
+
+void
+PondBatch::Flush()
+{
+	if (n_queued == 0)
+		return;
+
+	std::array<struct iovec, MAX_DATAGRAMS> v;
+	std::array<struct mmsghdr, MAX_DATAGRAMS> m{};
+
+	std::size_t position = 0;
+	for (std::size_t i = 0; i < n_queued; ++i) {
+		v[i] = {
+			.iov_base = buffer.get() + position,
+			.iov_len = ends[i] - position,
+		};
+
+		m[i].msg_hdr.msg_iov = &v[i];
+		m[i].msg_hdr.msg_iovlen = 1;
+
+		position = ends[i];
+	}
+
+	const int n = sendmmsg(socket.Get(), m.data(), n_queued,
+			       MSG_DONTWAIT|MSG_NOSIGNAL);
+	if (n < 0) {
+		if (errno == EAGAIN)
+			/* try again later */
+			return;
+
+		throw MakeSocketError("Failed to send to the Pond server");
+	}
+
+	if (n == 0)
+		return;
+
+	if (static_cast<std::size_t>(n) == n_queued) {
+		fill = n_queued = 0;
+		return;
+	}
+
+	/* move the rest to the front */
+	const std::size_t sent = ends[n - 1];
+	std::copy(buffer.get() + sent, buffer.get() + fill, buffer.get());
+	fill -= sent;
+
+	std::size_t j = 0;
+	for (std::size_t i = n; i < n_queued; ++i)
+		ends[j++] = ends[i] - sent;
+	n_queued = j;
+}
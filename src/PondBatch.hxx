@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "net/SocketDescriptor.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility> // for std::exchange()
+
+namespace Net::Log { struct Datagram; }
+
+/**
+ * Collects Pond datagrams and sends them to a connected datagram
+ * socket with one sendmmsg() call.
+ *
+ * The queue is bounded.  If the socket buffer is full, datagrams
+ * stay in the queue until the next Flush() call.  New datagrams
+ * are dropped (and counted) while the queue is full.
+ */
+class PondBatch final {
+	static constexpr std::size_t BUFFER_SIZE = 32768;
+	static constexpr std::size_t MAX_DATAGRAMS = 64;
+
+	/**
+	 * Flush the queue before adding a datagram if less than this
+	 * much buffer space is left.
+	 */
+	static constexpr std::size_t MAX_DATAGRAM_SIZE = 4096;
+
+	SocketDescriptor socket;
+
+	/**
+	 * The serialized datagrams.
+	 */
+	const std::unique_ptr<std::byte[]> buffer;
+
+	std::size_t fill = 0;
+
+	/**
+	 * The end offset of each queued datagram in #buffer.
+	 */
+	std::array<std::size_t, MAX_DATAGRAMS> ends;
+
+	std::size_t n_queued = 0;
+
+	uint_least64_t n_dropped = 0;
+
+public:
+	explicit PondBatch(SocketDescriptor _socket) noexcept;
+	~PondBatch() noexcept;
+
+	PondBatch(const PondBatch &) = delete;
+	PondBatch &operator=(const PondBatch &) = delete;
+
+	bool IsDefined() const noexcept {
+		return socket.IsDefined();
+	}
+
+	/**
+	 * Stop sending; all queued datagrams are discarded.
+	 */
+	void Disable() noexcept {
+		socket.SetUndefined();
+		DiscardQueued();
+	}
+
+	/**
+	 * Discard all queued datagrams, e.g. at the end of a job if
+	 * the socket is still full after a final Flush().
+	 *
+	 * @return the number of discarded datagrams
+	 */
+	std::size_t DiscardQueued() noexcept {
+		fill = 0;
+		return std::exchange(n_queued, 0);
+	}
+
+	/**
+	 * Return the number of datagrams which have been dropped
+	 * because the queue was full, and reset the counter.
+	 */
+	uint_least64_t TakeDropped() noexcept {
+		return std::exchange(n_dropped, 0);
+	}
+
+	/**
+	 * Add a datagram to the queue.  If the queue is full, this
+	 * attempts to flush it first.
+	 *
+	 * Throws on send error.
+	 */
+	void Add(const Net::Log::Datagram &d);
+
+	/**
+	 * Send as many queued datagrams as the socket accepts without
+	 * blocking.
+	 *
+	 * Throws on send error.
+	 */
+	void Flush();
+};
@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "UTF8Sanitizer.hxx"
+
+#include <algorithm> // for std::copy(), std::max()
+#include <bit> // for std::countr_zero()
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+using std::string_view_literals::operator""sv;
+
+static constexpr bool
+IsCleanASCII(unsigned char ch) noexcept
+{
+	return (ch >= 0x20 && ch < 0x7f) ||
+		ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+#ifdef __AVX2__
+
+/**
+ * @return a bit mask of the bytes which are not clean ASCII
+ */
+static inline uint32_t
+FindDirtyASCII32(const unsigned char *p) noexcept
+{
+	const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+
+	/* bytes >= 0x80 are negative in a signed comparison, so this
+	   checks 0x20..0x7e */
+	const __m256i printable =
+		_mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(0x1f)),
+				 _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), v));
+	const __m256i allowed =
+		_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+						_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+
+	return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(printable,
+									   allowed)));
+}
+
+#endif // __AVX2__
+
+#ifdef __SSE2__
+
+/**
+ * @return a bit mask of the bytes which are not clean ASCII
+ */
+static inline uint32_t
+FindDirtyASCII16(const unsigned char *p) noexcept
+{
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+	const __m128i printable =
+		_mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+			      _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+	const __m128i allowed =
+		_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+					  _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+			     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(printable,
+								     allowed))) & 0xffff;
+}
+
+#endif // __SSE2__
+
+/**
+ * @return the length of the clean ASCII prefix
+ */
+static std::size_t
+FindDirtyASCII(const unsigned char *p, std::size_t size) noexcept
+{
+	std::size_t i = 0;
+
+#ifdef __AVX2__
+	for (; i + 32 <= size; i += 32)
+		if (const auto mask = FindDirtyASCII32(p + i); mask != 0)
+			return i + std::countr_zero(mask);
+#endif
+
+#ifdef __SSE2__
+	for (; i + 16 <= size; i += 16)
+		if (const auto mask = FindDirtyASCII16(p + i); mask != 0)
+			return i + std::countr_zero(mask);
+#endif
+
+	while (i < size && IsCleanASCII(p[i]))
+		++i;
+
+	return i;
+}
+
+/**
+ * Check the multi-byte sequence at the given position (see Unicode
+ * 15, table 3-7).
+ *
+ * @param valid_prefix_r receives the number of bytes which are a
+ * valid prefix of a sequence (0 if the lead byte is invalid)
+ * @return the length of the complete valid sequence or 0 if the
+ * sequence is invalid or incomplete (the latter if #valid_prefix_r
+ * equals the given size)
+ */
+static std::size_t
+CheckSequence(const unsigned char *p, std::size_t size,
+	      std::size_t &valid_prefix_r) noexcept
+{
+	valid_prefix_r = 0;
+
+	const unsigned char lead = p[0];
+	std::size_t length;
+	unsigned char min = 0x80, max = 0xbf;
+
+	if (lead >= 0xc2 && lead <= 0xdf)
+		length = 2;
+	else if (lead >= 0xe0 && lead <= 0xef) {
+		length = 3;
+		if (lead == 0xe0)
+			min = 0xa0; // overlong
+		else if (lead == 0xed)
+			max = 0x9f; // surrogate
+	} else if (lead >= 0xf0 && lead <= 0xf4) {
+		length = 4;
+		if (lead == 0xf0)
+			min = 0x90; // overlong
+		else if (lead == 0xf4)
+			max = 0x8f; // beyond U+10FFFF
+	} else
+		return 0;
+
+	valid_prefix_r = 1;
+
+	for (std::size_t i = 1; i < length; ++i) {
+		if (i >= size)
+			return 0;
+
+		if (p[i] < min || p[i] > max)
+			return 0;
+
+		/* only the second byte has special limits */
+		min = 0x80;
+		max = 0xbf;
+
+		++valid_prefix_r;
+	}
+
+	return length;
+}
+
+std::size_t
+UTF8Sanitizer::FindInvalid(std::string_view src, Mode mode) noexcept
+{
+	const auto *p = reinterpret_cast<const unsigned char *>(src.data());
+	const std::size_t size = src.size();
+
+	std::size_t i = 0;
+	while (true) {
+		i += FindDirtyASCII(p + i, size - i);
+		if (i >= size || mode == Mode::ASCII || p[i] < 0x80)
+			return i;
+
+		std::size_t valid_prefix;
+		const std::size_t length = CheckSequence(p + i, size - i,
+							 valid_prefix);
+		if (length == 0)
+			return i;
+
+		i += length;
+	}
+}
+
+std::string_view
+UTF8Sanitizer::Step(std::string_view &src) noexcept
+{
+	if (n_pending > 0) {
+		/* try to complete the sequence held back from the
+		   previous chunk */
+		while (!src.empty()) {
+			pending[n_pending] = src.front();
+
+			std::size_t valid_prefix;
+			const std::size_t length =
+				CheckSequence(reinterpret_cast<const unsigned char *>(pending),
+					      n_pending + 1, valid_prefix);
+			if (length > 0) {
+				src.remove_prefix(1);
+				n_pending = 0;
+				return {pending, length};
+			}
+
+			if (valid_prefix <= n_pending) {
+				/* the new byte does not fit; it is
+				   not consumed, but checked again
+				   in the next call */
+				n_pending = 0;
+				return GetReplacement();
+			}
+
+			src.remove_prefix(1);
+			++n_pending;
+		}
+
+		return {};
+	}
+
+	if (const std::size_t n = FindInvalid(src, mode); n > 0) {
+		const auto result = src.substr(0, n);
+		src.remove_prefix(n);
+		return result;
+	}
+
+	const auto *p = reinterpret_cast<const unsigned char *>(src.data());
+
+	if (p[0] < 0x80 || mode == Mode::ASCII) {
+		/* a control character (or non-ASCII in ASCII mode) */
+		src.remove_prefix(1);
+		return " "sv;
+	}
+
+	std::size_t valid_prefix;
+	CheckSequence(p, src.size(), valid_prefix);
+
+	if (valid_prefix > 0 && valid_prefix == src.size()) {
+		/* incomplete sequence at the end of this chunk: hold
+		   it back until the next chunk arrives */
+		std::copy(src.begin(), src.end(), pending);
+		n_pending = src.size();
+		src = {};
+		return {};
+	}
+
+	/* replace the maximal invalid subpart with one U+FFFD */
+	src.remove_prefix(std::max<std::size_t>(valid_prefix, 1));
+	return GetReplacement();
+}
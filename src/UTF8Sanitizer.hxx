@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Converts a stream of untrusted data (e.g. the output of a child
+ * process) to valid UTF-8 text in one pass: invalid sequences are
+ * replaced with U+FFFD, and control characters (except for tab, CR
+ * and LF) are replaced with a space.
+ *
+ * The data may be fed in arbitrary chunks; a sequence which is split
+ * between two chunks is held back until it is complete.  Runs of
+ * ASCII characters are checked with SIMD instructions if available.
+ */
+class UTF8Sanitizer final {
+public:
+	enum class Mode : uint_least8_t {
+		UTF8,
+
+		/**
+		 * Replace all non-ASCII bytes with a space.
+		 */
+		ASCII,
+	};
+
+private:
+	/**
+	 * An incomplete sequence at the end of the previous chunk.
+	 */
+	char pending[4];
+	uint_least8_t n_pending = 0;
+
+	const Mode mode;
+
+public:
+	explicit constexpr UTF8Sanitizer(Mode _mode=Mode::UTF8) noexcept
+		:mode(_mode) {}
+
+	/**
+	 * Is an incomplete sequence being held back?
+	 */
+	bool HasPending() const noexcept {
+		return n_pending > 0;
+	}
+
+	void Reset() noexcept {
+		n_pending = 0;
+	}
+
+	/**
+	 * Sanitize a chunk of data and pass the resulting text to
+	 * the given function (which may be called any number of
+	 * times with a std::string_view parameter).
+	 */
+	template<typename F>
+	void Feed(std::string_view src, F &&output) {
+		while (!src.empty())
+			if (const auto s = Step(src); !s.empty())
+				output(s);
+	}
+
+	/**
+	 * Finish the stream: an incomplete sequence which is still
+	 * being held back is replaced with U+FFFD.
+	 */
+	template<typename F>
+	void Finish(F &&output) {
+		if (HasPending()) {
+			n_pending = 0;
+			output(GetReplacement());
+		}
+	}
+
+	/**
+	 * Return the length of the longest prefix of the given
+	 * string which needs no sanitizing.
+	 */
+	[[gnu::pure]]
+	static std::size_t FindInvalid(std::string_view src, Mode mode) noexcept;
+
+	/**
+	 * The text which replaces an invalid sequence.
+	 */
+	std::string_view GetReplacement() const noexcept {
+		using std::string_view_literals::operator""sv;
+		return mode == Mode::ASCII ? " "sv : "\xef\xbf\xbd"sv;
+	}
+
+private:
+	/**
+	 * Consume data from the beginning of the given string.
+	 *
+	 * @return the next piece of sanitized text (may be empty)
+	 */
+	std::string_view Step(std::string_view &src) noexcept;
+};
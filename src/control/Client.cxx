@@ -2,6 +2,7 @@
 // Copyright CM4all GmbH
 // author: Max Kellermann <max.kellermann@ionos.com>
 
+#include "translation/Protocol.hxx"
 #include "system/Error.hxx"
 #include "io/Iovec.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
@@ -17,6 +18,7 @@
 #include <fmt/core.h>
 
 #include <span>
+#include <vector>
 
 #include <sys/socket.h>
 #include <stdlib.h>
@@ -81,6 +83,33 @@ Verbose(const char *server, std::span<const char *const> args)
 		    ReferenceAsBytes(log_level));
 }
 
+static void
+TcacheInvalidate(const char *server, std::span<const char *const> args)
+{
+	/* the payload is a list of PLAN translation packets; without
+	   any, the whole cache is flushed */
+	std::vector<std::byte> payload;
+
+	for (const std::string_view plan : args) {
+		if (plan.size() > 0xffff)
+			throw Usage{"Plan name too long"};
+
+		const TranslationHeader header{
+			static_cast<uint16_t>(plan.size()),
+			TranslationCommand::PLAN,
+		};
+
+		const auto h = ReferenceAsBytes(header);
+		payload.insert(payload.end(), h.begin(), h.end());
+
+		const auto p = AsBytes(plan);
+		payload.insert(payload.end(), p.begin(), p.end());
+	}
+
+	Client client{server};
+	client.Send(Command::TCACHE_INVALIDATE, payload);
+}
+
 static void
 DisableQueue(const char *server, std::span<const char *const> args)
 {
@@ -138,12 +167,16 @@ try {
 		return EXIT_SUCCESS;
 	} else if (StringIsEqual(command, "reload-state")) {
 		SimpleCommand(server, args, Command::RELOAD_STATE);
+	} else if (StringIsEqual(command, "tcache-invalidate")) {
+		TcacheInvalidate(server, args);
 	} else if (StringIsEqual(command, "disable-queue")) {
 		DisableQueue(server, args);
 	} else if (StringIsEqual(command, "enable-queue")) {
 		EnableQueue(server, args);
 	} else if (StringIsEqual(command, "terminate-children")) {
 		TerminateChildren(server, args);
+	} else if (StringIsEqual(command, "disable-uring")) {
+		SimpleCommand(server, args, Command::DISABLE_URING);
 	} else
 		throw Usage{"Unknown command"};
 } catch (const Usage &u) {
@@ -155,9 +188,11 @@ try {
 		   "Commands:\n"
 		   "  verbose LEVEL\n"
 		   "  reload-state\n"
+		   "  tcache-invalidate [PLAN...]\n"
 		   "  disable-queue [NAME]\n"
 		   "  enable-queue [NAME]\n"
 		   "  terminate-children TAG\n"
+		   "  disable-uring\n"
 		   "  nop\n",
 		   argv[0]);
 	return EXIT_FAILURE;
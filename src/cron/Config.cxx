@@ -12,7 +12,7 @@ CronPartitionConfig::Check() const
 	if (database.connect.empty())
 		throw std::runtime_error("Missing 'database' setting");
 
-	if (!translation_socket.IsDefined())
+	if (translation_sockets.empty())
 		throw std::runtime_error("Missing 'translation_server' setting");
 
 	if (!qmqp_server.IsNull() && use_qrelay)
@@ -15,6 +15,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 struct CronPartitionConfig {
 	/**
@@ -34,7 +35,17 @@ struct CronPartitionConfig {
 
 	Pg::Config database;
 
-	LocalSocketAddress translation_socket;
+	/**
+	 * The translation servers; requests are distributed among
+	 * them.
+	 */
+	std::vector<LocalSocketAddress> translation_sockets;
+
+	/**
+	 * The maximum number of connections to the translation
+	 * server.
+	 */
+	std::size_t translation_connections = 16;
 
 	AllocatedSocketAddress qmqp_server;
 
@@ -53,9 +64,12 @@ struct CronPartitionConfig {
 
 	bool use_qrelay = false;
 
-	explicit CronPartitionConfig(std::string &&_name):name(std::move(_name)) {
-		translation_socket.Clear();
-	}
+	/**
+	 * Store logs zstd-compressed (column "log_zstd")?
+	 */
+	bool compress_log = false;
+
+	explicit CronPartitionConfig(std::string &&_name):name(std::move(_name)) {}
 
 	void Check() const;
 
@@ -25,7 +25,6 @@
 #include "util/Exception.hxx"
 #include "util/SpanCast.hxx"
 #include "util/StringCompare.hxx"
-#include "CaptureBuffer.hxx"
 
 #include <array>
 
@@ -48,8 +47,10 @@ SendHttpResponse(SocketDescriptor socket, const HttpStatus &status,
 class MyResponseHandler final : public CurlResponseHandler {
 	std::exception_ptr error;
 
-	std::size_t fill = 0;
-	std::array<std::byte, 8192> buffer;
+	/**
+	 * Keeps the head and the tail of the response body.
+	 */
+	CaptureBuffer capture{8192};
 
 	HttpStatus status{};
 
@@ -62,7 +63,7 @@ public:
 	}
 
 	void Send(SocketDescriptor socket) {
-		SendHttpResponse(socket, status, std::span{buffer}.first(fill));
+		SendHttpResponse(socket, status, AsBytes(capture.GetText()));
 	}
 
 	void OnHeaders(HttpStatus _status, Curl::Headers &&headers) override {
@@ -77,10 +78,7 @@ public:
 		if (!is_text)
 			return;
 
-		auto w = std::span{buffer}.subspan(fill);
-		const std::size_t n = std::min(data.size(), w.size());
-		std::copy_n(data.begin(), n, w.begin());
-		fill += n;
+		capture.Append(ToStringView(data));
 	}
 
 	void OnEnd() override {}
@@ -199,11 +197,11 @@ void
 CronCurlOperator::OnSocketReady(unsigned) noexcept
 {
 	HttpStatus status;
-	CaptureBuffer capture{8192};
+	std::array<char, 8192> body;
 
 	const struct iovec v[] = {
 		MakeIovecT(status),
-		MakeIovec(capture.Write()),
+		MakeIovec(std::span{body}),
 	};
 
 	auto nbytes = socket.GetSocket().Receive(v, 0);
@@ -212,10 +210,11 @@ CronCurlOperator::OnSocketReady(unsigned) noexcept
 		return;
 	}
 
-	capture.Append(static_cast<std::size_t>(nbytes) - sizeof(status));
+	CaptureBuffer capture{body.size(), UTF8Sanitizer::Mode::ASCII};
+	capture.Append(std::span{body}.first(static_cast<std::size_t>(nbytes) - sizeof(status)));
 
 	Finish(CronResult{
-		.log = std::move(capture).NormalizeASCII(),
+		.log = AllocatedString{capture.GetText()},
 		.exit_status = status == HttpStatus{} ? -1 : static_cast<int>(status),
 	});
 }
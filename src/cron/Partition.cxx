@@ -27,8 +27,9 @@ CronPartition::CronPartition(EventLoop &event_loop,
 			     BoundMethod<void() noexcept> _idle_callback)
 	:name(config.name),
 	 tag(config.tag.empty() ? nullptr : config.tag.c_str()),
-	 translation_socket(config.translation_socket),
 	 logger(fmt::format("cron/{}"sv, config.name)),
+	 translation(event_loop, logger, config.translation_sockets,
+		     config.translation_connections),
 #ifdef HAVE_AVAHI
 	 sticky(config.sticky
 		? new StickyManager(*avahi_client, *avahi_publisher, avahi_error_handler,
@@ -47,6 +48,7 @@ CronPartition::CronPartition(EventLoop &event_loop,
 #else
 	       false,
 #endif
+	       config.compress_log,
 	       [this](CronJob &&job){ OnJob(std::move(job)); }),
 	 workplace(_spawn_service,
 		   email_service, config.use_qrelay, config.default_email_sender,
@@ -118,7 +120,7 @@ CronPartition::OnJob(CronJob &&job) noexcept
 		return;
 
 	try {
-		workplace.Start(queue, translation_socket,
+		workplace.Start(queue, translation,
 				name, tag,
 				std::move(job));
 	} catch (...) {
@@ -6,9 +6,9 @@
 
 #include "Queue.hxx"
 #include "Workplace.hxx"
+#include "translation/Balancer.hxx"
 #include "spawn/ExitListener.hxx"
 #include "event/Chrono.hxx"
-#include "net/SocketAddress.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
 #include "io/Logger.hxx"
 #include "util/BindMethod.hxx"
@@ -29,10 +29,10 @@ class CronPartition final : ExitListener {
 	const std::string_view name;
 	const char *const tag;
 
-	const SocketAddress translation_socket;
-
 	const Logger logger;
 
+	TranslationBalancer translation;
+
 #ifdef HAVE_AVAHI
 	const std::unique_ptr<StickyManager> sticky;
 #endif
@@ -12,6 +12,10 @@
 #include "event/Loop.hxx"
 #include "util/StringAPI.hxx"
 
+#ifdef HAVE_ZSTD
+#include "pg/BinaryValue.hxx"
+#endif
+
 #include <chrono>
 
 #include <string.h>
@@ -23,6 +27,7 @@ CronQueue::CronQueue(const Logger &parent_logger,
 		     EventLoop &event_loop, const char *_node_name,
 		     Pg::Config &&_db_config,
 		     bool _sticky,
+		     bool _compress_log,
 		     Callback _callback) noexcept
 	:node_name(_node_name),
 	 logger(parent_logger, "queue"),
@@ -31,11 +36,21 @@ CronQueue::CronQueue(const Logger &parent_logger,
 	 check_notify_event(event_loop, BIND_THIS_METHOD(CheckNotify)),
 	 scheduler_timer(event_loop, BIND_THIS_METHOD(RunScheduler)),
 	 claim_timer(event_loop, BIND_THIS_METHOD(RunClaim)),
-	 sticky(_sticky)
+	 sticky(_sticky), compress_log(_compress_log)
+#ifdef HAVE_ZSTD
+	 , log_compressor(event_loop)
+#endif
 {
 }
 
-CronQueue::~CronQueue() noexcept = default;
+CronQueue::~CronQueue() noexcept
+{
+#ifdef HAVE_ZSTD
+	/* store the pending logs now, while all other members are
+	   still alive */
+	log_compressor.Stop();
+#endif
+}
 
 inline void
 CronQueue::Prepare()
@@ -82,6 +97,18 @@ VALUES($1, $2, $3, $4, $5)
 )SQL",
 		   5);
 
+	if (compress_log) {
+		if (!Pg::ColumnExists(db, schema, "cronresults", "log_zstd"))
+			throw std::runtime_error{"No column 'cronresults.log_zstd'; please migrate the database"};
+
+		/* $5 is a zstd frame */
+		db.Prepare("insert_result_zstd", R"SQL(
+INSERT INTO cronresults(cronjob_id, node_name, start_time, exit_status, log_zstd)
+VALUES($1, $2, $3, $4, $5)
+)SQL",
+			   5);
+	}
+
 	const std::string_view sticky_id_check = have_sticky_id
 		? "(sticky_id IS NULL OR NOT EXISTS (SELECT 1 FROM sticky_non_local WHERE sticky_non_local.sticky_id=cronjobs.sticky_id))"sv
 		: "TRUE"sv;
@@ -332,6 +359,12 @@ void
 CronQueue::InsertResult(const CronJob &job, const char *start_time,
 			const CronResult &result) noexcept
 try {
+#ifdef HAVE_ZSTD
+	if (compress_log && result.log != nullptr && !result.log.empty() &&
+	    CompressLog(job, start_time, result))
+		return;
+#endif
+
 	ScheduleCheckNotify();
 
 	db.ExecutePrepared("insert_result",
@@ -344,6 +377,50 @@ try {
 	db.CheckError(std::current_exception());
 }
 
+#ifdef HAVE_ZSTD
+
+inline bool
+CronQueue::CompressLog(const CronJob &job, const char *start_time,
+		       const CronResult &result) noexcept
+{
+	try {
+		log_compressor.Submit(result.log,
+				      [this, job_id=job.id, start_time=std::string{start_time},
+				       exit_status=result.exit_status](const char *text,
+								       std::span<const std::byte> compressed){
+			OnLogCompressed(job_id.c_str(), start_time.c_str(),
+					exit_status, text, compressed);
+		});
+		return true;
+	} catch (...) {
+		logger(1, "Failed to start the log compressor: ",
+		       std::current_exception());
+		return false;
+	}
+}
+
+void
+CronQueue::OnLogCompressed(const char *job_id, const char *start_time,
+			   int exit_status, const char *log,
+			   std::span<const std::byte> compressed) noexcept
+try {
+	if (!log_compressor.IsStopped())
+		ScheduleCheckNotify();
+
+	if (compressed.empty())
+		db.ExecutePrepared("insert_result",
+				   job_id, node_name.c_str(), start_time,
+				   exit_status, log);
+	else
+		db.ExecutePrepared("insert_result_zstd",
+				   job_id, node_name.c_str(), start_time,
+				   exit_status, Pg::BinaryValue{compressed});
+} catch (...) {
+	db.CheckError(std::current_exception());
+}
+
+#endif // HAVE_ZSTD
+
 bool
 CronQueue::CheckPending()
 {
@@ -8,7 +8,15 @@
 #include "event/FineTimerEvent.hxx"
 #include "pg/AsyncConnection.hxx"
 #include "io/Logger.hxx"
+#include "config.h"
 
+#ifdef HAVE_ZSTD
+#include "LogCompressor.hxx"
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <span>
 #include <string>
 #include <functional>
 
@@ -40,6 +48,21 @@ class CronQueue final : private Pg::AsyncConnectionHandler {
 
 	const bool sticky;
 
+	/**
+	 * Store logs zstd-compressed in the "log_zstd" column
+	 * (setting "compress_log")?
+	 */
+	const bool compress_log;
+
+#ifdef HAVE_ZSTD
+	/**
+	 * Compresses logs if #compress_log is enabled.  It is
+	 * stopped by the destructor, which stores the pending
+	 * results.
+	 */
+	LogCompressor log_compressor;
+#endif
+
 	/**
 	 * Was the queue enabled by #StateDirectories?
 	 */
@@ -62,6 +85,7 @@ public:
 		  EventLoop &event_loop, const char *_node_name,
 		  Pg::Config &&_db_config,
 		  bool _sticky,
+		  bool _compress_log,
 		  Callback _callback) noexcept;
 	~CronQueue() noexcept;
 
@@ -155,6 +179,22 @@ private:
 
 	void Prepare();
 	void ReleaseStale();
+
+#ifdef HAVE_ZSTD
+	/**
+	 * Submit the log to the #LogCompressor; the row will be
+	 * inserted by OnLogCompressed().
+	 *
+	 * @return false if the #LogCompressor is not available
+	 */
+	bool CompressLog(const CronJob &job, const char *start_time,
+			 const CronResult &result) noexcept;
+
+	void OnLogCompressed(const char *job_id, const char *start_time,
+			     int exit_status, const char *log,
+			     std::span<const std::byte> compressed) noexcept;
+#endif
+
 	void Expire();
 
 	void RunScheduler() noexcept;
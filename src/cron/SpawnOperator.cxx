@@ -14,7 +14,6 @@
 #include "io/Pipe.hxx"
 #include "io/UniqueFileDescriptor.hxx"
 #include "co/Task.hxx"
-#include "util/UTF8.hxx"
 #include "AllocatorPtr.hxx"
 
 #include <unistd.h>
@@ -55,6 +54,7 @@ CronSpawnOperator::Spawn(EventLoop &event_loop, SpawnService &spawn_service,
 		output_capture = std::make_unique<PipePondAdapter>(event_loop,
 								   std::move(r),
 								   8192,
+								   logger,
 								   pond_socket,
 								   site);
 	}
@@ -102,14 +102,7 @@ CronSpawnOperator::OnChildProcessExit(int status) noexcept
 		result.exit_status = -ECHILD;
 
 	if (output_capture)
-		result.log = std::move(*output_capture).NormalizeASCII();
-
-	if (result.log != nullptr && !ValidateUTF8(result.log.c_str())) {
-		/* TODO: purge illegal UTF-8 sequences instead of
-		   replacing the log text? */
-		result.log = AllocatedString{"Invalid UTF-8 output"};
-		logger(2, result.log.c_str());
-	}
+		result.log = output_capture->GetText();
 
 	Finish(std::move(result));
 }
@@ -10,7 +10,7 @@
 #include "SpawnOperator.hxx"
 #include "CurlOperator.hxx"
 #include "AllocatorPtr.hxx"
-#include "translation/CronGlue.hxx"
+#include "translation/CronClient.hxx"
 #include "translation/Response.hxx"
 #include "translation/ExecuteOptions.hxx"
 #include "lib/fmt/RuntimeError.hxx"
@@ -77,14 +77,14 @@ public:
 		return StringListContains(tag, '\0', _tag);
 	}
 
-	void Start(SocketAddress translation_socket,
+	void Start(TranslationService &translation_service,
 		   std::string_view partition_name,
 		   const char *listener_tag) noexcept {
 		/* kill after the timeout expires */
 		if (job.timeout.count() > 0)
 			timeout_event.Schedule(job.timeout);
 
-		task = CoStart(translation_socket, partition_name, listener_tag);
+		task = CoStart(translation_service, partition_name, listener_tag);
 		task.Start(BIND_THIS_METHOD(OnCompletion));
 	}
 
@@ -93,11 +93,11 @@ public:
 	}
 
 private:
-	Co::Task<std::unique_ptr<CronOperator>> MakeOperator(SocketAddress translation_socket,
+	Co::Task<std::unique_ptr<CronOperator>> MakeOperator(TranslationService &translation_service,
 							     std::string_view partition_name,
 							     const char *listener_tag);
 
-	Co::InvokeTask CoStart(SocketAddress translation_socket,
+	Co::InvokeTask CoStart(TranslationService &translation_service,
 			       std::string_view partition_name,
 			       const char *listener_tag);
 
@@ -274,7 +274,7 @@ MakeCurlOperator(EventLoop &event_loop, SpawnService &spawn_service,
 }
 
 inline Co::Task<std::unique_ptr<CronOperator>>
-CronWorkplace::Running::MakeOperator(SocketAddress translation_socket,
+CronWorkplace::Running::MakeOperator(TranslationService &translation_service,
 				     std::string_view partition_name,
 				     const char *listener_tag)
 {
@@ -285,8 +285,7 @@ CronWorkplace::Running::MakeOperator(SocketAddress translation_socket,
 	TranslateResponse response;
 	try {
 		response = co_await
-			TranslateCron(GetEventLoop(),
-				      alloc, translation_socket,
+			TranslateCron(translation_service, alloc,
 				      partition_name, listener_tag,
 				      job.account_id.c_str(),
 				      uri,
@@ -341,11 +340,11 @@ CronWorkplace::Running::MakeOperator(SocketAddress translation_socket,
 }
 
 inline Co::InvokeTask
-CronWorkplace::Running::CoStart(SocketAddress translation_socket,
+CronWorkplace::Running::CoStart(TranslationService &translation_service,
 				std::string_view partition_name,
 				const char *listener_tag)
 {
-	auto op = co_await MakeOperator(translation_socket,
+	auto op = co_await MakeOperator(translation_service,
 					partition_name, listener_tag);
 	assert(op);
 
@@ -354,7 +353,7 @@ CronWorkplace::Running::CoStart(SocketAddress translation_socket,
 }
 
 void
-CronWorkplace::Start(CronQueue &queue, SocketAddress translation_socket,
+CronWorkplace::Start(CronQueue &queue, TranslationService &translation_service,
 		     std::string_view partition_name, const char *listener_tag,
 		     CronJob &&job)
 {
@@ -362,7 +361,7 @@ CronWorkplace::Start(CronQueue &queue, SocketAddress translation_socket,
 			      std::move(job), queue.GetNow());
 	running.push_back(*r);
 
-	r->Start(translation_socket,
+	r->Start(translation_service,
 		 partition_name, listener_tag);
 }
 
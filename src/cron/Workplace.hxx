@@ -14,6 +14,7 @@ class SpawnService;
 class EmailService;
 class CronQueue;
 class ExitListener;
+class TranslationService;
 
 class CronWorkplace {
 	SpawnService &spawn_service;
@@ -72,7 +73,7 @@ public:
 	/**
 	 * Throws std::runtime_error on error.
 	 */
-	void Start(CronQueue &queue, SocketAddress translation_socket,
+	void Start(CronQueue &queue, TranslationService &translation_service,
 		   std::string_view partition_name, const char *listener_tag,
 		   CronJob &&job);
 
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Balancer.hxx"
+#include "translation/Response.hxx"
+#include "AllocatorPtr.hxx"
+#include "event/Loop.hxx"
+#include "net/LocalSocketAddress.hxx"
+#include "net/ToString.hxx"
+#include "co/Task.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+using std::string_view_literals::operator""sv;
+
+static constexpr Event::Duration stats_interval = std::chrono::minutes{5};
+
+TranslationBalancer::TranslationBalancer(EventLoop &event_loop,
+					 const Logger &parent_logger,
+					 std::span<const LocalSocketAddress> addresses,
+					 std::size_t connections_per_server) noexcept
+	:logger(parent_logger, "translation"),
+	 stats_timer(event_loop, BIND_THIS_METHOD(OnStatsTimer)),
+	 last_stats(addresses.size())
+{
+	assert(!addresses.empty());
+
+	for (const auto &i : addresses)
+		servers.emplace_back(event_loop, i, connections_per_server);
+
+	stats_timer.Schedule(stats_interval);
+}
+
+TranslationStock &
+TranslationBalancer::Pick(std::span<const TranslationStock *const> exclude) noexcept
+{
+	const auto now = stats_timer.GetEventLoop().SteadyNow();
+
+	TranslationStock *best = nullptr;
+	bool best_healthy = false;
+
+	const std::size_t n = servers.size();
+	const std::size_t start = next++ % n;
+
+	auto i = std::next(servers.begin(), start);
+	for (std::size_t j = 0; j < n; ++j, ++i) {
+		if (i == servers.end())
+			i = servers.begin();
+
+		auto &stock = *i;
+		if (std::find(exclude.begin(), exclude.end(), &stock) != exclude.end())
+			continue;
+
+		const bool healthy = stock.IsHealthy(now);
+
+		if (best == nullptr ||
+		    /* prefer healthy servers */
+		    (healthy && !best_healthy) ||
+		    /* then the one with the least outstanding requests */
+		    (healthy == best_healthy &&
+		     (healthy
+		      ? stock.GetOutstanding() < best->GetOutstanding()
+		      : stock.GetConsecutiveFailures() < best->GetConsecutiveFailures()))) {
+			best = &stock;
+			best_healthy = healthy;
+		}
+	}
+
+	assert(best != nullptr);
+	return *best;
+}
+
+Co::Task<TranslateResponse>
+TranslationBalancer::Request(AllocatorPtr alloc,
+			     std::span<const std::byte> request,
+			     std::vector<std::byte> *raw)
+{
+	std::vector<const TranslationStock *> failed;
+	failed.reserve(servers.size());
+
+	while (true) {
+		auto &stock = Pick(failed);
+
+		std::exception_ptr error;
+
+		try {
+			co_return co_await stock.Request(alloc, request, raw);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		failed.push_back(&stock);
+		if (failed.size() >= servers.size())
+			/* all servers have failed */
+			std::rethrow_exception(error);
+
+		logger.Fmt(2, "Translation server {} failed, trying another one: {}"sv,
+			   ToString(stock.GetAddress()), error);
+	}
+}
+
+void
+TranslationBalancer::OnStatsTimer() noexcept
+{
+	auto last = last_stats.begin();
+	for (auto &stock : servers) {
+		const auto &stats = stock.GetStats();
+
+		const auto n_requests = stats.n_requests - last->n_requests;
+		if (n_requests > 0) {
+			const auto n_errors = stats.n_errors - last->n_errors;
+			const auto total_latency = stats.total_latency - last->total_latency;
+
+			using ms = std::chrono::duration<double, std::milli>;
+
+			logger.Fmt(4, "Translation server {}: {} requests, {} errors, latency avg={:.1f}ms max={:.1f}ms"sv,
+				   ToString(stock.GetAddress()),
+				   n_requests, n_errors,
+				   ms{total_latency}.count() / n_requests,
+				   ms{stats.max_latency}.count());
+		}
+
+		*last++ = stats;
+		stock.ResetMaxLatency();
+	}
+
+	stats_timer.Schedule(stats_interval);
+}
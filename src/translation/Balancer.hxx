@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Service.hxx"
+#include "Stock.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "io/Logger.hxx"
+
+#include <list>
+
+class LocalSocketAddress;
+
+/**
+ * Distributes translation requests among several translation
+ * servers.  Each request goes to the (healthy) server with the
+ * least outstanding requests; if it fails, the next server is
+ * tried.
+ */
+class TranslationBalancer final : public TranslationService {
+	const ChildLogger logger;
+
+	std::list<TranslationStock> servers;
+
+	/**
+	 * Used to rotate the starting point when picking a server,
+	 * so servers with the same number of outstanding requests
+	 * get an equal share.
+	 */
+	std::size_t next = 0;
+
+	/**
+	 * Periodically logs latency statistics.
+	 */
+	CoarseTimerEvent stats_timer;
+
+	/**
+	 * The statistics of each server at the last report.
+	 */
+	std::vector<TranslationStock::Stats> last_stats;
+
+public:
+	TranslationBalancer(EventLoop &event_loop, const Logger &parent_logger,
+			    std::span<const LocalSocketAddress> addresses,
+			    std::size_t connections_per_server) noexcept;
+
+	TranslationBalancer(const TranslationBalancer &) = delete;
+	TranslationBalancer &operator=(const TranslationBalancer &) = delete;
+
+	/* virtual methods from class TranslationService */
+	Co::Task<TranslateResponse> Request(AllocatorPtr alloc,
+					    std::span<const std::byte> request,
+					    std::vector<std::byte> *raw) override;
+
+private:
+	/**
+	 * Pick the server for the next request.
+	 *
+	 * @param exclude servers which have already failed for this
+	 * request
+	 */
+	TranslationStock &Pick(std::span<const TranslationStock *const> exclude) noexcept;
+
+	void OnStatsTimer() noexcept;
+};
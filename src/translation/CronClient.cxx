@@ -4,22 +4,19 @@
 
 #include "CronClient.hxx"
 #include "Marshal.hxx"
-#include "Send.hxx"
-#include "Receive.hxx"
+#include "Service.hxx"
 #include "translation/Protocol.hxx"
 #include "translation/Response.hxx"
 #include "AllocatorPtr.hxx"
-#include "event/AwaitableSocketEvent.hxx"
-#include "net/SocketDescriptor.hxx"
 #include "co/Task.hxx"
 
 #include <stdexcept>
 
 static void
-SendTranslateCron(SocketDescriptor s,
-		  std::string_view partition_name,
-		  const char *listener_tag,
-		  const char *user, const char *uri, const char *param)
+MarshalTranslateCron(TranslationMarshaller &m,
+		     std::string_view partition_name,
+		     const char *listener_tag,
+		     const char *user, const char *uri, const char *param)
 {
 	assert(user != nullptr);
 
@@ -29,8 +26,6 @@ SendTranslateCron(SocketDescriptor s,
 	if (param != nullptr && strlen(param) > 4096)
 		throw std::runtime_error("Translation parameter too long");
 
-	TranslationMarshaller m;
-
 	m.Write(TranslationCommand::BEGIN);
 
 	m.Write(TranslationCommand::CRON, partition_name);
@@ -44,19 +39,16 @@ SendTranslateCron(SocketDescriptor s,
 	if (param != nullptr)
 		m.Write(TranslationCommand::PARAM, param);
 	m.Write(TranslationCommand::END);
-
-	SendFull(s, m.Commit());
 }
 
 Co::Task<TranslateResponse>
-TranslateCron(EventLoop &event_loop,
-	      AllocatorPtr alloc, SocketDescriptor s,
+TranslateCron(TranslationService &stock, AllocatorPtr alloc,
 	      std::string_view partition_name,
 	      const char *listener_tag,
 	      const char *user, const char *uri,
 	      const char *param)
 {
-	SendTranslateCron(s, partition_name, listener_tag, user, uri, param);
-	co_await AwaitableSocketEvent(event_loop, s, SocketEvent::READ);
-	co_return ReceiveTranslateResponse(alloc, s);
+	TranslationMarshaller m;
+	MarshalTranslateCron(m, partition_name, listener_tag, user, uri, param);
+	co_return co_await stock.Request(alloc, m.Commit());
 }
@@ -9,12 +9,10 @@
 namespace Co { template<typename T> class Task; }
 struct TranslateResponse;
 class AllocatorPtr;
-class EventLoop;
-class SocketDescriptor;
+class TranslationService;
 
 Co::Task<TranslateResponse>
-TranslateCron(EventLoop &event_loop,
-	      AllocatorPtr alloc, SocketDescriptor s,
+TranslateCron(TranslationService &stock, AllocatorPtr alloc,
 	      std::string_view partition_name,
 	      const char *listener_tag,
 	      const char *user, const char *uri,
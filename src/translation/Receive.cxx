@@ -18,7 +18,8 @@
 #include <sys/socket.h>
 
 TranslateResponse
-ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s)
+ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s,
+			 std::vector<std::byte> *raw)
 {
 	if (int result = s.WaitReadable(30000); result <= 0) {
 		if (result == 0)
@@ -46,6 +47,9 @@ ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s)
 
 		buffer.Append(nbytes);
 
+		if (raw != nullptr)
+			raw->insert(raw->end(), w.begin(), w.begin() + nbytes);
+
 		while (true) {
 			auto r = buffer.Read();
 			if (r.empty())
@@ -71,3 +75,31 @@ ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s)
 		}
 	}
 }
+
+TranslateResponse
+ParseTranslateResponse(AllocatorPtr alloc, std::span<const std::byte> src)
+{
+	TranslateResponse response;
+	TranslateParser parser(alloc, response);
+
+	while (!src.empty()) {
+		size_t consumed = parser.Feed(src);
+		if (consumed == 0)
+			break;
+
+		src = src.subspan(consumed);
+
+		switch (parser.Process()) {
+		case TranslateParser::Result::MORE:
+			break;
+
+		case TranslateParser::Result::DONE:
+			if (!src.empty())
+				throw SocketProtocolError{"Excessive data in translation response"};
+
+			return response;
+		}
+	}
+
+	throw SocketProtocolError{"Truncated translation response"};
+}
@@ -4,9 +4,30 @@
 
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <vector>
+
 struct TranslateResponse;
 class AllocatorPtr;
 class SocketDescriptor;
 
+/**
+ * Receive and parse a translation response.
+ *
+ * @param raw if not nullptr, then all raw response bytes are
+ * appended to this vector (e.g. for storing them in a cache)
+ */
+TranslateResponse
+ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s,
+			 std::vector<std::byte> *raw=nullptr);
+
+/**
+ * Parse a complete translation response which has been received
+ * previously (see the "raw" parameter of
+ * ReceiveTranslateResponse()).
+ *
+ * Throws on error.
+ */
 TranslateResponse
-ReceiveTranslateResponse(AllocatorPtr alloc, SocketDescriptor s);
+ParseTranslateResponse(AllocatorPtr alloc, std::span<const std::byte> src);
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Co { template<typename T> class Task; }
+struct TranslateResponse;
+class AllocatorPtr;
+
+/**
+ * Something which can send a marshalled request to a translation
+ * server and receive its response.
+ */
+class TranslationService {
+public:
+	virtual ~TranslationService() noexcept = default;
+
+	/**
+	 * @param request the marshalled request; it must remain valid
+	 * until the returned task finishes
+	 * @param raw if not nullptr, then the raw response is stored
+	 * in this vector (see ReceiveTranslateResponse())
+	 */
+	virtual Co::Task<TranslateResponse> Request(AllocatorPtr alloc,
+						    std::span<const std::byte> request,
+						    std::vector<std::byte> *raw=nullptr) = 0;
+};
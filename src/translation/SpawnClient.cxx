@@ -4,13 +4,10 @@
 
 #include "SpawnClient.hxx"
 #include "Marshal.hxx"
-#include "Send.hxx"
-#include "Receive.hxx"
+#include "Service.hxx"
 #include "translation/Protocol.hxx"
 #include "translation/Response.hxx"
 #include "AllocatorPtr.hxx"
-#include "event/AwaitableSocketEvent.hxx"
-#include "net/SocketDescriptor.hxx"
 #include "co/Task.hxx"
 
 #include <stdexcept>
@@ -18,10 +15,10 @@
 using std::string_view_literals::operator""sv;
 
 static void
-SendTranslateSpawn(SocketDescriptor s, const char *tag,
-		   const char *plan_name,
-		   const char *execute, const char *param,
-		   const std::forward_list<std::string> &args)
+MarshalTranslateSpawn(TranslationMarshaller &m, const char *tag,
+		      const char *plan_name,
+		      const char *execute, const char *param,
+		      const std::forward_list<std::string> &args)
 
 {
 	assert(execute != nullptr);
@@ -32,8 +29,6 @@ SendTranslateSpawn(SocketDescriptor s, const char *tag,
 	if (param != nullptr && strlen(param) > 4096)
 		throw std::runtime_error("Translation parameter too long");
 
-	TranslationMarshaller m;
-
 	m.Write(TranslationCommand::BEGIN);
 
 	m.Write(TranslationCommand::EXECUTE, execute);
@@ -50,18 +45,16 @@ SendTranslateSpawn(SocketDescriptor s, const char *tag,
 		m.Write(TranslationCommand::APPEND, i);
 
 	m.Write(TranslationCommand::END);
-
-	SendFull(s, m.Commit());
 }
 
 Co::Task<TranslateResponse>
-TranslateSpawn(EventLoop &event_loop,
-	       AllocatorPtr alloc, SocketDescriptor s,
+TranslateSpawn(TranslationService &stock, AllocatorPtr alloc,
 	       const char *tag,
 	       const char *plan_name, const char *execute, const char *param,
-	       const std::forward_list<std::string> &args)
+	       const std::forward_list<std::string> &args,
+	       std::vector<std::byte> *raw_response)
 {
-	SendTranslateSpawn(s, tag, plan_name, execute, param, args);
-	co_await AwaitableSocketEvent(event_loop, s, SocketEvent::READ);
-	co_return ReceiveTranslateResponse(alloc, s);
+	TranslationMarshaller m;
+	MarshalTranslateSpawn(m, tag, plan_name, execute, param, args);
+	co_return co_await stock.Request(alloc, m.Commit(), raw_response);
 }
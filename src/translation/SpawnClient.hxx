@@ -4,18 +4,19 @@
 
 #pragma once
 
+#include <cstddef>
 #include <forward_list>
 #include <string>
+#include <vector>
 
 namespace Co { template<typename T> class Task; }
 struct TranslateResponse;
 class AllocatorPtr;
-class EventLoop;
-class SocketDescriptor;
+class TranslationService;
 
 Co::Task<TranslateResponse>
-TranslateSpawn(EventLoop &event_loop,
-	       AllocatorPtr alloc, SocketDescriptor s,
+TranslateSpawn(TranslationService &stock, AllocatorPtr alloc,
 	       const char *tag,
 	       const char *plan_name, const char *execute, const char *param,
-	       const std::forward_list<std::string> &args);
+	       const std::forward_list<std::string> &args,
+	       std::vector<std::byte> *raw_response=nullptr);
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "Stock.hxx"
+#include "Send.hxx"
+#include "Receive.hxx"
+#include "translation/Response.hxx"
+#include "AllocatorPtr.hxx"
+#include "event/AwaitableSocketEvent.hxx"
+#include "net/ConnectSocket.hxx"
+#include "co/Task.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+#include <sys/socket.h>
+
+/**
+ * Close idle connections after this duration.
+ */
+static constexpr Event::Duration idle_timeout = std::chrono::minutes{1};
+
+TranslationStock::TranslationStock(EventLoop &_event_loop,
+				   SocketAddress _address,
+				   std::size_t _limit) noexcept
+	:event_loop(_event_loop), address(_address), limit(_limit),
+	 defer_resume(event_loop, BIND_THIS_METHOD(OnDeferredResume)),
+	 idle_timer(event_loop, BIND_THIS_METHOD(OnIdleTimer))
+{
+	assert(limit > 0);
+
+	idle.reserve(limit);
+}
+
+TranslationStock::~TranslationStock() noexcept
+{
+	assert(n_busy == 0);
+	assert(waiting.empty());
+}
+
+bool
+TranslationStock::TryGet(GetOperation &op) noexcept
+{
+	while (!idle.empty()) {
+		auto s = std::move(idle.back());
+		idle.pop_back();
+
+		if (s.WaitReadable(0) != 0)
+			/* an idle connection must not be readable; if it
+			   is, the server has probably closed it (or it is
+			   in an error state) */
+			continue;
+
+		op.socket = std::move(s);
+		op.reused = true;
+		++n_busy;
+		return true;
+	}
+
+	if (n_busy >= limit)
+		return false;
+
+	try {
+		op.socket = CreateConnectSocket(address, SOCK_STREAM);
+		op.socket.SetBlocking();
+		op.reused = false;
+		++n_busy;
+	} catch (...) {
+		op.error = std::current_exception();
+		OnFailure();
+	}
+
+	return true;
+}
+
+void
+TranslationStock::Put(UniqueSocketDescriptor &&s, bool reuse) noexcept
+{
+	assert(n_busy > 0);
+	--n_busy;
+
+	if (reuse) {
+		consecutive_failures = 0;
+		idle.emplace_back(std::move(s));
+		idle_timer.Schedule(idle_timeout);
+	} else
+		s.Close();
+
+	if (!waiting.empty())
+		defer_resume.Schedule();
+}
+
+bool
+TranslationStock::IsHealthy(Event::TimePoint now) const noexcept
+{
+	if (consecutive_failures == 0)
+		return true;
+
+	/* exponential backoff: 1s, 2s, 4s, ... up to one minute */
+	const Event::Duration backoff =
+		std::min<Event::Duration>(std::chrono::seconds{1U << std::min(consecutive_failures - 1, 6U)},
+					  std::chrono::minutes{1});
+	return now >= last_failure + backoff;
+}
+
+void
+TranslationStock::OnFailure() noexcept
+{
+	++consecutive_failures;
+	last_failure = event_loop.SteadyNow();
+
+	/* the server may have been restarted; don't attempt to reuse
+	   the other connections */
+	idle.clear();
+}
+
+void
+TranslationStock::OnDeferredResume() noexcept
+{
+	while (!waiting.empty()) {
+		auto &op = waiting.front();
+		if (!TryGet(op))
+			break;
+
+		waiting.pop_front();
+		op.continuation.resume();
+	}
+}
+
+void
+TranslationStock::OnIdleTimer() noexcept
+{
+	idle.clear();
+}
+
+/**
+ * Increments a counter while it exists.
+ */
+class CounterGuard {
+	std::size_t &counter;
+
+public:
+	explicit CounterGuard(std::size_t &_counter) noexcept
+		:counter(_counter)
+	{
+		++counter;
+	}
+
+	~CounterGuard() noexcept {
+		--counter;
+	}
+
+	CounterGuard(const CounterGuard &) = delete;
+	CounterGuard &operator=(const CounterGuard &) = delete;
+};
+
+Co::Task<TranslateResponse>
+TranslationStock::Request(AllocatorPtr alloc,
+			  std::span<const std::byte> request,
+			  std::vector<std::byte> *raw)
+{
+	const CounterGuard pending_guard{n_pending};
+	const auto start = std::chrono::steady_clock::now();
+
+	std::exception_ptr error;
+	TranslateResponse response;
+
+	try {
+		response = co_await Request2(alloc, request, raw);
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	const Event::Duration latency = std::chrono::steady_clock::now() - start;
+	++stats.n_requests;
+	stats.total_latency += latency;
+	stats.max_latency = std::max(stats.max_latency, latency);
+
+	if (error) {
+		++stats.n_errors;
+		std::rethrow_exception(error);
+	}
+
+	co_return response;
+}
+
+inline Co::Task<TranslateResponse>
+TranslationStock::Request2(AllocatorPtr alloc,
+			   std::span<const std::byte> request,
+			   std::vector<std::byte> *raw)
+{
+	while (true) {
+		auto lease = co_await Get();
+		const auto s = lease.GetSocket();
+
+		std::exception_ptr error;
+
+		try {
+			SendFull(s, request);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		if (!error) {
+			co_await AwaitableSocketEvent(event_loop, s, SocketEvent::READ);
+
+			try {
+				if (raw != nullptr)
+					raw->clear();
+
+				auto response = ReceiveTranslateResponse(alloc, s, raw);
+				lease.Release();
+				co_return response;
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		if (!lease.IsReused()) {
+			lease.Fail();
+			std::rethrow_exception(error);
+		}
+
+		/* the server may have closed this connection while it
+		   was idle; try again (if there is no other idle
+		   connection, a new one will be created) */
+		lease.Discard();
+	}
+}
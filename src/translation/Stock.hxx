@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "Service.hxx"
+#include "event/Chrono.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "event/DeferEvent.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * A pool of persistent connections to one translation server.
+ *
+ * The translation protocol does not allow more than one pending
+ * request per connection, so each request leases an idle connection
+ * (or creates a new one, up to a limit).  When the limit is reached,
+ * requests are queued until a connection gets released.
+ */
+class TranslationStock final : public TranslationService {
+public:
+	class Lease;
+	class GetOperation;
+
+	struct Stats {
+		uint_least64_t n_requests = 0, n_errors = 0;
+
+		/**
+		 * The sum and the maximum of the duration of all
+		 * requests (including the time spent waiting for a
+		 * connection).
+		 */
+		Event::Duration total_latency{}, max_latency{};
+	};
+
+private:
+	EventLoop &event_loop;
+
+	const SocketAddress address;
+
+	/**
+	 * The maximum number of connections (idle and busy).
+	 */
+	const std::size_t limit;
+
+	/**
+	 * Connections which are ready for the next request.
+	 */
+	std::vector<UniqueSocketDescriptor> idle;
+
+	/**
+	 * The number of leased connections.
+	 */
+	std::size_t n_busy = 0;
+
+	/**
+	 * Requests waiting for a connection.
+	 */
+	IntrusiveList<GetOperation> waiting;
+
+	/**
+	 * Resumes #waiting requests after a connection has been
+	 * released.  This is deferred to avoid resuming a coroutine
+	 * from within another one.
+	 */
+	DeferEvent defer_resume;
+
+	/**
+	 * Closes all #idle connections after a period of inactivity.
+	 */
+	CoarseTimerEvent idle_timer;
+
+	/**
+	 * The number of Request() calls which have not yet finished.
+	 */
+	std::size_t n_pending = 0;
+
+	/**
+	 * The number of failures since the last successful request.
+	 */
+	unsigned consecutive_failures = 0;
+
+	/**
+	 * The time of the last failure; only valid if
+	 * #consecutive_failures is non-zero.
+	 */
+	Event::TimePoint last_failure;
+
+	Stats stats;
+
+public:
+	TranslationStock(EventLoop &_event_loop, SocketAddress _address,
+			 std::size_t _limit) noexcept;
+	~TranslationStock() noexcept;
+
+	TranslationStock(const TranslationStock &) = delete;
+	TranslationStock &operator=(const TranslationStock &) = delete;
+
+	auto &GetEventLoop() const noexcept {
+		return event_loop;
+	}
+
+	SocketAddress GetAddress() const noexcept {
+		return address;
+	}
+
+	/**
+	 * Shall this server be used?  After a failure, it is
+	 * avoided for a while (longer after repeated failures).
+	 */
+	[[gnu::pure]]
+	bool IsHealthy(Event::TimePoint now) const noexcept;
+
+	/**
+	 * The number of requests which are currently being handled
+	 * or waiting for a connection.
+	 */
+	std::size_t GetOutstanding() const noexcept {
+		return n_pending;
+	}
+
+	const Stats &GetStats() const noexcept {
+		return stats;
+	}
+
+	/**
+	 * Start a new measurement period for Stats::max_latency.
+	 */
+	void ResetMaxLatency() noexcept {
+		stats.max_latency = {};
+	}
+
+	unsigned GetConsecutiveFailures() const noexcept {
+		return consecutive_failures;
+	}
+
+	/**
+	 * Obtain a connection.  The returned object must be
+	 * awaited; the result is a #Lease.
+	 */
+	[[nodiscard]]
+	GetOperation Get() noexcept;
+
+	/**
+	 * Send a request and receive the response on a pooled
+	 * connection.  If a reused connection turns out to have been
+	 * closed by the server meanwhile, the request is repeated on
+	 * a new connection.
+	 */
+	Co::Task<TranslateResponse> Request(AllocatorPtr alloc,
+					    std::span<const std::byte> request,
+					    std::vector<std::byte> *raw) override;
+
+private:
+	/**
+	 * Try to obtain a connection without waiting.
+	 *
+	 * @return true if the operation is finished (successfully
+	 * or with an error), false if it needs to wait
+	 */
+	bool TryGet(GetOperation &op) noexcept;
+
+	void Put(UniqueSocketDescriptor &&s, bool reuse) noexcept;
+
+	void OnFailure() noexcept;
+
+	Co::Task<TranslateResponse> Request2(AllocatorPtr alloc,
+					     std::span<const std::byte> request,
+					     std::vector<std::byte> *raw);
+
+	void OnDeferredResume() noexcept;
+	void OnIdleTimer() noexcept;
+};
+
+/**
+ * A connection borrowed from a #TranslationStock.  It must be given
+ * back by calling Release() (after a complete request), Discard()
+ * or Fail(); the destructor calls Discard().
+ */
+class TranslationStock::Lease {
+	TranslationStock *stock;
+
+	UniqueSocketDescriptor socket;
+
+	/**
+	 * Was this connection used for a previous request?
+	 */
+	bool reused;
+
+public:
+	Lease(TranslationStock &_stock, UniqueSocketDescriptor &&_socket,
+	      bool _reused) noexcept
+		:stock(&_stock), socket(std::move(_socket)), reused(_reused) {}
+
+	Lease(Lease &&src) noexcept
+		:stock(std::exchange(src.stock, nullptr)),
+		 socket(std::move(src.socket)), reused(src.reused) {}
+
+	~Lease() noexcept {
+		if (stock != nullptr)
+			Discard();
+	}
+
+	Lease &operator=(Lease &&) = delete;
+
+	SocketDescriptor GetSocket() const noexcept {
+		return socket;
+	}
+
+	bool IsReused() const noexcept {
+		return reused;
+	}
+
+	/**
+	 * The request was successful; return the connection to the
+	 * pool.
+	 */
+	void Release() noexcept {
+		std::exchange(stock, nullptr)->Put(std::move(socket), true);
+	}
+
+	/**
+	 * Close the connection without blaming the server (e.g. if
+	 * the request was canceled).
+	 */
+	void Discard() noexcept {
+		std::exchange(stock, nullptr)->Put(std::move(socket), false);
+	}
+
+	/**
+	 * Close the connection and count a failure.
+	 */
+	void Fail() noexcept {
+		auto &s = *std::exchange(stock, nullptr);
+		s.Put(std::move(socket), false);
+		s.OnFailure();
+	}
+};
+
+class TranslationStock::GetOperation final
+	: public AutoUnlinkIntrusiveListHook
+{
+	friend class TranslationStock;
+
+	TranslationStock &stock;
+
+	std::coroutine_handle<> continuation;
+
+	UniqueSocketDescriptor socket;
+
+	std::exception_ptr error;
+
+	bool reused = false;
+
+public:
+	explicit GetOperation(TranslationStock &_stock) noexcept
+		:stock(_stock) {}
+
+	GetOperation(const GetOperation &) = delete;
+	GetOperation &operator=(const GetOperation &) = delete;
+
+	bool await_ready() noexcept {
+		/* don't overtake requests which are already waiting */
+		return stock.waiting.empty() && stock.TryGet(*this);
+	}
+
+	void await_suspend(std::coroutine_handle<> _continuation) noexcept {
+		continuation = _continuation;
+		stock.waiting.push_back(*this);
+	}
+
+	Lease await_resume() {
+		if (error)
+			std::rethrow_exception(error);
+
+		return {stock, std::move(socket), reused};
+	}
+};
+
+inline TranslationStock::GetOperation
+TranslationStock::Get() noexcept
+{
+	return GetOperation{*this};
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "CgroupValue.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "util/StringAPI.hxx"
+
+#include <stdlib.h>
+
+uint_least64_t
+ParseUnsigned(const char *s, uint_least64_t min, uint_least64_t max,
+	      const char *name)
+{
+	char *endptr;
+	const auto value = strtoull(s, &endptr, 10);
+	if (endptr == s || *endptr != 0)
+		throw FmtRuntimeError("Failed to parse {:?}", name);
+
+	if (value < min || value > max)
+		throw FmtRuntimeError("{:?} must be between {} and {}",
+				      name, min, max);
+
+	return value;
+}
+
+std::string
+ParseCgroupMax(const char *s, const char *name)
+{
+	if (StringIsEqual(s, "max"))
+		return s;
+
+	return std::to_string(ParseUnsigned(s, 1, UINT64_MAX, name));
+}
+
+std::string
+ParseCgroupMemory(const char *s, const char *name)
+{
+	if (StringIsEqual(s, "max"))
+		return s;
+
+	char *endptr;
+	uint_least64_t value = strtoull(s, &endptr, 10);
+	if (endptr == s)
+		throw FmtRuntimeError("Failed to parse {:?}", name);
+
+	unsigned shift = 0;
+	switch (*endptr) {
+	case 0:
+		break;
+
+	case 'k':
+	case 'K':
+		shift = 10;
+		break;
+
+	case 'm':
+	case 'M':
+		shift = 20;
+		break;
+
+	case 'g':
+	case 'G':
+		shift = 30;
+		break;
+
+	case 't':
+	case 'T':
+		shift = 40;
+		break;
+
+	default:
+		throw FmtRuntimeError("Unknown {:?} suffix", name);
+	}
+
+	if (shift > 0 && *++endptr != 0)
+		throw FmtRuntimeError("Failed to parse {:?}", name);
+
+	if (value == 0 || value > (UINT64_MAX >> shift))
+		throw FmtRuntimeError("Bad {:?} value", name);
+
+	return std::to_string(value << shift);
+}
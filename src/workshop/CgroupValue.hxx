@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Parsers for the plan options which configure cgroup2 controllers.
+ * They throw std::runtime_error with a message mentioning @name.
+ */
+
+/**
+ * Parse an unsigned integer in the given range.
+ */
+uint_least64_t
+ParseUnsigned(const char *s, uint_least64_t min, uint_least64_t max,
+	      const char *name);
+
+/**
+ * Parse a cgroup2 value which is either an unsigned integer or
+ * "max".
+ *
+ * @return the value to be written to the cgroup2 file
+ */
+std::string
+ParseCgroupMax(const char *s, const char *name);
+
+/**
+ * Parse a memory size with an optional suffix ("k", "m", "g" or "t",
+ * in either case, like the kernel's memparse()) or "max".
+ *
+ * @return the value (in bytes) to be written to the cgroup2 file
+ */
+std::string
+ParseCgroupMemory(const char *s, const char *name);
@@ -12,6 +12,9 @@ WorkshopPartitionConfig::Check() const
 	if (database.connect.empty())
 		throw std::runtime_error("Missing 'database' setting");
 
+	if (!log_spool.empty() && log_spool.front() != '/')
+		throw std::runtime_error{"'log_spool' must be an absolute path"};
+
 #ifdef HAVE_AVAHI
 	if (sticky && !zeroconf.IsEnabled())
 		throw std::runtime_error{"Must configure Zeroconf if 'sticky' is enabled"};
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "pg/Config.hxx"
+#include "net/AllocatedSocketAddress.hxx"
 #include "net/LocalSocketAddress.hxx"
 #include "config.h"
 
@@ -13,6 +14,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 struct WorkshopPartitionConfig {
 	/**
@@ -26,7 +28,17 @@ struct WorkshopPartitionConfig {
 
 	Pg::Config database;
 
-	LocalSocketAddress translation_socket;
+	/**
+	 * The translation servers; requests are distributed among
+	 * them.
+	 */
+	std::vector<LocalSocketAddress> translation_sockets;
+
+	/**
+	 * The maximum number of connections to the translation
+	 * server.
+	 */
+	std::size_t translation_connections = 16;
 
 	/**
 	 * Partition tag for #TRANSLATE_LISTENER_TAG.  Empty when not
@@ -34,10 +46,38 @@ struct WorkshopPartitionConfig {
 	 */
 	std::string tag;
 
+	/**
+	 * The maximum number of items in the translation cache (see
+	 * plan option "translate_cache").
+	 */
+	std::size_t translation_cache_size = 256;
+
 	size_t max_log = 8192;
 
+	/**
+	 * If not empty, then the stderr output of each job is spliced
+	 * into a file in this directory (see #LogBridge).
+	 */
+	std::string log_spool;
+
+	/**
+	 * The Pond server to receive the output of job processes.
+	 */
+	AllocatedSocketAddress pond_server;
+
 	bool enable_journal = false;
 
+	/**
+	 * The maximum number of lines per second each job may send to
+	 * the journal (setting "journal_rate"); 0 means unlimited.
+	 */
+	unsigned journal_rate = 0;
+
+	/**
+	 * Store logs zstd-compressed (column "log_zstd")?
+	 */
+	bool compress_log = false;
+
 #ifdef HAVE_AVAHI
 	bool sticky = false;
 #endif
@@ -45,7 +85,6 @@ struct WorkshopPartitionConfig {
 	explicit WorkshopPartitionConfig(std::string &&_name) noexcept
 		:name(std::move(_name))
 	{
-		translation_socket.Clear();
 	}
 
 	void Check() const;
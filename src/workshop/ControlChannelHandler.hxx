@@ -16,6 +16,14 @@ public:
 	virtual void OnControlSetEnv(const char *s) noexcept = 0;
 	virtual void OnControlAgain(std::chrono::seconds d) noexcept = 0;
 
+	/**
+	 * A worker process has finished its current job.
+	 *
+	 * @return false if the #WorkshopControlChannelServer has been
+	 * destroyed
+	 */
+	virtual bool OnControlDone(int status) noexcept = 0;
+
 	/**
 	 * Throws on error.
 	 *
@@ -143,6 +143,20 @@ WorkshopControlChannelServer::OnControl(std::vector<std::string> &&args) noexcep
 
 		handler.OnControlAgain(d);
 		return true;
+	} else if (cmd == "done"sv) {
+		if (args.size() != 2) {
+			InvokeTemporaryError("malformed 'done' command on control channel");
+			return true;
+		}
+
+		char *endptr;
+		auto status = strtoul(args[1].c_str(), &endptr, 10);
+		if (endptr == args[1].c_str() || *endptr != 0 || status > 255) {
+			InvokeTemporaryError("malformed 'done' parameter on control channel");
+			return true;
+		}
+
+		return handler.OnControlDone(status);
 	} else if (cmd == "version"sv) {
 		constexpr std::string_view payload = "version " VERSION;
 		// TODO handle send() errors
@@ -34,3 +34,15 @@ WorkshopJob::AddCpuUsage(std::chrono::microseconds cpu_usage) noexcept
 {
 	queue.AddJobCpuUsage(*this, cpu_usage);
 }
+
+void
+WorkshopJob::AddResourceUsage(const CgroupResourceUsage &usage) noexcept
+{
+	queue.AddJobResourceUsage(*this, usage);
+}
+
+void
+WorkshopJob::SetLogFile(const char *path) noexcept
+{
+	queue.SetJobLogFile(*this, path);
+}
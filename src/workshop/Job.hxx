@@ -4,14 +4,16 @@
 
 #pragma once
 
-#include "util/AllocatedArray.hxx"
+#include "io/UniqueFileDescriptor.hxx"
 
+#include <cassert>
 #include <chrono>
 #include <cstddef>
 #include <string>
 #include <forward_list>
 
 class WorkshopQueue;
+struct CgroupResourceUsage;
 
 struct WorkshopJob {
 	WorkshopQueue &queue;
@@ -28,7 +30,19 @@ struct WorkshopJob {
 
 	std::forward_list<std::string> env;
 
-	AllocatedArray<std::byte> stdin;
+	/**
+	 * Does the database record have stdin data?  It is only
+	 * loaded (into #stdin) after the job has been claimed.
+	 */
+	bool has_stdin = false;
+
+	/**
+	 * A file (memfd) with the data to be fed into the process's
+	 * stdin.  This is only needed for starting the process and is
+	 * closed by ReleaseStartData() as soon as the process has
+	 * been spawned.
+	 */
+	UniqueFileDescriptor stdin;
 
 	explicit WorkshopJob(WorkshopQueue &_queue):queue(_queue) {}
 
@@ -36,6 +50,40 @@ struct WorkshopJob {
 		:queue(_queue), id(_id), plan_name(_plan_name) {
 	}
 
+	/* this object is move-only; it gets handed from the queue to
+	   the #WorkshopOperator together with the stdin file */
+	WorkshopJob(WorkshopJob &&) noexcept = default;
+	WorkshopJob(const WorkshopJob &) = delete;
+	WorkshopJob &operator=(const WorkshopJob &) = delete;
+
+	/**
+	 * Move-assign a job of the same #WorkshopQueue (used to
+	 * advance to the next job of a batch).
+	 */
+	WorkshopJob &operator=(WorkshopJob &&src) noexcept {
+		assert(&queue == &src.queue);
+
+		id = std::move(src.id);
+		plan_name = std::move(src.plan_name);
+		sticky_id = std::move(src.sticky_id);
+		args = std::move(src.args);
+		env = std::move(src.env);
+		has_stdin = src.has_stdin;
+		stdin = std::move(src.stdin);
+		return *this;
+	}
+
+	/**
+	 * Free all data which is only needed for starting the
+	 * process (i.e. #args, #env and #stdin).  After the process
+	 * has been spawned, only the metadata remains.
+	 */
+	void ReleaseStartData() noexcept {
+		args.clear();
+		env.clear();
+		stdin.Close();
+	}
+
 	/**
 	 * Update the "progress" value of the job.
 	 *
@@ -70,4 +118,12 @@ struct WorkshopJob {
 	void SetAgain(std::chrono::seconds delay, const char *log) noexcept;
 
 	void AddCpuUsage(std::chrono::microseconds cpu_usage) noexcept;
+
+	void AddResourceUsage(const CgroupResourceUsage &usage) noexcept;
+
+	/**
+	 * Store the path of the spool file which receives the
+	 * complete stderr output (see #LogBridge).
+	 */
+	void SetLogFile(const char *path) noexcept;
 };
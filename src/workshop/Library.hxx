@@ -8,28 +8,49 @@
 #include "io/UniqueFileDescriptor.hxx"
 
 #include <chrono>
+#include <exception>
 #include <memory>
 #include <string>
-#include <map>
+#include <string_view>
+#include <unordered_map>
 
 #include <sys/stat.h>
 
 struct Plan;
+class PlanLoaderThread;
 
 /**
  * Manage the list of plans (= library) and load their configuration
  * files.
+ *
+ * Modifications of the plan directory are reported by inotify (see
+ * AddWatch() and OnInotify()); looking up a plan does not need any
+ * system call.
  */
 class Library {
 	struct PlanEntry {
 		std::shared_ptr<Plan> plan;
 		bool deinstalled = false;
+
+		/**
+		 * The plan file has been modified, and #plan needs to
+		 * be reloaded.  Until then, the old #plan is used.
+		 */
+		bool stale = false;
+
+		/**
+		 * Has the plan file been submitted to the
+		 * #PlanLoaderThread?
+		 */
+		bool loading = false;
+
 		struct statx_timestamp mtime{};
 		std::chrono::steady_clock::time_point disabled_until =
 			std::chrono::steady_clock::time_point::min();
 
 		void Clear() {
 			plan.reset();
+			stale = false;
 			mtime = {};
 		}
 
@@ -38,7 +59,7 @@ class Library {
 		}
 
 		bool IsAvailable(std::chrono::steady_clock::time_point now) const {
-			return !deinstalled && !IsDisabled(now);
+			return plan && !deinstalled && !IsDisabled(now);
 		}
 
 		void Disable(std::chrono::steady_clock::time_point now,
@@ -54,14 +75,42 @@ class Library {
 	const LLogger logger;
 
 	const std::string path;
-	const UniqueFileDescriptor directory_fd;
 
-	std::map<std::string, PlanEntry, std::less<>> plans;
+	/**
+	 * The plan directory.  It is reopened by AddWatch() after
+	 * the directory has vanished, because #path may then refer
+	 * to a new one.
+	 */
+	UniqueFileDescriptor directory_fd;
 
-	std::chrono::steady_clock::time_point next_plans_check =
-		std::chrono::steady_clock::time_point::min();
+	struct Hash {
+		using is_transparent = void;
 
-	struct statx_timestamp mtime{};
+		[[gnu::pure]]
+		std::size_t operator()(std::string_view s) const noexcept {
+			return std::hash<std::string_view>{}(s);
+		}
+	};
+
+	std::unordered_map<std::string, PlanEntry, Hash, std::equal_to<>> plans;
+
+	/**
+	 * The inotify watch descriptor of the plan directory or -1
+	 * if none was registered.
+	 */
+	int watch_descriptor = -1;
+
+	/**
+	 * Has the plan directory been deleted or moved?  Then
+	 * #directory_fd is stale.
+	 */
+	bool vanished = false;
+
+	/**
+	 * If set, plan files are loaded asynchronously by this
+	 * thread; if not, they are loaded synchronously.
+	 */
+	PlanLoaderThread *loader = nullptr;
 
 public:
 	explicit Library(const char *path);
@@ -72,15 +121,51 @@ public:
 		return directory_fd;
 	}
 
+	void SetLoader(PlanLoaderThread *_loader) noexcept {
+		loader = _loader;
+	}
+
+	bool HasWatch() const noexcept {
+		return watch_descriptor >= 0;
+	}
+
+	bool IsWatchDescriptor(int wd) const noexcept {
+		return wd == watch_descriptor;
+	}
+
 	/**
-	 * @param force if true, then update the list even if the plan
-	 * directory time stamp hasn't changed and the #next_plans_check
-	 * time stamp hasn't been reached yet
+	 * Register the plan directory at the given inotify instance
+	 * (and reopen it if it has vanished).  Errors are logged.
+	 */
+	void AddWatch(FileDescriptor inotify_fd) noexcept;
+
+	/**
+	 * Reload the whole plan directory.
 	 *
 	 * @return true if the library was modified (at least one plan has
 	 * been added, modified or deleted)
 	 */
-	bool Update(std::chrono::steady_clock::time_point now, bool force) noexcept;
+	bool Update(std::chrono::steady_clock::time_point now) noexcept;
+
+	/**
+	 * Check all plans again: retry those which have failed to
+	 * load and check whether their executables still exist.
+	 * Modifications of plan files are reported by inotify, but
+	 * the executables are not watched.
+	 *
+	 * @return true if the library was modified
+	 */
+	bool Revalidate(std::chrono::steady_clock::time_point now) noexcept;
+
+	/**
+	 * Handle an inotify event on the plan directory.  If the
+	 * directory itself was deleted or moved, all of its plans
+	 * are removed.
+	 *
+	 * @return true if the library was modified
+	 */
+	bool OnInotify(std::chrono::steady_clock::time_point now,
+		       unsigned mask, const char *name) noexcept;
 
 	/**
 	 * Visit all plans that are available.
@@ -100,6 +185,17 @@ public:
 	std::shared_ptr<Plan> Get(std::chrono::steady_clock::time_point now,
 				  const char *name) noexcept;
 
+	/**
+	 * A plan file has been loaded by the #PlanLoaderThread.
+	 *
+	 * @param plan the new plan or nullptr on error
+	 * @return true if the library was modified
+	 */
+	bool OnPlanLoaded(std::chrono::steady_clock::time_point now,
+			  const std::string &name,
+			  std::shared_ptr<Plan> &&plan,
+			  std::exception_ptr error) noexcept;
+
 private:
 	void DisablePlan(PlanEntry &entry,
 			 std::chrono::steady_clock::time_point now,
@@ -117,6 +213,11 @@ private:
 	bool ValidatePlan(PlanEntry &entry,
 			  std::chrono::steady_clock::time_point now) noexcept;
 
+	/**
+	 * Load the plan file (or submit it to the #loader).
+	 *
+	 * @return true if #PlanEntry::plan has been replaced
+	 */
 	bool LoadPlan(const char *name, PlanEntry &entry,
 		      std::chrono::steady_clock::time_point now) noexcept;
 
@@ -130,4 +231,18 @@ private:
 	 * @return whether the plan was modified
 	 */
 	bool UpdatePlans(std::chrono::steady_clock::time_point now);
+
+	/**
+	 * Add a new plan or reload an existing one after its file
+	 * has been modified.
+	 *
+	 * @return whether the plan was modified
+	 */
+	bool UpdatePlanFile(const char *name,
+			    std::chrono::steady_clock::time_point now) noexcept;
+
+	/**
+	 * @return whether the plan existed
+	 */
+	bool RemovePlan(const char *name) noexcept;
 };
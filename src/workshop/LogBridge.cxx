@@ -3,6 +3,11 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "LogBridge.hxx"
+#include "LogTail.hxx"
+#include "event/Loop.hxx"
+#include "io/Logger.hxx"
+#include "io/Iovec.hxx"
+#include "net/log/Datagram.hxx"
 #include "util/SpanCast.hxx"
 
 #include <fmt/core.h>
@@ -11,39 +16,330 @@
 #include <systemd/sd-journal.h>
 #endif // HAVE_LIBSYSTEMD
 
+#include <algorithm> // for std::min()
+#include <iterator> // for std::size()
+#include <utility> // for std::exchange()
+
+#include <errno.h>
+#include <fcntl.h> // for splice()
+#include <string.h> // for strerror()
+#include <unistd.h> // for pread()
+
+using std::string_view_literals::operator""sv;
+
+#ifdef HAVE_LIBSYSTEMD
+
+/**
+ * Submit the batch early if it has this many entries.
+ */
+static constexpr std::size_t JOURNAL_MAX_BATCH = 256;
+
+/**
+ * If submitting a batch takes longer than this, journald is
+ * considered congested (only if #journal_rate is set).
+ */
+static constexpr std::chrono::steady_clock::duration JOURNAL_SLOW =
+	std::chrono::milliseconds{100};
+
+#endif // HAVE_LIBSYSTEMD
+
 LogBridge::LogBridge(EventLoop &event_loop,
+		     const LazyDomainLogger &_logger,
 		     std::string_view _plan_name,
 		     std::string_view _job_id,
-		     UniqueFileDescriptor read_pipe_fd) noexcept
-	:plan_name(_plan_name), job_id(_job_id),
-	 reader(event_loop, std::move(read_pipe_fd), *this)
+		     UniqueFileDescriptor read_pipe_fd,
+		     UniqueFileDescriptor _spool_file) noexcept
+	:logger(_logger), plan_name(_plan_name), job_id(_job_id),
+	 spool_event(event_loop, BIND_THIS_METHOD(OnSpoolReady)),
+	 spool_file(std::move(_spool_file)),
+	 defer_flush(event_loop, BIND_THIS_METHOD(OnDeferredFlush))
+#ifdef HAVE_LIBSYSTEMD
+	, journal_plan_field(fmt::format("WORKSHOP_PLAN={}"sv, plan_name)),
+	 journal_job_field(fmt::format("WORKSHOP_JOB={}"sv, job_id)),
+	 journal_tokens(0),
+	 journal_refill_time(event_loop.SteadyNow())
+#endif
 {
+	if (spool_file.IsDefined()) {
+		spool_event.Open(read_pipe_fd.Release());
+		spool_event.ScheduleRead();
+	} else
+		reader.emplace(event_loop, std::move(read_pipe_fd), *this);
 }
 
-LogBridge::~LogBridge() noexcept = default;
+LogBridge::~LogBridge() noexcept
+{
+	spool_event.Close();
+
+#ifdef HAVE_LIBSYSTEMD
+	FinishJournal();
+#endif
+
+	FinishPond();
+}
 
 bool
-LogBridge::OnPipeLine(std::span<char> line) noexcept
+LogBridge::Splice() noexcept
+{
+	const FileDescriptor pipe = spool_event.GetFileDescriptor();
+
+	if (spool_failed) {
+		/* discard data to keep the pipe from blocking the
+		   other end */
+		std::byte discard[4096];
+		const auto nbytes = pipe.Read(discard);
+		if (nbytes > 0)
+			return true;
+
+		if (nbytes == 0 || errno != EAGAIN)
+			spool_event.Close();
+		return false;
+	}
+
+	const auto nbytes = splice(pipe.Get(), nullptr,
+				   spool_file.Get(), nullptr,
+				   1024 * 1024,
+				   SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+	if (nbytes > 0) {
+		spool_size += nbytes;
+		return true;
+	}
+
+	if (nbytes == 0) {
+		/* end of pipe */
+		spool_event.Close();
+		return false;
+	}
+
+	if (errno == EAGAIN)
+		return false;
+
+	logger(1, "Failed to write the log file: ", strerror(errno));
+	spool_failed = true;
+	return true;
+}
+
+void
+LogBridge::LoadSpoolTail() noexcept
 {
-	// TODO: strip non-ASCII characters
+	buffer.clear();
+
+	const std::size_t size = std::min<off_t>(spool_size - spool_start,
+						 max_buffer_size - 1);
+	if (size == 0)
+		return;
 
-	if (max_buffer_size > 0 && buffer.length() < max_buffer_size - 1) {
-		buffer.append(line.data(),
-			      std::min(line.size(), max_buffer_size - 1 - buffer.length()));
-		buffer.push_back('\n');
+	const off_t offset = spool_size - size;
+
+	buffer.resize(size);
+	const auto nbytes = pread(spool_file.Get(), buffer.data(), size, offset);
+	if (nbytes <= 0) {
+		buffer.clear();
+		return;
+	}
+
+	buffer.resize(nbytes);
+
+	SanitizeLogTail(buffer, offset > spool_start);
+}
+
+void
+LogBridge::OnSpoolReady(unsigned) noexcept
+{
+	Splice();
+}
+
+#ifdef HAVE_LIBSYSTEMD
+
+inline bool
+LogBridge::CheckJournalRate() noexcept
+{
+	if (journal_rate == 0)
+		return true;
+
+	const auto now = defer_flush.GetEventLoop().SteadyNow();
+	const std::chrono::duration<double> elapsed = now - journal_refill_time;
+	journal_refill_time = now;
+
+	journal_tokens = std::min(journal_tokens + elapsed.count() * journal_rate,
+				  GetJournalBurst());
+	if (journal_tokens < 1)
+		return false;
+
+	journal_tokens -= 1;
+	return true;
+}
+
+void
+LogBridge::AppendJournalEntry(std::string_view message) noexcept
+{
+	journal_batch.append("MESSAGE="sv);
+	journal_batch.append(message);
+	journal_batch_ends.push_back(journal_batch.size());
+}
+
+inline void
+LogBridge::AddJournalLine(std::string_view line) noexcept
+{
+	if (!CheckJournalRate()) {
+		++journal_suppressed;
+		return;
+	}
+
+	if (journal_suppressed > 0)
+		AppendJournalEntry(fmt::format("[{} lines suppressed]"sv,
+					       std::exchange(journal_suppressed, 0)));
+
+	AppendJournalEntry(line);
+
+	if (journal_batch_ends.size() >= JOURNAL_MAX_BATCH)
+		FlushJournal();
+	else
+		defer_flush.Schedule();
+}
+
+void
+LogBridge::FlushJournal() noexcept
+{
+	if (journal_batch_ends.empty())
+		return;
+
+	/* not EventLoop::SteadyNow() because the cached time does not
+	   advance while we're blocking */
+	const auto start = std::chrono::steady_clock::now();
+
+	struct iovec v[] = {
+		{},
+		MakeIovec(AsBytes(journal_plan_field)),
+		MakeIovec(AsBytes(journal_job_field)),
+	};
+
+	std::size_t position = 0;
+	for (const std::size_t end : journal_batch_ends) {
+		v[0] = MakeIovec(AsBytes(std::string_view{journal_batch}.substr(position, end - position)));
+		sd_journal_sendv(v, std::size(v));
+		position = end;
+	}
+
+	journal_batch.clear();
+	journal_batch_ends.clear();
+
+	if (journal_rate > 0 &&
+	    std::chrono::steady_clock::now() - start >= JOURNAL_SLOW)
+		/* journald is congested: empty the token bucket, so
+		   further lines are suppressed until it has been
+		   refilled */
+		journal_tokens = 0;
+}
+
+void
+LogBridge::FinishJournal() noexcept
+{
+	if (journal_suppressed > 0)
+		AppendJournalEntry(fmt::format("[{} lines suppressed]"sv,
+					       std::exchange(journal_suppressed, 0)));
+
+	FlushJournal();
+}
+
+#endif // HAVE_LIBSYSTEMD
+
+inline void
+LogBridge::SendPond(std::string_view line) noexcept
+{
+	if (line.empty())
+		return;
+
+	if (line.find('\0') != line.npos) {
+		/* stop Pond submissions when a null byte was seen
+		   (see PipePondAdapter::OnLine()) */
+		pond->Disable();
+		return;
+	}
+
+	Net::Log::Datagram d{
+		.timestamp = Net::Log::FromSystem(defer_flush.GetEventLoop().SystemNow()),
+		.site = plan_name.c_str(),
+		.analytics_id = job_id.c_str(),
+		.message = line,
+		.type = Net::Log::Type::JOB,
+	};
+
+	/* truncate long lines */
+	d.TruncateMessage(1024);
+
+	try {
+		pond->Add(d);
+	} catch (...) {
+		logger(2, "Failed to send to Pond: ", std::current_exception());
+		pond->Disable();
+		return;
+	}
+
+	defer_flush.Schedule();
+}
+
+void
+LogBridge::FlushPond() noexcept
+{
+	if (!pond || !pond->IsDefined())
+		return;
+
+	try {
+		pond->Flush();
+	} catch (...) {
+		logger(2, "Failed to send to Pond: ", std::current_exception());
+		pond->Disable();
+	}
+}
+
+void
+LogBridge::FinishPond() noexcept
+{
+	if (!pond || !pond->IsDefined())
+		return;
+
+	if (const auto n_dropped = pond->TakeDropped(); n_dropped > 0)
+		SendPond(fmt::format("[{} lines dropped]"sv, n_dropped));
+
+	FlushPond();
+
+	/* the socket is still full: don't keep the rest for the next
+	   job (or forever), but log the loss */
+	if (pond->IsDefined())
+		if (const auto n_lost = pond->DiscardQueued(); n_lost > 0)
+			logger(2, "Failed to send ", n_lost, " lines to Pond");
+}
+
+void
+LogBridge::OnDeferredFlush() noexcept
+{
+#ifdef HAVE_LIBSYSTEMD
+	FlushJournal();
+#endif
+
+	FlushPond();
+}
+
+bool
+LogBridge::OnPipeLine(std::span<char> line) noexcept
+{
+	if (capture) {
+		capture->Append(line);
+		capture->Append(std::span{"\n", 1});
 	}
 
 #ifdef HAVE_LIBSYSTEMD
 	if (enable_journal)
-		sd_journal_send("MESSAGE=%.*s", int(line.size()), line.data(),
-				"WORKSHOP_PLAN=%s", plan_name.c_str(),
-				"WORKSHOP_JOB=%s", job_id.c_str(),
-				nullptr);
+		AddJournalLine(ToStringView(line));
 #else
 	constexpr bool enable_journal = false;
 #endif // HAVE_LIBSYSTEMD
 
-	if (max_buffer_size == 0 && !enable_journal)
+	if (pond && pond->IsDefined())
+		SendPond(ToStringView(line));
+
+	if (max_buffer_size == 0 && !enable_journal && !pond)
 		fmt::print(stderr, "[{}:{}] {}\n", plan_name, job_id,
 			   ToStringView(line));
 
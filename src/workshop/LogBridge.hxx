@@ -5,49 +5,295 @@
 #pragma once
 
 #include "event/PipeLineReader.hxx"
+#include "event/PipeEvent.hxx"
+#include "event/Chrono.hxx"
+#include "event/DeferEvent.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "net/SocketDescriptor.hxx"
+#include "CaptureBuffer.hxx"
+#include "PondBatch.hxx"
 #include "config.h"
 
+#include <optional>
 #include <string>
+#include <vector>
 
+#include <sys/types.h> // for off_t
+
+class LazyDomainLogger;
+
+/**
+ * Receives the stderr output of a job process.
+ *
+ * Unlike #ProgressReader, this does not use the io_uring
+ * #PipeReader: Flush() must be able to read everything the process
+ * has written synchronously (after it has exited or reported
+ * "done"), before the result gets submitted; with a read pending
+ * in io_uring, that data might sit in an undelivered completion,
+ * and reading the pipe directly would reorder it.
+ *
+ * Normally, the output is read line by line, and each line is
+ * copied to the #CaptureBuffer for the "log" column (which keeps
+ * the head and the tail), to the systemd journal, to a Pond server
+ * or to our stderr.
+ *
+ * Journal entries are collected and submitted after all lines of
+ * one pipe read have been processed, reusing the constant
+ * WORKSHOP_PLAN/WORKSHOP_JOB fields.  Each entry is still one
+ * sd_journal_sendv() call, because the journal protocol has one
+ * datagram per entry.  Optionally, the number of entries per job is
+ * rate-limited, so a job which floods the journal does not trigger
+ * journald's per-service rate limit (which would suppress the
+ * messages of all other jobs).
+ *
+ * In "spool" mode (if a spool file was passed to the constructor),
+ * the pipe is spliced into that file without copying the data into
+ * userspace, and the buffer is filled with the tail of the file only
+ * when it is requested.
+ */
 class LogBridge final : PipeLineReaderHandler {
+	/**
+	 * The logger of the #WorkshopOperator which owns this
+	 * object.
+	 */
+	const LazyDomainLogger &logger;
+
 	const std::string plan_name, job_id;
 
-	PipeLineReader reader;
+	/**
+	 * Reads the pipe line by line; not used in spool mode.
+	 */
+	std::optional<PipeLineReader> reader;
+
+	/**
+	 * Spool mode: waits for data on the pipe to be spliced into
+	 * #spool_file.
+	 */
+	PipeEvent spool_event;
+
+	UniqueFileDescriptor spool_file;
+
+	/**
+	 * The number of bytes written to #spool_file.
+	 */
+	off_t spool_size = 0;
+
+	/**
+	 * The #spool_file offset where the output of the current job
+	 * begins (see ClearBuffer()).
+	 */
+	off_t spool_start = 0;
+
+	/**
+	 * Writing to #spool_file has failed; all further data is
+	 * discarded.
+	 */
+	bool spool_failed = false;
+
+	/**
+	 * Submits the collected journal entries and Pond datagrams
+	 * after all lines of the current pipe read have been
+	 * processed.
+	 */
+	DeferEvent defer_flush;
+
 #ifdef HAVE_LIBSYSTEMD
 	bool enable_journal = false;
+
+	/**
+	 * The constant fields of all journal entries.
+	 */
+	const std::string journal_plan_field, journal_job_field;
+
+	/**
+	 * Journal entries waiting to be submitted, each one a
+	 * "MESSAGE=" field.  #journal_batch_ends contains the end
+	 * offset of each entry.
+	 */
+	std::string journal_batch;
+	std::vector<std::size_t> journal_batch_ends;
+
+	/**
+	 * The maximum number of entries per second; 0 means
+	 * unlimited.
+	 */
+	unsigned journal_rate = 0;
+
+	/**
+	 * The token bucket of the journal rate limit: the number of
+	 * entries which may be submitted right now, refilled
+	 * according to the time elapsed since #journal_refill_time.
+	 */
+	double journal_tokens;
+	Event::TimePoint journal_refill_time;
+
+	/**
+	 * The number of lines which were not submitted to the journal
+	 * because of the rate limit.
+	 */
+	std::size_t journal_suppressed = 0;
 #endif // HAVE_LIBSYSTEMD
 
+	/**
+	 * If set, then each line is sent to this Pond server.
+	 */
+	std::optional<PondBatch> pond;
+
+	/**
+	 * Captures the head and the tail of the output (not used in
+	 * spool mode).
+	 */
+	std::optional<CaptureBuffer> capture;
+
+	/**
+	 * The text returned by GetBuffer().
+	 */
 	std::string buffer;
+
 	size_t max_buffer_size = 0;
 
 public:
+	/**
+	 * @param _spool_file if defined, then enable spool mode; the
+	 * file must be readable and writable
+	 */
 	LogBridge(EventLoop &event_loop,
+		  const LazyDomainLogger &_logger,
 		  std::string_view _plan_name, std::string_view _job_id,
-		  UniqueFileDescriptor read_pipe_fd) noexcept;
+		  UniqueFileDescriptor read_pipe_fd,
+		  UniqueFileDescriptor _spool_file={}) noexcept;
 	~LogBridge() noexcept;
 
 	void EnableBuffer(size_t max_size) noexcept {
 		max_buffer_size = max_size;
+
+		if (!spool_file.IsDefined())
+			capture.emplace(max_size - 1);
+	}
+
+	/**
+	 * Returns the captured log text (or nullptr if the buffer is
+	 * disabled).  In spool mode, this loads the tail of the spool
+	 * file.
+	 */
+	const char *GetBuffer() noexcept {
+		if (max_buffer_size == 0)
+			return nullptr;
+
+		if (spool_file.IsDefined())
+			LoadSpoolTail();
+		else
+			buffer = capture->GetText();
+
+		return buffer.c_str();
 	}
 
-	const char *GetBuffer() const noexcept {
-		return max_buffer_size > 0
-			? buffer.c_str()
-			: nullptr;
+	/**
+	 * Discard the buffer contents, e.g. after one job of a batch
+	 * has finished.
+	 */
+	void ClearBuffer() noexcept {
+		buffer.clear();
+		if (capture)
+			capture->Clear();
+		spool_start = spool_size;
 	}
 
-	void EnableJournal() noexcept {
+	/**
+	 * Enable the systemd journal.  This is ignored in spool mode.
+	 *
+	 * @param rate the maximum number of lines per second; 0 means
+	 * unlimited
+	 */
+	void EnableJournal([[maybe_unused]] unsigned rate) noexcept {
 #ifdef HAVE_LIBSYSTEMD
 		enable_journal = true;
+		journal_rate = rate;
+		journal_tokens = GetJournalBurst();
 #endif
 	}
 
+	/**
+	 * Send each line to the given (connected) Pond datagram
+	 * socket.  This is ignored in spool mode.
+	 */
+	void EnablePond(SocketDescriptor pond_socket) noexcept {
+		if (!spool_file.IsDefined())
+			pond.emplace(pond_socket);
+	}
+
 	void Flush() noexcept {
-		if (reader.IsDefined())
-			reader.Flush();
+		if (reader) {
+			if (reader->IsDefined())
+				reader->Flush();
+		} else {
+			while (spool_event.IsDefined() && Splice()) {}
+		}
+
+#ifdef HAVE_LIBSYSTEMD
+		FinishJournal();
+#endif
+
+		FinishPond();
 	}
 
 private:
+	/**
+	 * Move data from the pipe to #spool_file.
+	 *
+	 * @return true if data was moved, false if the pipe is empty
+	 * (or has been closed)
+	 */
+	bool Splice() noexcept;
+
+	void LoadSpoolTail() noexcept;
+
+	void OnSpoolReady(unsigned events) noexcept;
+
+#ifdef HAVE_LIBSYSTEMD
+	/**
+	 * The capacity of the journal token bucket.
+	 */
+	double GetJournalBurst() const noexcept {
+		return 10.0 * journal_rate;
+	}
+
+	/**
+	 * Check (and update) the journal rate limit.
+	 *
+	 * @return true if one more entry may be submitted
+	 */
+	bool CheckJournalRate() noexcept;
+
+	void AppendJournalEntry(std::string_view message) noexcept;
+
+	/**
+	 * Add a line to #journal_batch (unless the rate limit has
+	 * been exceeded).
+	 */
+	void AddJournalLine(std::string_view line) noexcept;
+
+	/**
+	 * Submit #journal_batch to the journal now.
+	 */
+	void FlushJournal() noexcept;
+
+	/**
+	 * Like FlushJournal(), but also report suppressed lines.
+	 */
+	void FinishJournal() noexcept;
+#endif // HAVE_LIBSYSTEMD
+
+	void SendPond(std::string_view line) noexcept;
+	void FlushPond() noexcept;
+
+	/**
+	 * Like FlushPond(), but also report dropped lines.
+	 */
+	void FinishPond() noexcept;
+
+	void OnDeferredFlush() noexcept;
+
 	bool OnPipeLine(std::span<char> line) noexcept override;
 	void OnPipeEnd() noexcept override {}
 };
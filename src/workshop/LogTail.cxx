@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "LogTail.hxx"
+#include "UTF8Sanitizer.hxx"
+
+#include <algorithm> // for std::find_if()
+
+void
+SanitizeLogTail(std::string &buffer, bool truncated) noexcept
+{
+	if (truncated) {
+		/* the tail begins in the middle of a line: discard
+		   the incomplete line */
+		if (const auto newline = buffer.find('\n');
+		    newline != buffer.npos && newline + 1 < buffer.size())
+			buffer.erase(0, newline + 1);
+		else {
+			/* no line break at all: at least skip an
+			   incomplete UTF-8 sequence */
+			const auto i = std::find_if(buffer.begin(), buffer.end(),
+						    [](char ch){
+							    return (ch & 0xc0) != 0x80;
+						    });
+			buffer.erase(buffer.begin(), i);
+		}
+	}
+
+	/* the raw output may contain anything; sanitize only the
+	   part which goes to the database */
+	if (UTF8Sanitizer::FindInvalid(buffer, UTF8Sanitizer::Mode::UTF8) < buffer.size()) {
+		std::string text;
+		text.reserve(buffer.size());
+
+		UTF8Sanitizer sanitizer;
+		const auto append = [&text](std::string_view s){ text.append(s); };
+		sanitizer.Feed(buffer, append);
+		sanitizer.Finish(append);
+
+		buffer = std::move(text);
+	}
+}
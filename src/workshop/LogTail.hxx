@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <string>
+
+/**
+ * Prepare the tail of raw job output (e.g. loaded from a spool
+ * file) for the "log" column: if it was cut off at the front,
+ * discard the incomplete first line (or, if there is no line break,
+ * at least an incomplete UTF-8 sequence), and replace invalid UTF-8
+ * sequences.
+ *
+ * @param truncated true if #buffer does not begin at the start of
+ * the output
+ */
+void
+SanitizeLogTail(std::string &buffer, bool truncated) noexcept;
@@ -3,6 +3,170 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "MultiLibrary.hxx"
+#include "Plan.hxx"
+#include "event/Loop.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "system/Error.hxx"
+
+#include <cassert>
+#include <cstddef>
+
+#include <errno.h>
+#include <sys/inotify.h>
+
+void
+MultiLibrary::EnableLoaderThread(EventLoop &event_loop,
+				 BoundMethod<void() noexcept> _modified_callback)
+{
+	assert(!loader);
+
+	modified_callback = _modified_callback;
+	loader = std::make_unique<PlanLoaderThread>(event_loop,
+						    BIND_THIS_METHOD(OnPlansLoaded));
+
+	for (auto &i : libraries)
+		i.SetLoader(loader.get());
+}
+
+void
+MultiLibrary::StopLoaderThread() noexcept
+{
+	for (auto &i : libraries)
+		i.SetLoader(nullptr);
+
+	loader.reset();
+}
+
+void
+MultiLibrary::OnPlansLoaded(std::span<PlanLoaderThread::Result> results) noexcept
+{
+	const auto now = loader->GetEventLoop().SteadyNow();
+
+	bool modified = false;
+
+	for (auto &i : results)
+		if (i.library.OnPlanLoaded(now, i.name,
+					   std::move(i.plan),
+					   std::move(i.error)))
+			modified = true;
+
+	/* notify only once for the whole batch, because the
+	   callback rebuilds the filters of all partitions */
+	if (modified)
+		modified_callback();
+}
+
+inline void
+MultiLibrary::OpenInotify()
+{
+	int fd = inotify_init1(IN_CLOEXEC|IN_NONBLOCK);
+	if (fd < 0)
+		throw MakeErrno("inotify_init1() failed");
+
+	inotify_fd = UniqueFileDescriptor{AdoptTag{}, fd};
+}
+
+inline bool
+MultiLibrary::ReadInotify(std::chrono::steady_clock::time_point now)
+{
+	bool modified = false;
+
+	alignas(struct inotify_event) std::byte buffer[4096];
+
+	while (true) {
+		const auto nbytes = inotify_fd.Read(buffer);
+		if (nbytes < 0) {
+			if (errno == EAGAIN)
+				break;
+
+			throw MakeErrno("Failed to read from inotify");
+		}
+
+		if (nbytes == 0)
+			break;
+
+		for (std::size_t position = 0;
+		     position + sizeof(struct inotify_event) <= (std::size_t)nbytes;) {
+			const auto &event = *reinterpret_cast<const struct inotify_event *>(buffer + position);
+			position += sizeof(event) + event.len;
+
+			if (event.mask & IN_Q_OVERFLOW) {
+				/* events were lost; reload everything */
+				for (auto &i : libraries)
+					if (i.Update(now))
+						modified = true;
+				continue;
+			}
+
+			const char *name = event.len > 0 ? event.name : nullptr;
+
+			for (auto &i : libraries) {
+				if (i.IsWatchDescriptor(event.wd)) {
+					if (i.OnInotify(now, event.mask, name))
+						modified = true;
+					break;
+				}
+			}
+		}
+	}
+
+	return modified;
+}
+
+bool
+MultiLibrary::Update(std::chrono::steady_clock::time_point now, bool force) noexcept
+{
+	if (!loaded) {
+		loaded = true;
+
+		try {
+			OpenInotify();
+		} catch (...) {
+			/* continue without inotify; the plan
+			   directories will be reloaded periodically */
+			logger.Fmt(1, "{}", std::current_exception());
+		}
+
+		/* the first Update() call loads all libraries */
+		force = true;
+	}
+
+	bool modified = false;
+
+	if (force || now >= next_revalidate) {
+		next_revalidate = now + std::chrono::seconds(60);
+
+		for (auto &i : libraries) {
+			bool reload = force;
+			if (!inotify_fd.IsDefined()) {
+				/* without inotify, added and removed
+				   plan files are only noticed by
+				   reloading the whole directory */
+				reload = true;
+			} else if (!i.HasWatch()) {
+				/* register the watch before loading
+				   the directory to avoid missing
+				   modifications in between */
+				i.AddWatch(inotify_fd);
+				reload = true;
+			}
+
+			if (reload ? i.Update(now) : i.Revalidate(now))
+				modified = true;
+		}
+	}
+
+	if (inotify_fd.IsDefined()) {
+		try {
+			if (ReadInotify(now))
+				modified = true;
+		} catch (...) {
+			logger.Fmt(1, "{}", std::current_exception());
+		}
+	}
+
+	return modified;
+}
 
 std::shared_ptr<Plan>
 MultiLibrary::Get(std::chrono::steady_clock::time_point now, const char *name)
@@ -5,29 +5,94 @@
 #pragma once
 
 #include "Library.hxx"
+#include "PlanLoaderThread.hxx"
+#include "io/Logger.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/BindMethod.hxx"
 
 #include <memory>
 #include <forward_list>
 
 /**
  * Manages several #Library instances as one.
+ *
+ * All libraries share one inotify instance.  It is created by the
+ * first Update() call, so each process (the daemon and the spawner)
+ * which calls Update() gets its own.  If that fails, all plan
+ * directories are reloaded every 60 seconds instead.
  */
 class MultiLibrary {
+	const LLogger logger{"library"};
+
 	std::forward_list<Library> libraries;
 
+	UniqueFileDescriptor inotify_fd;
+
+	/**
+	 * Has Update() been called already?
+	 */
+	bool loaded = false;
+
+	std::chrono::steady_clock::time_point next_revalidate =
+		std::chrono::steady_clock::time_point::min();
+
+	/**
+	 * Invoked after plans loaded by #loader have modified the
+	 * library; once per batch of results.
+	 */
+	BoundMethod<void() noexcept> modified_callback;
+
+	/**
+	 * Declared after #libraries so it gets destructed (and the
+	 * thread gets joined) before them.
+	 */
+	std::unique_ptr<PlanLoaderThread> loader;
+
 public:
 	void InsertPath(const char *_path) {
 		libraries.emplace_front(_path);
 	}
 
-	bool Update(std::chrono::steady_clock::time_point now, bool force) {
-		bool modified = false;
-		for (auto &i : libraries)
-			if (i.Update(now, force))
-				modified = true;
-		return modified;
+	/**
+	 * Load plan files asynchronously in a worker thread instead
+	 * of blocking the caller.  Until a modified plan has been
+	 * loaded, the old one remains available.
+	 *
+	 * Throws on error.
+	 *
+	 * @param _modified_callback invoked after the library was
+	 * modified by a plan which has finished loading
+	 */
+	void EnableLoaderThread(EventLoop &event_loop,
+				BoundMethod<void() noexcept> _modified_callback);
+
+	/**
+	 * Stop the worker thread started by EnableLoaderThread().
+	 * Pending results are discarded.
+	 */
+	void StopLoaderThread() noexcept;
+
+	/**
+	 * Returns the inotify file descriptor which shall be polled
+	 * for #EPOLLIN; after it becomes readable, call Update().
+	 * Returns FileDescriptor::Undefined() if Update() has never
+	 * been called or if inotify is not available.
+	 */
+	FileDescriptor GetInotifyFileDescriptor() const noexcept {
+		return inotify_fd;
 	}
 
+	/**
+	 * Apply pending inotify events.  On the first call (or if
+	 * #force is true), all plan directories are loaded.  Every 60
+	 * seconds, all plans are revalidated (see
+	 * Library::Revalidate()), or, without inotify, all plan
+	 * directories are reloaded.
+	 *
+	 * @return true if at least one library was modified
+	 */
+	bool Update(std::chrono::steady_clock::time_point now, bool force) noexcept;
+
 	template<typename F>
 	void VisitAvailable(std::chrono::steady_clock::time_point now,
 			    F &&f) const {
@@ -35,6 +100,25 @@ public:
 			i.VisitAvailable(now, f);
 	}
 
+	/**
+	 * Look up a plan.  This does not check the file system; call
+	 * Update() to apply modifications.
+	 */
 	std::shared_ptr<Plan> Get(std::chrono::steady_clock::time_point now,
 				  const char *name);
+
+private:
+	void OnPlansLoaded(std::span<PlanLoaderThread::Result> results) noexcept;
+
+	/**
+	 * Throws on error.
+	 */
+	void OpenInotify();
+
+	/**
+	 * Read all pending inotify events.
+	 *
+	 * @return true if at least one library was modified
+	 */
+	bool ReadInotify(std::chrono::steady_clock::time_point now);
 };
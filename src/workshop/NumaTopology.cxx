@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "NumaTopology.hxx"
+#include "io/DirectoryReader.hxx"
+#include "io/FileAt.hxx"
+#include "io/Open.hxx"
+#include "io/SmallTextFile.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/NumberParser.hxx"
+#include "util/StringCompare.hxx"
+
+#include <algorithm> // for std::sort()
+#include <utility> // for std::pair
+
+#include <fcntl.h> // for O_DIRECTORY
+
+using std::string_view_literals::operator""sv;
+
+static std::string
+ReadCpuList(FileDescriptor directory_fd, const char *name)
+{
+	const auto path = std::string{name} + "/cpulist";
+	const auto fd = OpenReadOnly({directory_fd, path.c_str()});
+
+	for (std::string_view line : IterableSmallTextFile<4096>(fd))
+		return std::string{line};
+
+	return {};
+}
+
+void
+NumaTopology::Load(const char *path)
+{
+	const auto directory_fd = OpenPath(path, O_DIRECTORY);
+
+	std::vector<std::pair<unsigned, NumaNode>> found;
+
+	DirectoryReader dr{OpenDirectory({directory_fd, "."})};
+	while (const char *name = dr.Read()) {
+		std::string_view suffix = name;
+		if (!SkipPrefix(suffix, "node"sv))
+			continue;
+
+		const auto id = ParseInteger<unsigned>(suffix);
+		if (!id)
+			continue;
+
+		auto cpus = ReadCpuList(directory_fd, name);
+		if (cpus.empty())
+			/* a memory-only node */
+			continue;
+
+		found.emplace_back(*id, NumaNode{
+				.name = name,
+				.mems = std::string{suffix},
+				.cpus = std::move(cpus),
+			});
+	}
+
+	std::sort(found.begin(), found.end(), [](const auto &a, const auto &b){
+		return a.first < b.first;
+	});
+
+	nodes.clear();
+	next = 0;
+	for (auto &i : found)
+		nodes.emplace_back(std::move(i.second));
+}
+
+NumaNodeLease
+NumaTopology::Acquire() noexcept
+{
+	if (nodes.size() < 2)
+		return {};
+
+	std::size_t best = next;
+	for (std::size_t i = 1; i < nodes.size(); ++i) {
+		const std::size_t j = (next + i) % nodes.size();
+		if (nodes[j].n_processes < nodes[best].n_processes)
+			best = j;
+	}
+
+	next = (best + 1) % nodes.size();
+	return NumaNodeLease{nodes[best]};
+}
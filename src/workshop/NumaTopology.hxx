@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility> // for std::exchange()
+#include <vector>
+
+struct NumaNode {
+	/**
+	 * The sysfs directory name, e.g. "node0".
+	 */
+	std::string name;
+
+	/**
+	 * The node number (for "cpuset.mems").
+	 */
+	std::string mems;
+
+	/**
+	 * The CPUs of this node (for "cpuset.cpus").
+	 */
+	std::string cpus;
+
+	/**
+	 * The number of processes (jobs and pre-forked processes)
+	 * which are currently confined to this node.
+	 */
+	std::size_t n_processes = 0;
+};
+
+/**
+ * A process confined to a #NumaNode.  While this object exists,
+ * the process is counted in NumaNode::n_processes.
+ */
+class NumaNodeLease {
+	NumaNode *node = nullptr;
+
+public:
+	NumaNodeLease() noexcept = default;
+
+	explicit NumaNodeLease(NumaNode &_node) noexcept
+		:node(&_node)
+	{
+		++node->n_processes;
+	}
+
+	NumaNodeLease(NumaNodeLease &&src) noexcept
+		:node(std::exchange(src.node, nullptr)) {}
+
+	~NumaNodeLease() noexcept {
+		if (node != nullptr)
+			--node->n_processes;
+	}
+
+	NumaNodeLease &operator=(NumaNodeLease &&src) noexcept {
+		std::swap(node, src.node);
+		return *this;
+	}
+
+	/**
+	 * @return the node or nullptr if the process is not confined
+	 * to a node
+	 */
+	const NumaNode *get() const noexcept {
+		return node;
+	}
+};
+
+/**
+ * The NUMA nodes of this computer, used to spread the jobs of plans
+ * with "cpuset auto" over all nodes.
+ */
+class NumaTopology {
+	/**
+	 * All nodes which have CPUs, ordered by node number.
+	 */
+	std::vector<NumaNode> nodes;
+
+	std::size_t next = 0;
+
+public:
+	/**
+	 * Read the topology from sysfs.  This must not be called
+	 * while there are #NumaNodeLease instances.
+	 *
+	 * Throws on error.
+	 *
+	 * @param path the sysfs directory (may be overridden by unit
+	 * tests)
+	 */
+	void Load(const char *path="/sys/devices/system/node");
+
+	std::size_t size() const noexcept {
+		return nodes.size();
+	}
+
+	/**
+	 * Choose the node for a new process: the one with the fewest
+	 * processes (round-robin among equally loaded nodes).
+	 *
+	 * @return the node (or an empty lease if this is not a NUMA
+	 * machine, i.e. less than two nodes with CPUs)
+	 */
+	NumaNodeLease Acquire() noexcept;
+};
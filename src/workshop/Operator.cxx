@@ -10,9 +10,11 @@
 #include "Plan.hxx"
 #include "Job.hxx"
 #include "LogBridge.hxx"
+#include "PlanProcess.hxx"
 #include "translation/Response.hxx"
 #include "translation/ExecuteOptions.hxx"
 #include "translation/SpawnClient.hxx"
+#include "translation/Receive.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "spawn/Client.hxx"
 #include "spawn/CoEnqueue.hxx"
@@ -20,36 +22,50 @@
 #include "spawn/Interface.hxx"
 #include "spawn/Prepared.hxx"
 #include "spawn/ProcessHandle.hxx"
-#include "net/ConnectSocket.hxx"
 #include "net/EasyMessage.hxx"
+#include "net/ScmRightsBuilder.hxx"
+#include "net/SendMessage.hxx"
 #include "net/SocketPair.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
-#include "io/linux/MemFD.hxx"
 #include "io/FdHolder.hxx"
+#include "io/Iovec.hxx"
 #include "io/FileAt.hxx"
 #include "io/Open.hxx"
 #include "io/Pipe.hxx"
 #include "co/Task.hxx"
 #include "util/DeleteDisposer.hxx"
 #include "util/Exception.hxx" // for GetFullMessage()
+#include "util/SpanCast.hxx"
 #include "util/StringCompare.hxx"
 #include "util/StringList.hxx"
-#include "util/UTF8.hxx"
 #include "AllocatorPtr.hxx"
 #include "CgroupAccounting.hxx"
 #include "debug.h"
 
 #include <fmt/core.h>
 
+#include <algorithm> // for std::ranges::find()
+#include <array>
+#include <list>
+#include <vector>
 #include <tuple>
 
 #include <assert.h>
+#include <fcntl.h> // for O_RDWR
 #include <unistd.h>
 #include <string.h> // for strerror()
 #include <sys/wait.h>
 
 using std::string_view_literals::operator""sv;
 
+/**
+ * How often is the resource usage of a running job sampled?  Each
+ * sample reads about 7 small cgroup files synchronously; these are
+ * generated by the kernel without disk I/O, so this is cheap enough
+ * to do in the event loop.
+ */
+static constexpr Event::Duration RESOURCE_SAMPLE_INTERVAL = std::chrono::seconds{10};
+
 class WorkshopOperator::SpawnedProcess final
 	: ExitListener, public AutoUnlinkIntrusiveListHook
 {
@@ -73,12 +89,14 @@ private:
 
 WorkshopOperator::WorkshopOperator(EventLoop &_event_loop,
 				   WorkshopWorkplace &_workplace,
-				   const WorkshopJob &_job,
-				   const std::shared_ptr<Plan> &_plan) noexcept
+				   WorkshopJob &&_job,
+				   std::shared_ptr<Plan> &&_plan) noexcept
 	:event_loop(_event_loop),
-	 workplace(_workplace), job(_job), plan(_plan),
+	 workplace(_workplace), job(std::move(_job)), plan(std::move(_plan)),
 	 logger(*this),
-	 timeout_event(event_loop, BIND_THIS_METHOD(OnTimeout))
+	 timeout_event(event_loop, BIND_THIS_METHOD(OnTimeout)),
+	 batch_timer(event_loop, BIND_THIS_METHOD(OnBatchTimer)),
+	 resource_sample_timer(event_loop, BIND_THIS_METHOD(OnResourceSampleTimer))
 {
 	ScheduleTimeout();
 }
@@ -86,6 +104,26 @@ WorkshopOperator::WorkshopOperator(EventLoop &_event_loop,
 WorkshopOperator::~WorkshopOperator() noexcept
 {
 	children.clear_and_dispose(DeleteDisposer{});
+
+	if (plan->batch > 0) {
+		workplace.OnBatchLaunched(*this);
+
+		/* the remaining jobs of this batch have not been
+		   finished; give them back to the queue */
+		for (auto &i : batch)
+			if (!canceled_batch_jobs.contains(i.id))
+				i.SetAgain(std::chrono::seconds{}, nullptr);
+	}
+
+	if (plan->worker > 0)
+		/* give the worker process back to the pool (unless
+		   it has not reported "done", e.g. after a timeout;
+		   then it gets killed and replaced) */
+		workplace.ReleaseWorker(job.plan_name, *plan,
+					worker && worker->handle
+					? worker.get()
+					: nullptr,
+					worker_busy);
 }
 
 bool
@@ -98,23 +136,50 @@ inline UniqueFileDescriptor
 WorkshopOperator::InitLog(std::size_t max_log_buffer,
 			  bool enable_journal)
 {
-	assert(!log);
-
 	auto [stderr_r, stderr_w] = CreatePipe();
 	stderr_r.SetNonBlocking();
 
-	log.emplace(event_loop, job.plan_name, job.id, std::move(stderr_r));
+	InitLogBridge(std::move(stderr_r), max_log_buffer, enable_journal);
+
+	if (plan->control_channel && plan->allow_spawn)
+		stderr_write_pipe = stderr_w.Duplicate();
+
+	return std::move(stderr_w);
+}
+
+inline void
+WorkshopOperator::InitLogBridge(UniqueFileDescriptor &&stderr_r,
+				std::size_t max_log_buffer,
+				bool enable_journal) noexcept
+{
+	assert(!log);
+
+	UniqueFileDescriptor spool_file;
+	if (const auto spool = workplace.GetLogSpool(); !spool.empty()) {
+		log_file = fmt::format("{}/{}.log"sv, spool, job.id);
+		/* the output may contain secrets, so only our own
+		   user may read it */
+		if (spool_file.Open(log_file.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0600)) {
+			job.SetLogFile(log_file.c_str());
+		} else {
+			logger(1, "Failed to create ", log_file, ": ",
+			       strerror(errno));
+			log_file.clear();
+		}
+	}
+
+	log.emplace(event_loop, logger, job.plan_name, job.id, std::move(stderr_r),
+		    std::move(spool_file));
 
 	if (max_log_buffer > 0)
 		log->EnableBuffer(max_log_buffer);
 
 	if (enable_journal)
-		log->EnableJournal();
-
-	if (plan->control_channel && plan->allow_spawn)
-		stderr_write_pipe = stderr_w.Duplicate();
+		log->EnableJournal(workplace.GetJournalRate());
 
-	return std::move(stderr_w);
+	if (const auto pond_socket = workplace.GetPondSocket();
+	    pond_socket.IsDefined())
+		log->EnablePond(pond_socket);
 }
 
 inline UniqueSocketDescriptor
@@ -136,10 +201,14 @@ WorkshopOperator::InitControl()
 	return std::move(control_child);
 }
 
+/**
+ * Check whether the translation response is usable for spawning a
+ * job process.
+ *
+ * Throws on error.
+ */
 static void
-PrepareChildProcess(AllocatorPtr alloc,
-		    PreparedChildProcess &p, const TranslateResponse &response,
-		    FdHolder &close_fds)
+CheckTranslateResponse(const TranslateResponse &response)
 {
 	if (response.status != HttpStatus{}) {
 		if (response.message != nullptr)
@@ -159,7 +228,16 @@ PrepareChildProcess(AllocatorPtr alloc,
 
 	if (options.child_options.uid_gid.IsEmpty() && !debug_mode)
 		throw std::runtime_error("No UID_GID from translation server");
+}
 
+static void
+PrepareChildProcess(AllocatorPtr alloc,
+		    PreparedChildProcess &p, const TranslateResponse &response,
+		    FdHolder &close_fds)
+{
+	CheckTranslateResponse(response);
+
+	const auto &options = *response.execute_options;
 
 	p.args.push_back(alloc.Dup(options.execute));
 
@@ -189,47 +267,271 @@ PrepareChildProcess(AllocatorPtr alloc, PreparedChildProcess &p,
 	p.stderr_fd = p.stdout_fd = stderr_fd;
 	p.control_fd = control_fd.ToFileDescriptor();
 
-	if (plan.translate) {
+	if (plan.translate)
 		PrepareChildProcess(alloc, p, translation, close_fds);
-	} else {
-		p.hook_info = plan_name;
-
-		if (!debug_mode) {
-			p.uid_gid.effective_uid = plan.uid;
-			p.uid_gid.effective_gid = plan.gid;
+	else
+		PreparePlanChildProcess(p, plan_name, plan);
 
-			std::copy(plan.groups.begin(), plan.groups.end(),
-				  p.uid_gid.supplementary_groups.begin());
-		}
+}
 
-		if (!plan.chroot.empty())
-			p.chroot = plan.chroot.c_str();
+void
+WorkshopOperator::Start(std::size_t max_log_buffer,
+			bool enable_journal) noexcept
+{
+	assert(!task);
 
-		p.umask = plan.umask;
-		p.rlimits = plan.rlimits;
-		p.priority = plan.priority;
-		p.sched_idle = plan.sched_idle;
-		p.ioprio_idle = plan.ioprio_idle;
-		p.ns.enable_network = plan.private_network;
+	task = Start2(max_log_buffer, enable_journal);
+	task.Start(BIND_THIS_METHOD(OnTaskCompletion));
+}
 
-		if (plan.private_tmp)
-			p.ns.mount.mount_tmp_tmpfs = "";
+void
+WorkshopOperator::Start(std::size_t max_log_buffer,
+			bool enable_journal,
+			PlanProcess &&process) noexcept
+{
+	assert(!task);
 
-		p.no_new_privs = true;
+	try {
+		Adopt(max_log_buffer, enable_journal, std::move(process),
+		      "start"sv);
+	} catch (...) {
+		OnTaskCompletion(std::current_exception());
 	}
+}
 
+void
+WorkshopOperator::CollectBatch(std::size_t max_log_buffer,
+			       bool enable_journal) noexcept
+{
+	assert(!task);
+
+	batch_max_log_buffer = max_log_buffer;
+	batch_enable_journal = enable_journal;
+	batch_timer.Schedule(plan->batch_window);
 }
 
 void
-WorkshopOperator::Start(std::size_t max_log_buffer,
-			bool enable_journal) noexcept
+WorkshopOperator::LaunchBatch() noexcept
 {
 	assert(!task);
 
-	task = Start2(max_log_buffer, enable_journal);
+	batch_timer.Cancel();
+
+	task = StartBatch(batch_max_log_buffer, batch_enable_journal);
 	task.Start(BIND_THIS_METHOD(OnTaskCompletion));
 }
 
+bool
+WorkshopOperator::CancelBatchJob(std::string_view id) noexcept
+{
+	auto i = std::ranges::find(batch, id, &WorkshopJob::id);
+	if (i == batch.end() || canceled_batch_jobs.contains(id))
+		return false;
+
+	logger(2, "cancel batch job ", id);
+
+	i->SetDone(-ECANCELED, "Canceled");
+
+	if (batch_timer.IsPending())
+		/* still collecting: the process has not seen this
+		   job yet */
+		batch.erase(i);
+	else
+		/* the process has received this job already and
+		   will report "done" for it */
+		canceled_batch_jobs.emplace(id);
+
+	return true;
+}
+
+void
+WorkshopOperator::OnBatchTimer() noexcept
+{
+	workplace.OnBatchLaunched(*this);
+	LaunchBatch();
+}
+
+inline Co::InvokeTask
+WorkshopOperator::StartBatch(std::size_t max_log_buffer,
+			     bool enable_journal)
+{
+	auto process = co_await SpawnPlanProcess(workplace.GetSpawnService(),
+						 job.plan_name.c_str(), *plan,
+						 job.id.c_str(),
+						 AcquireNumaNode());
+
+	Adopt(max_log_buffer, enable_journal, std::move(process), "job"sv);
+}
+
+void
+WorkshopOperator::StartWorker(std::size_t max_log_buffer,
+			      bool enable_journal,
+			      std::optional<PlanProcess> &&process,
+			      bool busy) noexcept
+{
+	assert(!task);
+
+	worker_busy = busy;
+
+	if (process) {
+		try {
+			AdoptWorker(max_log_buffer, enable_journal,
+				    std::move(*process));
+		} catch (...) {
+			OnTaskCompletion(std::current_exception());
+		}
+	} else {
+		task = SpawnWorker(max_log_buffer, enable_journal);
+		task.Start(BIND_THIS_METHOD(OnTaskCompletion));
+	}
+}
+
+/**
+ * Append a NUL-separated field to a control channel message.
+ */
+static void
+AppendField(std::string &msg, std::string_view value) noexcept
+{
+	msg.push_back('\0');
+	msg.append(value);
+}
+
+inline void
+WorkshopOperator::SendStart(SocketDescriptor control,
+			    std::string_view command,
+			    WorkshopJob &_job)
+{
+	for (const auto &i : _job.env) {
+		if (StringStartsWith(i.c_str(), "LD_"))
+			/* reject - too dangerous */
+			continue;
+
+		std::string msg{"setenv"sv};
+		AppendField(msg, i);
+
+		const struct iovec v[]{MakeIovec(AsBytes(msg))};
+		SendMessage(control, MessageHeader{std::span{v}}, MSG_NOSIGNAL);
+	}
+
+	const std::array<std::string_view, Plan::VARIABLES.size()> values{
+		plan->GetExecutablePath(),
+		workplace.GetNodeName(),
+		_job.id,
+		_job.plan_name,
+	};
+
+	std::string msg{command};
+	AppendField(msg, _job.id);
+
+	for (const auto &i : _job.args) {
+		if (i.find("${"sv) == i.npos)
+			AppendField(msg, i);
+		else
+			AppendField(msg, ExpandTemplate{i, Plan::VARIABLES}.Expand(values));
+	}
+
+	const struct iovec v[]{MakeIovec(AsBytes(msg))};
+	MessageHeader header{std::span{v}};
+
+	if (_job.stdin.IsDefined()) {
+		/* pass stdin as a file descriptor */
+		ScmRightsBuilder<1> b(header);
+		b.push_back(_job.stdin.Get());
+		b.Finish(header);
+
+		SendMessage(control, header, MSG_NOSIGNAL);
+	} else
+		SendMessage(control, header, MSG_NOSIGNAL);
+
+	_job.ReleaseStartData();
+}
+
+inline void
+WorkshopOperator::Adopt(std::size_t max_log_buffer, bool enable_journal,
+			PlanProcess &&process, std::string_view command)
+{
+	assert(!pid);
+	assert(!control_channel);
+	assert(plan->control_channel);
+
+	InitLogBridge(std::move(process.stderr_r),
+		      max_log_buffer, enable_journal);
+
+	pid = std::move(process.handle);
+	pid->SetExitListener(*this);
+	numa_node = std::move(process.numa_node);
+
+	SendStart(process.control, command, job);
+
+	/* a batch process gets all of its jobs at once */
+	for (auto &i : batch)
+		SendStart(process.control, command, i);
+
+	WorkshopControlChannelHandler &handler = *this;
+	control_channel = std::make_unique<WorkshopControlChannelServer>(event_loop,
+									 std::move(process.control),
+									 handler);
+
+	if (batch.empty())
+		logger(2, "job ", job.id, " (plan '", job.plan_name,
+		       "') started in pre-forked process");
+	else
+		logger(2, "job ", job.id, " (plan '", job.plan_name,
+		       "') started with a batch of ", GetBatchSize(), " jobs");
+
+	if (process.cgroup.IsDefined()) {
+		memory_peak_shared = process.reused;
+		SetCgroup(process.cgroup);
+	}
+}
+
+inline void
+WorkshopOperator::AdoptWorker(std::size_t max_log_buffer, bool enable_journal,
+			      PlanProcess &&process)
+{
+	assert(!pid);
+	assert(!worker);
+	assert(!control_channel);
+	assert(plan->control_channel);
+
+	worker = std::make_unique<PlanProcess>(std::move(process));
+
+	InitLogBridge(worker->stderr_r.Duplicate(),
+		      max_log_buffer, enable_journal);
+
+	pid = std::move(worker->handle);
+	pid->SetExitListener(*this);
+
+	SendStart(worker->control, "job"sv, job);
+
+	WorkshopControlChannelHandler &handler = *this;
+	control_channel = std::make_unique<WorkshopControlChannelServer>(event_loop,
+									 UniqueSocketDescriptor{worker->control.ToFileDescriptor().Duplicate()},
+									 handler);
+
+	logger(2, "job ", job.id, " (plan '", job.plan_name,
+	       "') started in worker process");
+
+	if (worker->cgroup.IsDefined()) {
+		memory_peak_shared = worker->reused;
+		SetCgroup(worker->cgroup);
+	}
+}
+
+inline Co::InvokeTask
+WorkshopOperator::SpawnWorker(std::size_t max_log_buffer,
+			      bool enable_journal)
+{
+	/* no idle worker is available; spawn a new one which will
+	   join the pool after this job */
+	auto process = co_await SpawnPlanProcess(workplace.GetSpawnService(),
+						 job.plan_name.c_str(), *plan,
+						 job.id.c_str(),
+						 AcquireNumaNode());
+
+	AdoptWorker(max_log_buffer, enable_journal, std::move(process));
+}
+
 inline Co::InvokeTask
 WorkshopOperator::Start2(std::size_t max_log_buffer,
 			 bool enable_journal)
@@ -239,17 +541,46 @@ WorkshopOperator::Start2(std::size_t max_log_buffer,
 	Allocator alloc;
 	TranslateResponse translation;
 	if (plan->translate) {
-		const auto translation_socket = workplace.GetTranslationSocket();
-		if (translation_socket == nullptr)
+		auto *const translation_service = workplace.GetTranslationService();
+		if (translation_service == nullptr)
 			throw std::runtime_error{"No 'translation_server' configured"};
 
-		translation = co_await
-			TranslateSpawn(event_loop, alloc,
-				       CreateConnectSocket(translation_socket, SOCK_STREAM),
-				       workplace.GetListenerTag(),
-				       job.plan_name.c_str(),
-				       "", nullptr,
-				       job.args);
+		auto &cache = workplace.GetTranslationCache();
+		const bool use_cache = plan->translate_cache && cache.IsEnabled();
+
+		std::string cache_key;
+		std::span<const std::byte> cached;
+		if (use_cache) {
+			cache_key = TranslationCache::MakeKey(job.plan_name,
+							      workplace.GetListenerTag(),
+							      job.args,
+							      plan->translate_cache_args);
+			cached = cache.Get(cache_key, event_loop.SteadyNow());
+		}
+
+		if (!cached.empty()) {
+			translation = ParseTranslateResponse(alloc, cached);
+		} else {
+			std::vector<std::byte> raw_response;
+
+			translation = co_await
+				TranslateSpawn(*translation_service, alloc,
+					       workplace.GetListenerTag(),
+					       job.plan_name.c_str(),
+					       "", nullptr,
+					       job.args,
+					       use_cache ? &raw_response : nullptr);
+
+			/* only cache responses which can be used to
+			   spawn a process; errors (even those with
+			   MAX_AGE) must not be replayed */
+			CheckTranslateResponse(translation);
+
+			if (use_cache)
+				cache.Put(std::move(cache_key), job.plan_name,
+					  std::move(raw_response),
+					  event_loop.SteadyNow());
+		}
 
 		if (translation.execute_options != nullptr &&
 		    !translation.execute_options->child_options.tag.empty() &&
@@ -276,8 +607,8 @@ WorkshopOperator::Start2(std::size_t max_log_buffer,
 			    stderr_w, control_child,
 			    close_fds);
 
-	if (job.stdin != nullptr)
-		p.stdin_fd = close_fds.Insert(CreateMemFD("stdin", job.stdin));
+	if (job.stdin.IsDefined())
+		p.stdin_fd = close_fds.Insert(std::move(job.stdin));
 
 	/* use a per-plan cgroup */
 
@@ -288,7 +619,10 @@ WorkshopOperator::Start2(std::size_t max_log_buffer,
 	if (auto *client = dynamic_cast<SpawnServerClient *>(&spawn_service);
 	    client != nullptr && client->SupportsCgroups()) {
 		if (p.cgroup == nullptr) {
-			cgroup.name = job.plan_name.c_str();
+			numa_node = AcquireNumaNode();
+			PreparePlanCgroup(alloc, cgroup,
+					  job.plan_name.c_str(), *plan,
+					  numa_node.get());
 			p.cgroup = &cgroup;
 		}
 
@@ -310,19 +644,42 @@ WorkshopOperator::Start2(std::size_t max_log_buffer,
 
 	/* build command line */
 
+	/* owns the expanded arguments */
 	std::list<std::string> args;
 
 	if (!plan->translate) {
-		args.insert(args.end(), plan->args.begin(), plan->args.end());
-		args.insert(args.end(), job.args.begin(), job.args.end());
-
-		Expand(args);
-
-		for (const auto &i : args) {
-			if (p.args.size() >= 4096)
-				throw std::runtime_error("Too many command-line arguments");
+		if (plan->args.size() + job.args.size() > 4096)
+			throw std::runtime_error("Too many command-line arguments");
+
+		const std::array<std::string_view, Plan::VARIABLES.size()> values{
+			plan->GetExecutablePath(),
+			workplace.GetNodeName(),
+			job.id,
+			job.plan_name,
+		};
+
+		/* the program name is not expanded */
+		p.args.push_back(plan->GetExecutablePath().c_str());
+
+		/* the plan's arguments have been compiled by
+		   Plan::Compile() */
+		for (std::size_t i = 0; i < plan->arg_templates.size(); ++i) {
+			const auto &t = plan->arg_templates[i];
+			if (t.IsConstant()) {
+				p.args.push_back(plan->args[i + 1].c_str());
+			} else {
+				args.emplace_back(t.Expand(values));
+				p.args.push_back(args.back().c_str());
+			}
+		}
 
-			p.args.push_back(i.c_str());
+		for (const auto &i : job.args) {
+			if (i.find("${"sv) == i.npos) {
+				p.args.push_back(i.c_str());
+			} else {
+				args.emplace_back(ExpandTemplate{i, Plan::VARIABLES}.Expand(values));
+				p.args.push_back(args.back().c_str());
+			}
 		}
 	}
 
@@ -342,6 +699,11 @@ WorkshopOperator::Start2(std::size_t max_log_buffer,
 	pid = spawn_service.SpawnChildProcess(job.id.c_str(), std::move(p));
 	co_await CoWaitSpawnCompletion{*pid};
 
+	/* the spawner has its copy now; we don't need the arguments
+	   and the stdin buffer anymore, free them to keep the memory
+	   footprint of long-running jobs small */
+	job.ReleaseStartData();
+
 	pid->SetExitListener(*this);
 
 	logger(2, "job ", job.id, " (plan '", job.plan_name,
@@ -415,11 +777,30 @@ WorkshopOperator::OnProgress(unsigned progress) noexcept
 		return;
 
 	job.SetProgress(progress, plan->timeout.c_str(), plan->notify_progress);
+	TouchBatch();
 
 	/* refresh the timeout */
 	ScheduleTimeout();
 }
 
+NumaNodeLease
+WorkshopOperator::AcquireNumaNode() noexcept
+{
+	if (!plan->cpuset_auto)
+		return {};
+
+	return workplace.AcquireNumaNode();
+}
+
+const NumaNode *
+WorkshopOperator::GetNumaNode() const noexcept
+{
+	if (worker)
+		return worker->numa_node.get();
+
+	return numa_node.get();
+}
+
 void
 WorkshopOperator::SetCgroup(FileDescriptor fd) noexcept
 {
@@ -431,35 +812,39 @@ WorkshopOperator::SetCgroup(FileDescriptor fd) noexcept
 			       std::current_exception());
 		}
 	}
+
+	cgroup_directory = fd.Duplicate();
+	if (cgroup_directory.IsDefined()) {
+		resource_usage_start = resource_usage =
+			ReadCgroupResourceUsage(cgroup_directory);
+		resource_sample_timer.Schedule(RESOURCE_SAMPLE_INTERVAL);
+	}
 }
 
-void
-WorkshopOperator::SetOutput(UniqueFileDescriptor fd) noexcept
+inline void
+WorkshopOperator::SampleResourceUsage() noexcept
 {
-	assert(fd.IsDefined());
-	assert(!progress_reader);
+	assert(cgroup_directory.IsDefined());
 
-	progress_reader.reset(new ProgressReader(event_loop, std::move(fd),
-						 BIND_THIS_METHOD(OnProgress)));
+	resource_usage.Update(ReadCgroupResourceUsage(cgroup_directory));
+}
 
+void
+WorkshopOperator::OnResourceSampleTimer() noexcept
+{
+	SampleResourceUsage();
+	resource_sample_timer.Schedule(RESOURCE_SAMPLE_INTERVAL);
 }
 
 void
-WorkshopOperator::Expand(std::list<std::string> &args) const noexcept
+WorkshopOperator::SetOutput(UniqueFileDescriptor fd) noexcept
 {
-	assert(!args.empty());
+	assert(fd.IsDefined());
+	assert(!progress_reader);
 
-	StringMap vars;
-	vars.emplace("0"sv, args.front());
-	vars.emplace("NODE"sv, workplace.GetNodeName());
-	vars.emplace("JOB"sv, job.id);
-	vars.emplace("PLAN"sv, job.plan_name);
+	progress_reader.reset(new ProgressReader(event_loop, std::move(fd),
+						 BIND_THIS_METHOD(OnProgress)));
 
-	/* expand all parameters, but not the program name; this
-	   wouldn't work because a pointer to it is in the "vars"
-	   map */
-	for (auto i = std::next(args.begin()); i != args.end(); ++i)
-		::Expand(*i, vars);
 }
 
 void
@@ -499,33 +884,116 @@ WorkshopOperator::OnChildProcessExit(int status) noexcept
 	} else
 		exit_status = -ECHILD;
 
+	Finish(exit_status);
+}
+
+void
+WorkshopOperator::Finish(int exit_status) noexcept
+{
+	SubmitResult(exit_status);
+
+	workplace.OnExit(this);
+}
+
+void
+WorkshopOperator::SubmitResult(int exit_status) noexcept
+{
+	/* the log text has already been sanitized by the
+	   LogBridge */
 	const char *log_text = log->GetBuffer();
-	if (log_text != nullptr && !ValidateUTF8(log_text)) {
-		/* TODO: purge illegal UTF-8 sequences instead of
-		   replacing the log text? */
-		log_text = "Invalid UTF-8 output";
-		logger(2, log_text);
-	}
 
 	if (cpu_usage_start.count() >= 0) {
 		assert(cgroup_cpu_stat.IsDefined());
 
 		try {
 			const auto cpu_usage_end = ReadCgroupCpuUsage(cgroup_cpu_stat);
-			if (cpu_usage_end.count() >= 0)
+			if (cpu_usage_end.count() >= 0) {
 				job.AddCpuUsage(cpu_usage_end - cpu_usage_start);
+
+				/* the next job of a batch starts
+				   counting here */
+				cpu_usage_start = cpu_usage_end;
+			}
 		} catch (...) {
 			logger(1, "Failed to read CPU usage: ",
 			       std::current_exception());
 		}
 	}
 
+	if (cgroup_directory.IsDefined()) {
+		SampleResourceUsage();
+
+		auto usage = resource_usage.Since(resource_usage_start);
+		if (memory_peak_shared)
+			usage.memory_peak.reset();
+		job.AddResourceUsage(usage);
+
+		/* the next job of a batch starts counting here; its
+		   peak memory usage cannot be separated from this
+		   one's */
+		resource_usage_start = resource_usage;
+		memory_peak_shared = true;
+	}
+
+	if (canceled_batch_jobs.erase(job.id) > 0)
+		/* this batch job has already been canceled */
+		return;
+
 	if (again >= std::chrono::seconds())
 		job.SetAgain(again, log_text);
 	else
 		job.SetDone(exit_status, log_text);
+}
 
-	workplace.OnExit(this);
+void
+WorkshopOperator::TouchBatch() noexcept
+{
+	if (batch.empty())
+		return;
+
+	std::vector<std::string_view> ids;
+	ids.reserve(batch.size());
+	for (const auto &i : batch)
+		ids.emplace_back(i.id);
+
+	job.queue.TouchJobs(ids, plan->timeout.c_str());
+}
+
+inline bool
+WorkshopOperator::OnBatchDone(int status) noexcept
+{
+	/* catch up with the log lines the job has written before
+	   reporting "done" */
+	log->Flush();
+
+	if (batch.empty()) {
+		/* this was the last job of the batch; the process
+		   is not needed anymore */
+		exited = true;
+		Finish(status);
+		return false;
+	}
+
+	logger(3, "batch job done with status ", status);
+
+	SubmitResult(status);
+
+	/* advance to the next job */
+	again = std::chrono::seconds(-1);
+	log->ClearBuffer();
+	job = std::move(batch.front());
+	batch.pop_front();
+
+	/* all jobs of a batch share one log file */
+	if (!log_file.empty())
+		job.SetLogFile(log_file.c_str());
+
+	TouchBatch();
+
+	/* the next job gets a fresh timeout */
+	ScheduleTimeout();
+
+	return true;
 }
 
 std::string
@@ -556,9 +1024,45 @@ WorkshopOperator::OnControlAgain(std::chrono::seconds d) noexcept
 	again = d;
 }
 
+bool
+WorkshopOperator::OnControlDone(int status) noexcept
+{
+	if (plan->batch > 0)
+		return OnBatchDone(status);
+
+	if (!worker) {
+		OnControlTemporaryError(std::make_exception_ptr(std::runtime_error{"'done' is only allowed in worker and batch plans"}));
+		return true;
+	}
+
+	assert(pid);
+
+	/* the process lives on; it will be given back to the pool
+	   by our destructor (which is called synchronously by
+	   Finish(), therefore the ExitListener doesn't need to be
+	   reset here) */
+	worker->handle = std::move(pid);
+
+	/* no progress updates after this point */
+	exited = true;
+
+	/* catch up with the log lines the job has written before
+	   reporting "done" */
+	log->Flush();
+
+	if (status == 0)
+		logger(3, "done with success");
+	else
+		logger(2, "done with status ", status);
+
+	Finish(status);
+	return false;
+}
+
 static std::pair<std::unique_ptr<ChildProcessHandle>, UniqueSocketDescriptor>
 DoSpawn(SpawnService &service, AllocatorPtr alloc,
 	const WorkshopJob &job, const Plan &plan,
+	const NumaNode *numa_node,
 	const char *token,
 	FileDescriptor stderr_w,
 	const TranslateResponse &response)
@@ -590,7 +1094,9 @@ DoSpawn(SpawnService &service, AllocatorPtr alloc,
 				   fall back to the plan cgroup */
 				p.cgroup = &cgroup;
 
-				cgroup.name = job.plan_name.c_str();
+				PreparePlanCgroup(alloc, cgroup,
+						  job.plan_name.c_str(), plan,
+						  numa_node);
 			}
 
 			p.cgroup_session = job.id.c_str();
@@ -610,8 +1116,8 @@ WorkshopOperator::OnControlSpawn(const char *token, const char *param)
 		throw FmtRuntimeError("Plan {:?} does not have the 'allow_spawn' flag",
 				      job.plan_name);
 
-	const auto translation_socket = workplace.GetTranslationSocket();
-	if (translation_socket == nullptr)
+	auto *const translation_service = workplace.GetTranslationService();
+	if (translation_service == nullptr)
 		throw std::runtime_error{"No 'translation_server' configured"};
 
 	if (exited)
@@ -619,8 +1125,7 @@ WorkshopOperator::OnControlSpawn(const char *token, const char *param)
 
 	Allocator alloc;
 	const auto response = co_await
-		TranslateSpawn(event_loop, alloc,
-			       CreateConnectSocket(translation_socket, SOCK_STREAM),
+		TranslateSpawn(*translation_service, alloc,
 			       workplace.GetListenerTag(),
 			       job.plan_name.c_str(),
 			       token, param,
@@ -636,7 +1141,7 @@ WorkshopOperator::OnControlSpawn(const char *token, const char *param)
 	co_await CoEnqueueSpawner{spawn_service};
 
 	auto [handle, return_pidfd] =
-		DoSpawn(spawn_service, alloc, job, *plan,
+		DoSpawn(spawn_service, alloc, job, *plan, GetNumaNode(),
 			token, stderr_write_pipe, response);
 
 	co_await CoWaitSpawnCompletion{*handle};
@@ -6,23 +6,28 @@
 
 #include "Job.hxx"
 #include "LogBridge.hxx"
+#include "CgroupAccounting.hxx"
+#include "NumaTopology.hxx"
 #include "ControlChannelHandler.hxx"
 #include "spawn/ExitListener.hxx"
 #include "spawn/ProcessHandle.hxx"
 #include "event/FarTimerEvent.hxx"
+#include "event/FineTimerEvent.hxx"
 #include "io/Logger.hxx"
 #include "io/UniqueFileDescriptor.hxx"
 #include "co/InvokeTask.hxx"
 #include "util/IntrusiveList.hxx"
 
 #include <exception>
+#include <list>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
-#include <list>
 #include <chrono>
 
 struct Plan;
+struct PlanProcess;
 class WorkshopWorkplace;
 class ProgressReader;
 class WorkshopControlChannelServer;
@@ -66,6 +71,33 @@ class WorkshopOperator final
 
 	FarTimerEvent timeout_event;
 
+	/**
+	 * More jobs of this batch (plan option "batch") which will be
+	 * executed by the same process after #job, in this order.
+	 * Each time the process reports "done", the first one
+	 * replaces #job.
+	 */
+	std::list<WorkshopJob> batch;
+
+	/**
+	 * Jobs in #batch which have been canceled after the batch
+	 * process has received them.  The process still reports
+	 * "done" for them, but this result is discarded.
+	 */
+	std::set<std::string, std::less<>> canceled_batch_jobs;
+
+	/**
+	 * Launches the batch process after #Plan::batch_window has
+	 * passed.
+	 */
+	FineTimerEvent batch_timer;
+
+	/**
+	 * Parameters for LaunchBatch(), saved by CollectBatch().
+	 */
+	std::size_t batch_max_log_buffer = 0;
+	bool batch_enable_journal = false;
+
 	std::unique_ptr<ProgressReader> progress_reader;
 
 	std::unique_ptr<WorkshopControlChannelServer> control_channel;
@@ -82,8 +114,64 @@ class WorkshopOperator final
 	 */
 	UniqueFileDescriptor cgroup_cpu_stat;
 
+	/**
+	 * The cgroup2 directory of the job process; used to sample
+	 * its resource usage.
+	 */
+	UniqueFileDescriptor cgroup_directory;
+
+	/**
+	 * Samples the resource usage periodically while the job is
+	 * running, so the last values are known even if the cgroup
+	 * has already been deleted when the job finishes.
+	 */
+	FarTimerEvent resource_sample_timer;
+
+	/**
+	 * The resource usage counters when the current job was
+	 * started and the most recent sample.
+	 */
+	CgroupResourceUsage resource_usage_start, resource_usage;
+
+	/**
+	 * Does the cgroup's peak memory usage include other jobs
+	 * (a reused worker/prefork process or a batch after its first
+	 * job)?  Then "memory_peak" is not submitted.
+	 */
+	bool memory_peak_shared = false;
+
 	std::optional<LogBridge> log;
 
+	/**
+	 * The path of the spool file which receives the stderr
+	 * output (configuration setting "log_spool"); empty if
+	 * disabled.
+	 */
+	std::string log_file;
+
+	/**
+	 * The worker process executing this job (plan option
+	 * "worker").  Its file descriptors are only lent (duplicated)
+	 * to #log and #control_channel, and the process is given back
+	 * to the #WorkshopWorkplace after the job has finished.  The
+	 * "handle" field is only set after the process has reported
+	 * "done"; until then, it lives in #pid.
+	 */
+	std::unique_ptr<PlanProcess> worker;
+
+	/**
+	 * Was this operator accounted as busy by the worker pool?
+	 * See PreforkPool::Take().
+	 */
+	bool worker_busy = false;
+
+	/**
+	 * The NUMA node the job process was confined to (plan option
+	 * "cpuset auto"); empty if none or if the process is a
+	 * #worker (which has its own PlanProcess::numa_node).
+	 */
+	NumaNodeLease numa_node;
+
 	class SpawnedProcess;
 
 	/**
@@ -96,8 +184,8 @@ class WorkshopOperator final
 
 public:
 	WorkshopOperator(EventLoop &_event_loop,
-			 WorkshopWorkplace &_workplace, const WorkshopJob &_job,
-			 const std::shared_ptr<Plan> &_plan) noexcept;
+			 WorkshopWorkplace &_workplace, WorkshopJob &&_job,
+			 std::shared_ptr<Plan> &&_plan) noexcept;
 
 	WorkshopOperator(const WorkshopOperator &other) = delete;
 
@@ -113,16 +201,76 @@ public:
 		return job.plan_name;
 	}
 
+	/**
+	 * Is this the current job?  Jobs waiting in #batch are not
+	 * checked; see CancelBatchJob().
+	 */
 	bool IsId(std::string_view id) const noexcept {
 		return job.id == id;
 	}
 
+	/**
+	 * Cancel one of the jobs in #batch (i.e. not the current
+	 * one, see IsId()).
+	 *
+	 * @return true if the job was found
+	 */
+	bool CancelBatchJob(std::string_view id) noexcept;
+
+	/**
+	 * The number of jobs in this batch which have not yet
+	 * finished.
+	 */
+	std::size_t GetBatchSize() const noexcept {
+		return 1 + batch.size();
+	}
+
+	/**
+	 * Add another job to this batch.  This is only allowed
+	 * between CollectBatch() and LaunchBatch().
+	 */
+	void AddBatchJob(WorkshopJob &&_job) noexcept {
+		batch.emplace_back(std::move(_job));
+	}
+
 	[[gnu::pure]]
 	bool IsChildTag(std::string_view value) const noexcept;
 
 	void Start(std::size_t max_log_buffer,
 		   bool enable_journal) noexcept;
 
+	/**
+	 * Start the job in a pre-forked process (plan option
+	 * "prefork") which is waiting on its control channel.
+	 */
+	void Start(std::size_t max_log_buffer,
+		   bool enable_journal,
+		   PlanProcess &&process) noexcept;
+
+	/**
+	 * Start the job in a worker process (plan option "worker").
+	 * If no idle worker was available, a new one is spawned.
+	 *
+	 * @param busy the value returned by PreforkPool::Take()
+	 */
+	void StartWorker(std::size_t max_log_buffer,
+			 bool enable_journal,
+			 std::optional<PlanProcess> &&process,
+			 bool busy) noexcept;
+
+	/**
+	 * Begin collecting jobs for a batch (plan option "batch").
+	 * The process is launched when #Plan::batch_window has passed
+	 * or when LaunchBatch() is called.
+	 */
+	void CollectBatch(std::size_t max_log_buffer,
+			  bool enable_journal) noexcept;
+
+	/**
+	 * Stop collecting jobs and launch the batch process now.
+	 */
+	void LaunchBatch() noexcept;
+
 	/**
 	 * Kill the process and put the database record in a complete
 	 * and failed state, but do not invoke the #WorkshopWorkplace
@@ -141,13 +289,52 @@ private:
 
 	UniqueFileDescriptor InitLog(std::size_t max_log_buffer,
 				     bool enable_journal);
+	void InitLogBridge(UniqueFileDescriptor &&stderr_r,
+			   std::size_t max_log_buffer,
+			   bool enable_journal) noexcept;
+
+	void Adopt(std::size_t max_log_buffer, bool enable_journal,
+		   PlanProcess &&process, std::string_view command);
+	void SendStart(SocketDescriptor control, std::string_view command,
+		       WorkshopJob &_job);
+
+	[[nodiscard]]
+	Co::InvokeTask SpawnWorker(std::size_t max_log_buffer,
+				   bool enable_journal);
+	void AdoptWorker(std::size_t max_log_buffer, bool enable_journal,
+			 PlanProcess &&process);
+
+	[[nodiscard]]
+	Co::InvokeTask StartBatch(std::size_t max_log_buffer,
+				  bool enable_journal);
+	void OnBatchTimer() noexcept;
+	bool OnBatchDone(int status) noexcept;
+
+	/**
+	 * Refresh the timeout of the jobs waiting in #batch.
+	 */
+	void TouchBatch() noexcept;
 	UniqueSocketDescriptor InitControl();
 
+	/**
+	 * Choose the NUMA node for a new job process (only if the
+	 * plan has "cpuset auto").
+	 */
+	NumaNodeLease AcquireNumaNode() noexcept;
+
+	/**
+	 * The NUMA node the job process is confined to (for
+	 * processes spawned over the control channel).
+	 */
+	[[gnu::pure]]
+	const NumaNode *GetNumaNode() const noexcept;
+
 	void SetCgroup(FileDescriptor fd) noexcept;
 
-	void SetOutput(UniqueFileDescriptor fd) noexcept;
+	void SampleResourceUsage() noexcept;
+	void OnResourceSampleTimer() noexcept;
 
-	void Expand(std::list<std::string> &args) const noexcept;
+	void SetOutput(UniqueFileDescriptor fd) noexcept;
 
 	void ScheduleTimeout() noexcept;
 	void OnTimeout() noexcept;
@@ -155,6 +342,19 @@ private:
 
 	void OnTaskCompletion(std::exception_ptr &&error) noexcept;
 
+	/**
+	 * Submit the result of #job (status, log, CPU usage) to the
+	 * database.
+	 */
+	void SubmitResult(int exit_status) noexcept;
+
+	/**
+	 * The job has finished: submit the result to the database
+	 * and remove this object from the #WorkshopWorkplace (which
+	 * deletes it).
+	 */
+	void Finish(int exit_status) noexcept;
+
 	/* virtual methods from ExitListener */
 	void OnChildProcessExit(int status) noexcept override;
 
@@ -165,6 +365,7 @@ private:
 	void OnControlProgress(unsigned progress) noexcept override;
 	void OnControlSetEnv(const char *s) noexcept override;
 	void OnControlAgain(std::chrono::seconds d) noexcept override;
+	bool OnControlDone(int status) noexcept override;
 	Co::Task<UniqueFileDescriptor> OnControlSpawn(const char *token,
 						      const char *param) override;
 	void OnControlTemporaryError(std::exception_ptr &&error) noexcept override;
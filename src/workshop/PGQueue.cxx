@@ -3,26 +3,44 @@
 // author: Max Kellermann <max.kellermann@ionos.com>
 
 #include "PGQueue.hxx"
+#include "CgroupAccounting.hxx"
+#include "pg/BinaryValue.hxx"
 #include "pg/Connection.hxx"
+#include "pg/Hex.hxx"
 #include "pg/Reflection.hxx"
+#include "io/FileDescriptor.hxx"
 #include "lib/fmt/ToBuffer.hxx"
 
 #include <fmt/core.h>
 
-#include <assert.h>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
 #include <string.h>
 #include <stdlib.h>
 
 using std::string_view_literals::operator""sv;
 
 void
-pg_init(Pg::Connection &db, const char *schema, bool sticky)
+pg_init(Pg::Connection &db, const char *schema, bool sticky,
+	bool compress_log)
 {
 	/* if the "stdin" column does not exist, assume it's all
 	   NULL */
-	const std::string_view stdin_column = Pg::ColumnExists(db, schema, "jobs", "stdin")
-		? "stdin"sv
-		: "NULL"sv;
+	const bool have_stdin = Pg::ColumnExists(db, schema, "jobs", "stdin");
+	const bool have_stdin_oid = Pg::ColumnExists(db, schema, "jobs", "stdin_oid");
+
+	/* only check whether there is stdin data; it is loaded with
+	   PgLoadStdin() after the job has been claimed */
+	const std::string_view has_stdin_column = have_stdin
+		? (have_stdin_oid
+		   ? "(stdin IS NOT NULL OR stdin_oid IS NOT NULL)"sv
+		   : "stdin IS NOT NULL"sv)
+		: (have_stdin_oid
+		   ? "stdin_oid IS NOT NULL"sv
+		   : "FALSE"sv);
 
 	const std::string_view set_time_modified = Pg::ColumnExists(db, schema, "jobs", "time_modified")
 		? ", time_modified=now()"sv
@@ -45,10 +63,10 @@ FROM jobs
 WHERE node_name IS NULL AND time_done IS NULL AND exit_status IS NULL
   AND scheduled_time IS NOT NULL
   AND scheduled_time < now() + '1 year'::interval
-  AND plan_name = ANY ($1::TEXT[])
+  AND plan_name IN (SELECT plan_name FROM plan_filter)
   AND enabled
   AND {}
-)SQL", sticky_id_check).c_str(), 1);
+)SQL", sticky_id_check).c_str(), 0);
 
 	db.Prepare("select_new_jobs", fmt::format(R"SQL(
 SELECT id,plan_name,{},args,env,{}
@@ -56,14 +74,45 @@ SELECT id,plan_name,{},args,env,{}
 WHERE node_name IS NULL
   AND time_done IS NULL AND exit_status IS NULL
   AND (scheduled_time IS NULL OR now() >= scheduled_time)
-  AND plan_name = ANY ($1::TEXT[])
-  AND plan_name <> ALL ($2::TEXT[] || $3::TEXT[])
+  AND plan_name IN (SELECT plan_name FROM plan_filter WHERE running=$1)
   AND enabled
   AND {}
 ORDER BY priority, time_created
-LIMIT $4
-)SQL", sticky_id_column, stdin_column, sticky_id_check).c_str(),
-		   4);
+LIMIT $2
+)SQL", sticky_id_column, has_stdin_column, sticky_id_check).c_str(),
+		   2);
+
+	db.Prepare("select_batch_jobs", fmt::format(R"SQL(
+SELECT id,plan_name,{},args,env,{}
+  FROM jobs
+WHERE node_name IS NULL
+  AND time_done IS NULL AND exit_status IS NULL
+  AND (scheduled_time IS NULL OR now() >= scheduled_time)
+  AND plan_name=$1
+  AND enabled
+  AND {}
+ORDER BY priority, time_created
+LIMIT $2
+)SQL", sticky_id_column, has_stdin_column, sticky_id_check).c_str(),
+		   2);
+
+	/* the second column checks whether the large object exists,
+	   to tell a permanent error from a transient one; the
+	   "stdin" column is fetched at once, because substring()
+	   would decompress the whole TOAST value for each chunk */
+	db.Prepare("get_stdin", fmt::format(R"SQL(
+SELECT {}, {} FROM jobs WHERE id=$1
+)SQL", have_stdin_oid
+		? "stdin_oid, stdin_oid IS NULL OR EXISTS (SELECT 1 FROM pg_largeobject_metadata WHERE oid=stdin_oid)"sv
+		: "NULL, TRUE"sv,
+		have_stdin ? "stdin"sv : "NULL::bytea"sv).c_str(),
+		   1);
+
+	if (have_stdin_oid)
+		db.Prepare("get_stdin_lo_chunk", R"SQL(
+SELECT lo_get($1::oid, $2, $3)
+)SQL",
+			   3);
 
 	db.Prepare("check_rate_limit", R"SQL(
 SELECT EXTRACT(EPOCH FROM time_started + $2::interval - now()) FROM jobs
@@ -89,6 +138,14 @@ WHERE id=$1
 )SQL", set_time_modified).c_str(),
 		   3);
 
+	db.Prepare("touch_jobs", fmt::format(R"SQL(
+UPDATE jobs
+SET node_timeout=now()+$2::INTERVAL
+ {}
+WHERE id=ANY($1::integer[]) AND time_done IS NULL
+)SQL", set_time_modified).c_str(),
+		   2);
+
 	db.Prepare("set_job_done", fmt::format(R"SQL(
 UPDATE jobs
 SET time_done=now(), progress=100, exit_status=$2, log=$3
@@ -97,6 +154,28 @@ WHERE id=$1
 )SQL", set_time_modified).c_str(),
 		   3);
 
+	if (compress_log) {
+		/* $3 is a zstd frame */
+		db.Prepare("set_job_done_zstd", fmt::format(R"SQL(
+UPDATE jobs
+SET time_done=now(), progress=100, exit_status=$2, log=NULL, log_zstd=$3
+ {}
+WHERE id=$1
+)SQL", set_time_modified).c_str(),
+			   3);
+
+		db.Prepare("again_job_zstd", fmt::format(R"SQL(
+UPDATE jobs
+SET node_name=NULL, node_timeout=NULL, progress=0
+, log=NULL, log_zstd=$3
+, scheduled_time=NOW() + $2 * '1 second'::interval
+ {}
+WHERE id=$1 AND node_name IS NOT NULL
+AND time_done IS NULL
+)SQL", set_time_modified).c_str(),
+			   3);
+	}
+
 	db.Prepare("add_cpu_usage", R"SQL(
 UPDATE jobs
 SET cpu_usage=COALESCE(cpu_usage, '0'::interval)+$2::interval
@@ -104,6 +183,30 @@ WHERE id=$1
 )SQL",
 		   2);
 
+	/* the "log_file" column is only needed with "log_spool";
+	   don't require migrating the database otherwise */
+	if (Pg::ColumnExists(db, schema, "jobs", "log_file"))
+		db.Prepare("set_log_file", R"SQL(
+UPDATE jobs
+SET log_file=$2
+WHERE id=$1
+)SQL",
+			   2);
+
+	/* the resource usage columns are optional, too */
+	if (Pg::ColumnExists(db, schema, "jobs", "memory_peak"))
+		db.Prepare("add_resource_usage", R"SQL(
+UPDATE jobs
+SET memory_peak=GREATEST(memory_peak, $2::bigint)
+, io_read_bytes=COALESCE(io_read_bytes+$3::bigint, io_read_bytes, $3::bigint)
+, io_write_bytes=COALESCE(io_write_bytes+$4::bigint, io_write_bytes, $4::bigint)
+, cpu_pressure=COALESCE(cpu_pressure+$5::interval, cpu_pressure, $5::interval)
+, memory_pressure=COALESCE(memory_pressure+$6::interval, memory_pressure, $6::interval)
+, io_pressure=COALESCE(io_pressure+$7::interval, io_pressure, $7::interval)
+WHERE id=$1
+)SQL",
+			   7);
+
 	db.Prepare("release_jobs", fmt::format(R"SQL(
 UPDATE jobs
 SET node_name=NULL, node_timeout=NULL, progress=0
@@ -178,13 +281,9 @@ pg_expire_jobs(Pg::Connection &db, const char *except_node_name)
 }
 
 bool
-pg_next_scheduled_job(Pg::Connection &db,
-		      const char *plans_include,
-		      long *span_r)
+pg_next_scheduled_job(Pg::Connection &db, long *span_r)
 {
-	assert(plans_include != nullptr && *plans_include == '{');
-
-	const auto result = db.ExecutePrepared("next_scheduled_job", plans_include);
+	const auto result = db.ExecutePrepared("next_scheduled_job");
 	if (result.IsEmpty())
 		return false;
 
@@ -197,18 +296,17 @@ pg_next_scheduled_job(Pg::Connection &db,
 }
 
 Pg::Result
-pg_select_new_jobs(Pg::Connection &db,
-		   const char *plans_include, const char *plans_exclude,
-		   const char *plans_lowprio,
-		   unsigned limit)
+pg_select_new_jobs(Pg::Connection &db, bool running, unsigned limit)
 {
-	assert(plans_include != nullptr && *plans_include == '{');
-	assert(plans_exclude != nullptr && *plans_exclude == '{');
-	assert(plans_lowprio != nullptr && *plans_lowprio == '{');
-
 	return db.ExecutePrepared("select_new_jobs",
-				  plans_include, plans_exclude, plans_lowprio,
-				  limit);
+				  running ? "t" : "f", limit);
+}
+
+Pg::Result
+pg_select_batch_jobs(Pg::Connection &db, const char *plan_name,
+		     unsigned limit)
+{
+	return db.ExecutePrepared("select_batch_jobs", plan_name, limit);
 }
 
 std::chrono::seconds
@@ -224,6 +322,54 @@ PgCheckRateLimit(Pg::Connection &db, const char *plan_name,
 	return std::chrono::seconds(strtoul(value.c_str(), nullptr, 10));
 }
 
+bool
+PgLoadStdin(Pg::Connection &db, const char *job_id, FileDescriptor fd)
+{
+	/* load large objects in chunks to limit the size of each
+	   result (and the memory needed to decode it) */
+	constexpr std::size_t CHUNK_SIZE = 1024 * 1024;
+
+	const auto stdin_result = db.ExecutePrepared("get_stdin", job_id);
+	if (stdin_result.IsEmpty())
+		/* the job has been deleted */
+		return false;
+
+	if (std::string_view{stdin_result.GetValue(0, 1)} != "t"sv)
+		/* the large object has been deleted */
+		return false;
+
+	const char *oid = stdin_result.GetValue(0, 0);
+	if (*oid == 0) {
+		/* the "stdin" column */
+		const std::string_view value = stdin_result.GetValue(0, 2);
+		if (!value.empty())
+			fd.FullWrite(Pg::DecodeHex(value));
+		return true;
+	}
+
+	for (uint_least64_t offset = 0;;) {
+		const auto result = db.ExecutePrepared("get_stdin_lo_chunk",
+						       oid, offset, CHUNK_SIZE);
+
+		const std::string_view value = result.GetValue(0, 0);
+		if (value.empty())
+			/* NULL */
+			break;
+
+		const auto chunk = Pg::DecodeHex(value);
+		if (chunk.empty())
+			break;
+
+		fd.FullWrite(chunk);
+
+		offset += chunk.size();
+		if (chunk.size() < CHUNK_SIZE)
+			break;
+	}
+
+	return true;
+}
+
 bool
 pg_claim_job(Pg::Connection &db,
 	     const char *job_id, const char *node_name,
@@ -244,6 +390,12 @@ pg_set_job_progress(Pg::Connection &db, const char *job_id,
 		throw std::runtime_error("No matching job");
 }
 
+void
+PgTouchJobs(Pg::Connection &db, const char *ids, const char *timeout)
+{
+	db.ExecutePrepared("touch_jobs", ids, timeout);
+}
+
 void
 PgSetEnv(Pg::Connection &db, const char *job_id, const char *more_env)
 {
@@ -288,6 +440,27 @@ pg_set_job_done(Pg::Connection &db, const char *id, int status,
 		throw std::runtime_error("No matching job");
 }
 
+void
+PgAgainJobCompressed(Pg::Connection &db, const char *id,
+		     std::span<const std::byte> log,
+		     std::chrono::seconds delay)
+{
+	const auto result = db.ExecutePrepared("again_job_zstd", id, delay.count(),
+					       Pg::BinaryValue{log});
+	if (result.GetAffectedRows() < 1)
+		throw std::runtime_error("No matching job");
+}
+
+void
+PgSetJobDoneCompressed(Pg::Connection &db, const char *id, int status,
+		       std::span<const std::byte> log)
+{
+	const auto result = db.ExecutePrepared("set_job_done_zstd", id, status,
+					       Pg::BinaryValue{log});
+	if (result.GetAffectedRows() < 1)
+		throw std::runtime_error("No matching job");
+}
+
 void
 PgAddJobCpuUsage(Pg::Connection &db, const char *id,
 		 std::chrono::microseconds cpu_usage)
@@ -300,6 +473,57 @@ PgAddJobCpuUsage(Pg::Connection &db, const char *id,
 		throw std::runtime_error("No matching job");
 }
 
+static std::string
+FormatOptional(const std::optional<uint_least64_t> &value)
+{
+	return value ? fmt::format("{}"sv, *value) : std::string{};
+}
+
+static std::string
+FormatOptional(const std::optional<std::chrono::microseconds> &value)
+{
+	return value
+		? fmt::format("{} microseconds"sv, value->count())
+		: std::string{};
+}
+
+static const char *
+NullIfEmpty(const std::string &s) noexcept
+{
+	return s.empty() ? nullptr : s.c_str();
+}
+
+void
+PgAddJobResourceUsage(Pg::Connection &db, const char *id,
+		      const CgroupResourceUsage &usage)
+{
+	const auto memory_peak = FormatOptional(usage.memory_peak);
+	const auto io_read_bytes = FormatOptional(usage.io_read_bytes);
+	const auto io_write_bytes = FormatOptional(usage.io_write_bytes);
+	const auto cpu_pressure = FormatOptional(usage.cpu_pressure);
+	const auto memory_pressure = FormatOptional(usage.memory_pressure);
+	const auto io_pressure = FormatOptional(usage.io_pressure);
+
+	const auto result =
+		db.ExecutePrepared("add_resource_usage", id,
+				   NullIfEmpty(memory_peak),
+				   NullIfEmpty(io_read_bytes),
+				   NullIfEmpty(io_write_bytes),
+				   NullIfEmpty(cpu_pressure),
+				   NullIfEmpty(memory_pressure),
+				   NullIfEmpty(io_pressure));
+	if (result.GetAffectedRows() < 1)
+		throw std::runtime_error("No matching job");
+}
+
+void
+PgSetJobLogFile(Pg::Connection &db, const char *id, const char *path)
+{
+	const auto result = db.ExecutePrepared("set_log_file", id, path);
+	if (result.GetAffectedRows() < 1)
+		throw std::runtime_error("No matching job");
+}
+
 unsigned
 PgReapFinishedJobs(Pg::Connection &db, const char *plan_name,
 		   const char *reap_finished)
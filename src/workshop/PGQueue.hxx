@@ -9,6 +9,11 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <span>
+
+class FileDescriptor;
+struct CgroupResourceUsage;
 
 namespace Pg {
 class Connection;
@@ -17,9 +22,11 @@ class Result;
 
 /**
  * Initialize the database connection after it has been established.
+ * PlanFilterTable::Init() must have been called already.
  */
 void
-pg_init(Pg::Connection &db, const char *schema, bool sticky);
+pg_init(Pg::Connection &db, const char *schema, bool sticky,
+	bool compress_log);
 
 /**
  * Throws on error.
@@ -40,21 +47,31 @@ unsigned
 pg_expire_jobs(Pg::Connection &db, const char *except_node_name);
 
 /**
+ * Find the next scheduled job of a plan in the #PlanFilterTable.
+ *
  * Throws on error.
  */
 bool
-pg_next_scheduled_job(Pg::Connection &db,
-		      const char *plans_include,
-		      long *span_r);
+pg_next_scheduled_job(Pg::Connection &db, long *span_r);
 
 /**
+ * Select new jobs of plans in the #PlanFilterTable.
+ *
  * Throws on error.
+ *
+ * @param running select jobs of plans which are already running
+ * on this node (the second, low-priority pass)?
  */
 Pg::Result
-pg_select_new_jobs(Pg::Connection &db,
-		   const char *plans_include, const char *plans_exclude,
-		   const char *plans_lowprio,
-		   unsigned limit);
+pg_select_new_jobs(Pg::Connection &db, bool running, unsigned limit);
+
+/**
+ * Select jobs of one plan for a batch (plan option "batch"),
+ * regardless of the plan filter.
+ */
+Pg::Result
+pg_select_batch_jobs(Pg::Connection &db, const char *plan_name,
+		     unsigned limit);
 
 /**
  * Checks if the given rate limit was reached/exceeded.
@@ -69,6 +86,19 @@ std::chrono::seconds
 PgCheckRateLimit(Pg::Connection &db, const char *plan_name,
 		 std::chrono::seconds duration, unsigned max_count);
 
+/**
+ * Write the job's stdin data (from the column "stdin" or the large
+ * object referenced by "stdin_oid") to the given file.  Large
+ * objects are loaded in chunks.
+ *
+ * Throws on (possibly transient) error.
+ *
+ * @return false if the data is gone for good (the job or its large
+ * object has been deleted)
+ */
+bool
+PgLoadStdin(Pg::Connection &db, const char *job_id, FileDescriptor fd);
+
 /**
  * Throws on error.
  *
@@ -87,6 +117,17 @@ void
 pg_set_job_progress(Pg::Connection &db, const char *job_id, unsigned progress,
 		    const char *timeout);
 
+/**
+ * Refresh the "node_timeout" of all given jobs (e.g. jobs waiting in
+ * a batch).
+ *
+ * Throws on error.
+ *
+ * @param ids a PostgreSQL array of job ids
+ */
+void
+PgTouchJobs(Pg::Connection &db, const char *ids, const char *timeout);
+
 /**
  * Throws on error.
  */
@@ -119,10 +160,47 @@ void
 pg_set_job_done(Pg::Connection &db, const char *id, int status,
 		const char *log);
 
+/**
+ * Like pg_again_job(), but store a zstd-compressed log in the
+ * "log_zstd" column.  Requires pg_init() with compress_log=true.
+ *
+ * Throws on error.
+ */
+void
+PgAgainJobCompressed(Pg::Connection &db, const char *id,
+		     std::span<const std::byte> log,
+		     std::chrono::seconds delay);
+
+/**
+ * Like pg_set_job_done(), but store a zstd-compressed log in the
+ * "log_zstd" column.  Requires pg_init() with compress_log=true.
+ *
+ * Throws on error.
+ */
+void
+PgSetJobDoneCompressed(Pg::Connection &db, const char *id, int status,
+		       std::span<const std::byte> log);
+
 void
 PgAddJobCpuUsage(Pg::Connection &db, const char *id,
 		 std::chrono::microseconds cpu_usage);
 
+/**
+ * Add the resource usage to the job's columns.  Requires the
+ * "memory_peak" column and its siblings.
+ *
+ * Throws on error.
+ */
+void
+PgAddJobResourceUsage(Pg::Connection &db, const char *id,
+		      const CgroupResourceUsage &usage);
+
+/**
+ * Throws on error.
+ */
+void
+PgSetJobLogFile(Pg::Connection &db, const char *id, const char *path);
+
 unsigned
 PgReapFinishedJobs(Pg::Connection &db, const char *plan_name,
 		   const char *reap_finished);
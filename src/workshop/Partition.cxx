@@ -8,15 +8,14 @@
 #include "Config.hxx"
 #include "Job.hxx"
 #include "Plan.hxx"
+#include "PreforkPool.hxx"
 #include "../Config.hxx"
-#include "pg/Array.hxx"
+#include "net/ConnectSocket.hxx"
 
 #ifdef HAVE_AVAHI
 #include "StickyManager.hxx"
 #endif
 
-#include <set>
-
 using std::string_view_literals::operator""sv;
 
 WorkshopPartition::WorkshopPartition(Instance &_instance,
@@ -43,6 +42,14 @@ WorkshopPartition::WorkshopPartition(Instance &_instance,
 	 rate_limit_timer(instance.GetEventLoop(),
 			  BIND_THIS_METHOD(OnRateLimitTimer)),
 	 reap_timer(instance.GetEventLoop(), BIND_THIS_METHOD(OnReapTimer)),
+	 translation(!config.translation_sockets.empty()
+		     ? new TranslationBalancer(instance.GetEventLoop(), logger,
+					       config.translation_sockets,
+					       config.translation_connections)
+		     : nullptr),
+	 pond_socket(!config.pond_server.IsNull()
+		     ? CreateConnectDatagramSocket(config.pond_server)
+		     : UniqueSocketDescriptor()),
 	 queue(logger, instance.GetEventLoop(), root_config.node_name.c_str(),
 	       Pg::Config{config.database},
 #ifdef HAVE_AVAHI
@@ -50,13 +57,18 @@ WorkshopPartition::WorkshopPartition(Instance &_instance,
 #else
 	       false,
 #endif
+	       config.compress_log,
 	       *this),
 	 workplace(_spawn_service, *this, logger,
 		   root_config.node_name.c_str(),
-		   config.translation_socket,
+		   translation.get(),
 		   config.tag.empty() ? nullptr : config.tag.c_str(),
+		   config.translation_cache_size,
 		   root_config.concurrency,
-		   config.enable_journal),
+		   config.log_spool,
+		   pond_socket,
+		   config.enable_journal,
+		   config.journal_rate),
 	 idle_callback(_idle_callback),
 	 max_log(config.max_log)
 {
@@ -100,26 +112,24 @@ WorkshopPartition::OnStickyChanged() noexcept
 void
 WorkshopPartition::OnRateLimitTimer() noexcept
 {
+	/* at least one rate limit has expired */
+	available_plans_dirty = true;
 	UpdateFilter();
 }
 
-void
-WorkshopPartition::UpdateFilter(bool library_modified) noexcept
+inline void
+WorkshopPartition::RebuildAvailablePlans(Event::TimePoint now) noexcept
 {
-	std::set<std::string_view, std::less<>> available_plans;
-	library.VisitAvailable(GetEventLoop().SteadyNow(),
-			       [&available_plans](const std::string_view plan_name, const Plan &){
+	available_plans.clear();
+	library.VisitAvailable(now,
+			       [this](const std::string_view plan_name, const Plan &){
 				       available_plans.emplace(plan_name);
 			       });
 
-	if (library_modified)
-		rate_limited_plans.clear();
-
 	/* remove the plans which have hit their rate limit */
-	const auto now = GetEventLoop().SteadyNow();
 	const auto earliest_expiry =
 		rate_limited_plans.ForEach(now,
-			[&available_plans](const std::string_view plan_name){
+			[this](const std::string_view plan_name){
 				auto i = available_plans.find(plan_name);
 				if (i != available_plans.end())
 					available_plans.erase(i);
@@ -129,18 +139,75 @@ WorkshopPartition::UpdateFilter(bool library_modified) noexcept
 	else
 		rate_limit_timer.Schedule(earliest_expiry.GetRemainingDuration(now));
 
-	queue.SetFilter(Pg::EncodeArray(available_plans),
-			workplace.GetFullPlanNames(),
-			workplace.GetRunningPlanNames());
-
-	if (library_modified)
-		ScheduleReapFinished();
+	available_plans_dirty = false;
+	next_available_plans_refresh = now + std::chrono::minutes{1};
 }
 
 void
-WorkshopPartition::UpdateLibraryAndFilter(bool force) noexcept
+WorkshopPartition::UpdateFilter(bool library_modified) noexcept
 {
-	instance.UpdateLibraryAndFilter(force);
+	const auto now = GetEventLoop().SteadyNow();
+
+	if (library_modified) {
+		rate_limited_plans.clear();
+		available_plans_dirty = true;
+		ScheduleReapFinished();
+	}
+
+	if (now >= next_available_plans_refresh)
+		available_plans_dirty = true;
+
+	auto changed_plans = workplace.TakeChangedPlans();
+
+	if (!available_plans_dirty) {
+		/* only submit the plans whose state has changed */
+		for (const auto &plan_name : changed_plans) {
+			if (!available_plans.contains(plan_name))
+				continue;
+
+			switch (workplace.GetPlanState(plan_name)) {
+			case WorkshopWorkplace::PlanState::IDLE:
+				queue.UpdateFilter(plan_name, false);
+				break;
+
+			case WorkshopWorkplace::PlanState::RUNNING:
+				queue.UpdateFilter(plan_name, true);
+				break;
+
+			case WorkshopWorkplace::PlanState::FULL:
+				queue.UpdateFilter(plan_name, std::nullopt);
+				break;
+			}
+		}
+
+		return;
+	}
+
+	RebuildAvailablePlans(now);
+
+	workplace.PrunePools([this, now](const std::string &plan_name,
+					 const Plan &plan){
+		return library.Get(now, plan_name.c_str()).get() == &plan;
+	});
+
+	PlanFilter filter;
+	for (const auto &plan_name : available_plans) {
+		switch (workplace.GetPlanState(plan_name)) {
+		case WorkshopWorkplace::PlanState::IDLE:
+			filter.emplace_hint(filter.end(), plan_name, false);
+			break;
+
+		case WorkshopWorkplace::PlanState::RUNNING:
+			filter.emplace_hint(filter.end(), plan_name, true);
+			break;
+
+		case WorkshopWorkplace::PlanState::FULL:
+			/* excluded */
+			break;
+		}
+	}
+
+	queue.SetFilter(std::move(filter));
 }
 
 void
@@ -217,7 +284,10 @@ WorkshopPartition::CheckWorkshopJob(const WorkshopJob &job,
 	}
 #endif
 
-	if (workplace.IsFull()) {
+	if (workplace.IsFull() &&
+	    /* joining a batch which is still collecting jobs does
+	       not need another slot */
+	    !workplace.IsCollectingBatch(job.plan_name)) {
 		queue.DisableFull();
 		return false;
 	}
@@ -230,6 +300,7 @@ WorkshopPartition::CheckWorkshopJob(const WorkshopJob &job,
 				       Expiry::Touched(GetEventLoop().SteadyNow(),
 						       delta));
 
+		available_plans_dirty = true;
 		UpdateFilter();
 		return false;
 	}
@@ -241,19 +312,44 @@ void
 WorkshopPartition::StartWorkshopJob(WorkshopJob &&job,
 				    std::shared_ptr<Plan> plan) noexcept
 {
+	/* does this job start a new batch? */
+	std::string batch_plan_name;
+	const unsigned batch = plan->batch;
+	if (batch > 0 && !workplace.IsCollectingBatch(job.plan_name))
+		batch_plan_name = job.plan_name;
+
 	workplace.Start(instance.GetEventLoop(), std::move(job), std::move(plan), max_log);
+
+	if (!batch_plan_name.empty() &&
+	    workplace.IsCollectingBatch(batch_plan_name))
+		/* claim the rest of the batch at once; the plan
+		   filter would exclude it if the plan or the node is
+		   full now */
+		queue.FillBatch(batch_plan_name.c_str(), batch - 1);
+
 	if (workplace.IsFull())
 		queue.DisableFull();
 
 	UpdateFilter();
 }
 
+void
+WorkshopPartition::SetSlotLimit(std::size_t slots) noexcept
+{
+	workplace.SetSlotLimit(slots);
+
+	if (workplace.IsFull())
+		queue.DisableFull();
+	else
+		queue.EnableFull();
+}
+
 void
 WorkshopPartition::OnChildProcessExit(int) noexcept
 {
 	ScheduleReapFinished();
 
-	UpdateLibraryAndFilter(false);
+	UpdateFilter();
 
 	if (!workplace.IsFull())
 		queue.EnableFull();
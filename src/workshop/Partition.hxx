@@ -6,14 +6,20 @@
 
 #include "Queue.hxx"
 #include "Workplace.hxx"
+#include "translation/Balancer.hxx"
 #include "spawn/ExitListener.hxx"
 #include "event/FineTimerEvent.hxx"
 #include "event/CoarseTimerEvent.hxx"
+#include "event/Chrono.hxx"
 #include "io/Logger.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
 #include "time/ExpiryMap.hxx"
 #include "util/BindMethod.hxx"
 #include "config.h"
 
+#include <set>
+#include <string>
+
 namespace Avahi { class Client; class ErrorHandler; class Publisher; }
 struct Config;
 struct WorkshopPartitionConfig;
@@ -35,6 +41,26 @@ class WorkshopPartition final : WorkshopQueueHandler, ExitListener {
 
 	ExpiryMap<std::string> rate_limited_plans;
 
+	/**
+	 * The set of available plans (minus the rate-limited ones).
+	 * This is only rebuilt when #available_plans_dirty is set or
+	 * when #next_available_plans_refresh has been reached.
+	 */
+	std::set<std::string, std::less<>> available_plans;
+
+	/**
+	 * Plans which are temporarily disabled (e.g. due to load
+	 * errors) become available again after a while; to catch
+	 * this, #available_plans is rebuilt periodically.
+	 */
+	Event::TimePoint next_available_plans_refresh;
+
+	/**
+	 * Shall #available_plans be rebuilt by the next
+	 * UpdateFilter() call?
+	 */
+	bool available_plans_dirty = true;
+
 	/**
 	 * This timer is enabled when #rate_limited_plans is not
 	 * empty.  It updates the filter periodically to ensure that
@@ -48,6 +74,18 @@ class WorkshopPartition final : WorkshopQueueHandler, ExitListener {
 	 */
 	CoarseTimerEvent reap_timer;
 
+	/**
+	 * Connections to the translation server; nullptr if none was
+	 * configured.
+	 */
+	const std::unique_ptr<TranslationBalancer> translation;
+
+	/**
+	 * A datagram socket connected to the Pond server (setting
+	 * "pond_server"); undefined if none was configured.
+	 */
+	const UniqueSocketDescriptor pond_socket;
+
 	WorkshopQueue queue;
 	WorkshopWorkplace workplace;
 
@@ -114,8 +152,22 @@ public:
 		workplace.CancelTag(child_tag);
 	}
 
+	/**
+	 * Handle a TCACHE_INVALIDATE control packet.
+	 *
+	 * Throws on malformed payload.
+	 */
+	void InvalidateTranslationCache(std::span<const std::byte> payload) {
+		workplace.GetTranslationCache().Invalidate(payload);
+	}
+
 	void UpdateFilter(bool library_modified=false) noexcept;
-	void UpdateLibraryAndFilter(bool force) noexcept;
+
+	/**
+	 * Apply a new number of job slots decided by the
+	 * #PressureController.
+	 */
+	void SetSlotLimit(std::size_t slots) noexcept;
 
 private:
 #ifdef HAVE_AVAHI
@@ -127,6 +179,8 @@ private:
 
 	void OnRateLimitTimer() noexcept;
 
+	void RebuildAvailablePlans(Event::TimePoint now) noexcept;
+
 	[[nodiscard]]
 	std::chrono::seconds CheckRateLimit(const char *plan_name,
 					    const Plan &plan) noexcept;
@@ -5,9 +5,14 @@
 #pragma once
 
 #include "RateLimit.hxx"
+#include "Expand.hxx"
 #include "spawn/ResourceLimits.hxx"
+#include "spawn/UidGid.hxx"
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <utility> // for std::pair
 #include <vector>
 #include <chrono>
 
@@ -45,15 +50,74 @@ struct Plan {
 	/** supplementary group ids */
 	std::vector<gid_t> groups;
 
+	/**
+	 * The variables which may be referenced in "exec" arguments.
+	 * Their values are passed to ExpandTemplate::Expand() in
+	 * this order.
+	 */
+	static constexpr std::array<std::string_view, 4> VARIABLES{
+		"0", "NODE", "JOB", "PLAN",
+	};
+
+	/**
+	 * Precompiled templates of #args (without the executable
+	 * path, i.e. one less element); built by Compile().
+	 */
+	std::vector<ExpandTemplate> arg_templates;
+
+	/**
+	 * #uid, #gid and #groups prepared for
+	 * #PreparedChildProcess; built by Compile().
+	 */
+	UidGid uid_gid;
+
 	int umask = -1;
 
 	ResourceLimits rlimits;
 
+	/**
+	 * cgroup2 attributes (name and value, e.g. "cpu.weight" and
+	 * "50") which are written to the per-plan cgroup (plan
+	 * options "cpu_weight", "memory_max" etc.).
+	 */
+	std::vector<std::pair<std::string, std::string>> cgroup_set;
+
+	/**
+	 * Confine each job to one NUMA node, distributing them
+	 * round-robin over all nodes (plan option "cpuset auto")?
+	 */
+	bool cpuset_auto = false;
+
 	int priority = 10;
 
 	/** maximum concurrency for this plan */
 	unsigned concurrency = 0;
 
+	/**
+	 * The number of pre-forked processes waiting for a job (plan
+	 * option "prefork"); 0 disables this feature.
+	 */
+	unsigned prefork = 0;
+
+	/**
+	 * The number of long-lived worker processes which receive
+	 * jobs over the control channel (plan option "worker"); 0
+	 * means this is not a worker plan.
+	 */
+	unsigned worker = 0;
+
+	/**
+	 * The maximum number of jobs handed to one process (plan
+	 * option "batch"); 0 disables batching.
+	 */
+	unsigned batch = 0;
+
+	/**
+	 * How long to wait for more jobs before starting a batch
+	 * which is not yet complete.
+	 */
+	std::chrono::seconds batch_window{};
+
 	bool sched_idle = false, ioprio_idle = false;
 
 	bool private_network = false;
@@ -66,6 +130,19 @@ struct Plan {
 
 	bool translate = false;
 
+	/**
+	 * Cache translation responses (if the translation server
+	 * permits it with MAX_AGE)?
+	 */
+	bool translate_cache = false;
+
+	/**
+	 * The (1-based) indices of job arguments which are part of
+	 * the translation cache key.  All other arguments are
+	 * ignored by the cache.
+	 */
+	std::vector<unsigned> translate_cache_args;
+
 	bool notify_progress = false;
 
 	Plan() = default;
@@ -92,4 +169,13 @@ struct Plan {
 
 		return args.front();
 	}
+
+	/**
+	 * Prepare the parts of the plan which are needed to launch
+	 * each job, so this work does not need to be repeated.
+	 * Called after the plan has been loaded.
+	 *
+	 * Throws on error.
+	 */
+	void Compile();
 };
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <map>
+#include <string>
+
+/**
+ * The set of plans whose jobs may be selected by #WorkshopQueue.
+ * The value is true if the plan is already running on this node;
+ * its jobs are only selected in the second (low-priority) pass.
+ * Plans which have reached their concurrency limit are not
+ * contained.
+ */
+using PlanFilter = std::map<std::string, bool, std::less<>>;
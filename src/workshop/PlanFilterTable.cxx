@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PlanFilterTable.hxx"
+#include "pg/Connection.hxx"
+
+namespace PlanFilterTable {
+
+void
+Init(Pg::Connection &c)
+{
+	c.Execute(R"SQL(
+CREATE TEMPORARY TABLE plan_filter (
+  plan_name varchar(64) NOT NULL PRIMARY KEY,
+  running boolean NOT NULL
+)
+)SQL");
+
+	c.Prepare("delete_plan_filter", R"SQL(
+DELETE FROM plan_filter WHERE plan_name = ANY ($1::TEXT[])
+)SQL",
+		  1);
+
+	c.Prepare("upsert_plan_filter", R"SQL(
+INSERT INTO plan_filter(plan_name, running)
+SELECT unnest($1::TEXT[]), $2::boolean
+ON CONFLICT (plan_name) DO UPDATE SET running=EXCLUDED.running
+)SQL",
+		  2);
+}
+
+void
+Delete(Pg::Connection &c, const char *plan_names)
+{
+	c.ExecutePrepared("delete_plan_filter", plan_names);
+}
+
+void
+Upsert(Pg::Connection &c, const char *plan_names, bool running)
+{
+	c.ExecutePrepared("upsert_plan_filter", plan_names,
+			  running ? "t" : "f");
+}
+
+void
+Analyze(Pg::Connection &c)
+{
+	c.Execute("ANALYZE plan_filter");
+}
+
+} // namespace PlanFilterTable
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+namespace Pg { class Connection; }
+
+/**
+ * A temporary table containing the #PlanFilter of this session.  It
+ * is updated incrementally, so the job selection queries do not
+ * need to transmit the whole list of plans each time.
+ */
+namespace PlanFilterTable {
+
+/**
+ * Create the temporary table.  This must be called after the
+ * connection has been established, before pg_init().
+ */
+void
+Init(Pg::Connection &c);
+
+/**
+ * Remove plans from the table.
+ *
+ * @param plan_names an array encoded with Pg::EncodeArray()
+ */
+void
+Delete(Pg::Connection &c, const char *plan_names);
+
+/**
+ * Insert plans into the table or update the "running" flag of
+ * existing rows.
+ *
+ * @param plan_names an array encoded with Pg::EncodeArray()
+ */
+void
+Upsert(Pg::Connection &c, const char *plan_names, bool running);
+
+/**
+ * Update the planner statistics of the table.  This is necessary
+ * after rows have been inserted or removed, because autovacuum
+ * does not process temporary tables.
+ */
+void
+Analyze(Pg::Connection &c);
+
+} // namespace PlanFilterTable
@@ -12,6 +12,8 @@
 #include "io/Open.hxx"
 #include "util/CharUtil.hxx"
 
+#include <sys/inotify.h>
+
 #include <assert.h>
 #include <fcntl.h> // for AT_*
 #include <unistd.h>
@@ -97,43 +99,98 @@ Library::UpdatePlans(std::chrono::steady_clock::time_point now)
 	return modified;
 }
 
+void
+Library::AddWatch(FileDescriptor inotify_fd) noexcept
+{
+	if (vanished) {
+		try {
+			directory_fd = OpenPath(path.c_str(), O_DIRECTORY);
+		} catch (...) {
+			logger.Fmt(2, "{}", std::current_exception());
+			return;
+		}
+
+		vanished = false;
+	}
+
+	watch_descriptor = inotify_add_watch(inotify_fd.Get(), path.c_str(),
+					     IN_ONLYDIR|IN_CLOSE_WRITE|IN_ATTRIB|
+					     IN_CREATE|IN_DELETE|
+					     IN_MOVED_FROM|IN_MOVED_TO|
+					     IN_DELETE_SELF|IN_MOVE_SELF);
+	if (watch_descriptor < 0)
+		logger.Fmt(2, "Failed to watch {:?}: {}", path, strerror(errno));
+}
+
 bool
-Library::Update(std::chrono::steady_clock::time_point now, bool force) noexcept
+Library::Update(std::chrono::steady_clock::time_point now) noexcept
 try {
-	/* check directory time stamp */
+	return UpdatePlans(now);
+} catch (...) {
+	logger.Fmt(2, "Failed to load plans from {:?}: {}",
+		   path, std::current_exception());
+	return false;
+}
 
-	struct statx stx;
-	if (statx(-1, path.c_str(), AT_STATX_FORCE_SYNC,
-		  STATX_TYPE|STATX_MTIME,
-		  &stx) < 0) {
-		logger.Fmt(2, "Failed to stat {:?}: {}", path, strerror(errno));
-		return false;
-	}
+bool
+Library::Revalidate(std::chrono::steady_clock::time_point now) noexcept
+{
+	bool modified = false;
 
-	if (!S_ISDIR(stx.stx_mode)) {
-		logger.Fmt(2, "not a directory: {}", path);
-		return false;
-	}
+	for (auto &[name, entry] : plans)
+		if (UpdatePlan(name.c_str(), entry, now))
+			modified = true;
 
-	const auto new_mtime = stx.stx_mtime;
+	return modified;
+}
 
-	if (!force && new_mtime == mtime && now < next_plans_check)
+inline bool
+Library::UpdatePlanFile(const char *name,
+			std::chrono::steady_clock::time_point now) noexcept
+{
+	auto [i, inserted] = plans.try_emplace(name);
+	return UpdatePlan(name, i->second, now) || inserted;
+}
+
+inline bool
+Library::RemovePlan(const char *name) noexcept
+{
+	auto i = plans.find(name);
+	if (i == plans.end())
 		return false;
 
-	/* do it */
+	logger.Fmt(3, "removed plan {:?}", name);
+	plans.erase(i);
+	return true;
+}
+
+bool
+Library::OnInotify(std::chrono::steady_clock::time_point now,
+		   unsigned mask, const char *name) noexcept
+{
+	if (mask & (IN_IGNORED|IN_DELETE_SELF|IN_MOVE_SELF)) {
+		/* the directory itself was deleted or moved; the
+		   watch is gone, and MultiLibrary::Update() will try
+		   to register a new one */
+		logger.Fmt(2, "Plan directory {:?} has vanished", path);
+		watch_descriptor = -1;
+		vanished = true;
+
+		if (plans.empty())
+			return false;
 
-	bool modified = UpdatePlans(now);
+		plans.clear();
+		return true;
+	}
 
-	/* update mtime */
+	if (name == nullptr || *name == 0 ||
+	    IsSpecialFilename(name) || !is_valid_plan_name(name))
+		return false;
 
-	mtime = new_mtime;
-	next_plans_check = now + std::chrono::seconds(60);
+	if (mask & (IN_DELETE|IN_MOVED_FROM))
+		return RemovePlan(name);
 
-	return modified;
-} catch (...) {
-	logger.Fmt(2, "Failed to load plans from {:?}: {}",
-		   path, std::current_exception());
-	return false;
+	return UpdatePlanFile(name, now);
 }
 
 std::shared_ptr<Plan>
@@ -144,9 +201,7 @@ Library::Get(std::chrono::steady_clock::time_point now,
 	if (i == plans.end())
 		return nullptr;
 
-	PlanEntry &entry = i->second;
-
-	UpdatePlan(name, entry, now);
+	const PlanEntry &entry = i->second;
 	if (!entry.IsAvailable(now))
 		return nullptr;
 
@@ -4,14 +4,19 @@
 
 #include "PlanLoader.hxx"
 #include "Plan.hxx"
+#include "CgroupValue.hxx"
 #include "pg/Interval.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "lib/fmt/SystemError.hxx"
 #include "io/config/FileLineParser.hxx"
 #include "io/config/ConfigParser.hxx"
+#include "util/CharUtil.hxx"
 #include "util/StringAPI.hxx"
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <string>
 
 #include <assert.h>
 #include <sys/stat.h>
@@ -20,6 +25,31 @@
 #include <pwd.h>
 #include <grp.h>
 
+/**
+ * Check the syntax of a "cpuset" list (e.g. "0-3,8").
+ */
+static void
+CheckCpuList(const char *s, const char *name)
+{
+	if (*s == 0)
+		throw FmtRuntimeError("Empty {:?} list", name);
+
+	for (; *s != 0; ++s)
+		if (!IsDigitASCII(*s) && *s != ',' && *s != '-')
+			throw FmtRuntimeError("Malformed {:?} list", name);
+}
+
+static void
+AddCgroupSet(Plan &plan, const char *option,
+	     const char *name, std::string &&value)
+{
+	for (const auto &[i, _] : plan.cgroup_set)
+		if (i == name)
+			throw FmtRuntimeError("{:?} already specified", option);
+
+	plan.cgroup_set.emplace_back(name, std::move(value));
+}
+
 class PlanLoader final : public ConfigParser {
 	Plan plan;
 
@@ -71,6 +101,11 @@ PlanLoader::ParseLine(FileLineParser &line)
 		seen_exec_option = true;
 	} else if (StringIsEqual(key, "translate")) {
 		plan.translate = true;
+	} else if (StringIsEqual(key, "translate_cache")) {
+		plan.translate_cache = true;
+
+		while (!line.IsEnd())
+			plan.translate_cache_args.push_back(line.NextPositiveInteger());
 	} else if (StringIsEqual(key, "notify_progress")) {
 		plan.notify_progress = true;
 	} else if (StringIsEqual(key, "control_channel")) {
@@ -171,8 +206,91 @@ PlanLoader::ParseLine(FileLineParser &line)
 		if (!plan.rlimits.Parse(line.ExpectValueAndEnd()))
 			throw std::runtime_error("Failed to parse rlimits");
 		seen_exec_option = true;
+	} else if (StringIsEqual(key, "cpu_weight")) {
+		const auto value = ParseUnsigned(line.ExpectValueAndEnd(),
+						 1, 10000, key);
+		AddCgroupSet(plan, key, "cpu.weight", std::to_string(value));
+	} else if (StringIsEqual(key, "cpu_max")) {
+		const char *quota = line.ExpectValue();
+		std::string value = StringIsEqual(quota, "max")
+			? std::string{quota}
+			: std::to_string(ParseUnsigned(quota, 1000, UINT64_MAX, key));
+
+		uint_least64_t period = 100000;
+		if (!line.IsEnd())
+			period = ParseUnsigned(line.ExpectValue(),
+					       1000, 1000000, "cpu_max period");
+		line.ExpectEnd();
+
+		value += ' ';
+		value += std::to_string(period);
+		AddCgroupSet(plan, key, "cpu.max", std::move(value));
+	} else if (StringIsEqual(key, "memory_high")) {
+		AddCgroupSet(plan, key, "memory.high",
+			     ParseCgroupMemory(line.ExpectValueAndEnd(), key));
+	} else if (StringIsEqual(key, "memory_max")) {
+		AddCgroupSet(plan, key, "memory.max",
+			     ParseCgroupMemory(line.ExpectValueAndEnd(), key));
+	} else if (StringIsEqual(key, "io_weight")) {
+		const auto value = ParseUnsigned(line.ExpectValueAndEnd(),
+						 1, 10000, key);
+		AddCgroupSet(plan, key, "io.weight",
+			     "default " + std::to_string(value));
+	} else if (StringIsEqual(key, "pids_max")) {
+		AddCgroupSet(plan, key, "pids.max",
+			     ParseCgroupMax(line.ExpectValueAndEnd(), key));
+	} else if (StringIsEqual(key, "cpuset")) {
+		const char *cpus = line.ExpectValue();
+		if (StringIsEqual(cpus, "auto")) {
+			if (plan.cpuset_auto)
+				throw std::runtime_error("'cpuset' already specified");
+
+			for (const auto &[name, _] : plan.cgroup_set)
+				if (name == "cpuset.cpus")
+					throw std::runtime_error("'cpuset' already specified");
+
+			plan.cpuset_auto = true;
+		} else {
+			if (plan.cpuset_auto)
+				throw std::runtime_error("'cpuset' already specified");
+
+			CheckCpuList(cpus, key);
+			AddCgroupSet(plan, key, "cpuset.cpus", cpus);
+
+			if (!line.IsEnd()) {
+				const char *mems = line.ExpectValue();
+				CheckCpuList(mems, key);
+				AddCgroupSet(plan, key, "cpuset.mems", mems);
+			}
+		}
+
+		line.ExpectEnd();
 	} else if (StringIsEqual(key, "concurrency")) {
 		plan.concurrency = line.NextPositiveInteger();
+		line.ExpectEnd();
+	} else if (StringIsEqual(key, "prefork")) {
+		plan.prefork = line.NextPositiveInteger();
+		if (plan.prefork > 64)
+			throw std::runtime_error("'prefork' value is too large");
+		line.ExpectEnd();
+	} else if (StringIsEqual(key, "worker")) {
+		plan.worker = line.NextPositiveInteger();
+		if (plan.worker > 64)
+			throw std::runtime_error("'worker' value is too large");
+		line.ExpectEnd();
+	} else if (StringIsEqual(key, "batch")) {
+		plan.batch = line.NextPositiveInteger();
+		if (plan.batch < 2)
+			throw std::runtime_error("'batch' value is too small");
+		if (plan.batch > 256)
+			throw std::runtime_error("'batch' value is too large");
+
+		if (!line.IsEnd()) {
+			plan.batch_window = Pg::ParseIntervalS(line.ExpectValue());
+			if (plan.batch_window > std::chrono::minutes{10})
+				throw std::runtime_error("'batch' window is too long");
+		}
+
 		line.ExpectEnd();
 	} else if (StringIsEqual(key, "rate_limit")) {
 		plan.rate_limits.emplace_back(RateLimit::Parse(line.ExpectValueAndEnd()));
@@ -194,10 +312,63 @@ PlanLoader::Finish()
 	} else {
 		if (plan.args.empty())
 			throw std::runtime_error("no 'exec'");
+
+		if (plan.translate_cache)
+			throw std::runtime_error("'translate_cache' requires 'translate'");
 	}
 
 	if (plan.timeout.empty())
 		plan.timeout = "10 minutes";
+
+	plan.Compile();
+
+	if ((plan.prefork > 0) + (plan.worker > 0) + (plan.batch > 0) > 1)
+		throw std::runtime_error("Only one of 'prefork', 'worker' and 'batch' can be used");
+
+	if (plan.prefork > 0 || plan.worker > 0 || plan.batch > 0) {
+		const char *const option = plan.prefork > 0
+			? "prefork"
+			: (plan.worker > 0 ? "worker" : "batch");
+
+		if (plan.translate)
+			throw FmtRuntimeError("Cannot use {:?} with 'translate'",
+					      option);
+
+		if (!plan.control_channel)
+			throw FmtRuntimeError("{:?} requires 'control_channel'",
+					      option);
+
+		if (plan.allow_spawn)
+			throw FmtRuntimeError("Cannot use {:?} with 'allow_spawn'",
+					      option);
+
+		/* the process is spawned before the job is known */
+		for (const auto &i : plan.arg_templates)
+			if (!i.IsConstant())
+				throw FmtRuntimeError("Cannot use variables in 'exec' with {:?}",
+						      option);
+	}
+}
+
+void
+Plan::Compile()
+{
+	arg_templates.clear();
+
+	if (!args.empty()) {
+		arg_templates.reserve(args.size() - 1);
+		for (auto i = std::next(args.begin()); i != args.end(); ++i)
+			arg_templates.emplace_back(*i, VARIABLES);
+	}
+
+	if (groups.size() > uid_gid.supplementary_groups.size())
+		throw std::runtime_error("Too many supplementary groups");
+
+	uid_gid = {};
+	uid_gid.effective_uid = uid;
+	uid_gid.effective_gid = gid;
+	std::copy(groups.begin(), groups.end(),
+		  uid_gid.supplementary_groups.begin());
 }
 
 Plan
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PlanLoaderThread.hxx"
+#include "PlanLoader.hxx"
+#include "Plan.hxx"
+#include "EventFD.hxx"
+
+#include <cstdint>
+
+PlanLoaderThread::PlanLoaderThread(EventLoop &event_loop, Callback _callback)
+	:event_fd(CreateEventFD()),
+	 event(event_loop, BIND_THIS_METHOD(OnEventReady), event_fd),
+	 callback(_callback),
+	 thread(&PlanLoaderThread::Run, this)
+{
+	event.ScheduleRead();
+}
+
+PlanLoaderThread::~PlanLoaderThread() noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		quit = true;
+	}
+
+	cond.notify_one();
+	thread.join();
+
+	/* don't close the file descriptor, it is owned by
+	   #event_fd */
+	event.Cancel();
+}
+
+void
+PlanLoaderThread::Submit(Library &library, std::string_view name,
+			 std::string &&path) noexcept
+{
+	{
+		const std::scoped_lock lock{mutex};
+		requests.emplace_back(library, std::string{name}, std::move(path));
+	}
+
+	cond.notify_one();
+}
+
+void
+PlanLoaderThread::Run() noexcept
+{
+	std::unique_lock lock{mutex};
+
+	while (true) {
+		cond.wait(lock, [this]{ return quit || !requests.empty(); });
+		if (quit)
+			break;
+
+		Request request = std::move(requests.front());
+		requests.pop_front();
+
+		lock.unlock();
+
+		Result result{request.library, std::move(request.name), {}, {}};
+
+		try {
+			result.plan = std::make_shared<Plan>(LoadPlanFile(request.path));
+		} catch (...) {
+			result.error = std::current_exception();
+		}
+
+		lock.lock();
+		results.emplace_back(std::move(result));
+
+		/* wake up the event loop thread */
+		static constexpr uint64_t one = 1;
+		(void)event_fd.Write(std::as_bytes(std::span{&one, 1}));
+	}
+}
+
+void
+PlanLoaderThread::OnEventReady(unsigned) noexcept
+{
+	uint64_t value;
+	(void)event_fd.Read(std::as_writable_bytes(std::span{&value, 1}));
+
+	std::vector<Result> r;
+
+	{
+		const std::scoped_lock lock{mutex};
+		r.swap(results);
+	}
+
+	if (!r.empty())
+		callback(r);
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/PipeEvent.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/BindMethod.hxx"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Plan;
+class Library;
+
+/**
+ * Loads plan files in a worker thread, because LoadPlanFile() may
+ * block for a long time (e.g. getpwnam() and getgrouplist() may
+ * query a remote NSS service).  Results are delivered in the
+ * #EventLoop thread.
+ */
+class PlanLoaderThread {
+public:
+	struct Result {
+		Library &library;
+
+		std::string name;
+
+		/**
+		 * The new plan; nullptr on error.
+		 */
+		std::shared_ptr<Plan> plan;
+
+		std::exception_ptr error;
+	};
+
+	/**
+	 * Invoked with all results which have been collected since
+	 * the last call, so the receiver can apply them in one
+	 * batch.
+	 */
+	using Callback = BoundMethod<void(std::span<Result> results) noexcept>;
+
+private:
+	struct Request {
+		Library &library;
+		std::string name;
+		std::string path;
+	};
+
+	/**
+	 * An eventfd which is signalled by the worker thread after it
+	 * has added an item to #results.
+	 */
+	const UniqueFileDescriptor event_fd;
+
+	PipeEvent event;
+
+	const Callback callback;
+
+	/**
+	 * Protects #requests, #results and #quit.
+	 */
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	std::deque<Request> requests;
+	std::vector<Result> results;
+
+	bool quit = false;
+
+	std::thread thread;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	PlanLoaderThread(EventLoop &event_loop, Callback _callback);
+
+	~PlanLoaderThread() noexcept;
+
+	auto &GetEventLoop() const noexcept {
+		return event.GetEventLoop();
+	}
+
+	/**
+	 * Submit a plan file to be loaded by the worker thread.  The
+	 * #Callback will be invoked with the result (possibly
+	 * together with others).
+	 */
+	void Submit(Library &library, std::string_view name,
+		    std::string &&path) noexcept;
+
+private:
+	void Run() noexcept;
+
+	void OnEventReady(unsigned) noexcept;
+};
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PlanProcess.hxx"
+#include "Plan.hxx"
+#include "NumaTopology.hxx"
+#include "spawn/Client.hxx"
+#include "spawn/CoEnqueue.hxx"
+#include "spawn/CoWaitSpawnCompletion.hxx"
+#include "spawn/CgroupOptions.hxx"
+#include "spawn/Interface.hxx"
+#include "spawn/Prepared.hxx"
+#include "spawn/ProcessHandle.hxx"
+#include "net/EasyMessage.hxx"
+#include "net/SocketPair.hxx"
+#include "io/Pipe.hxx"
+#include "co/Task.hxx"
+#include "AllocatorPtr.hxx"
+#include "debug.h"
+
+#include <cassert>
+#include <tuple> // for std::tie()
+
+#include <sys/socket.h>
+
+PlanProcess::PlanProcess() noexcept = default;
+PlanProcess::PlanProcess(PlanProcess &&) noexcept = default;
+PlanProcess::~PlanProcess() noexcept = default;
+PlanProcess &PlanProcess::operator=(PlanProcess &&) noexcept = default;
+
+void
+PlanProcess::Drain() noexcept
+{
+	std::byte buffer[4096];
+
+	/* both are non-blocking */
+
+	if (stderr_r.IsDefined())
+		while (stderr_r.Read(buffer) > 0) {}
+
+	if (control.IsDefined())
+		while (control.Receive(buffer, MSG_DONTWAIT) > 0) {}
+}
+
+void
+PreparePlanChildProcess(PreparedChildProcess &p,
+			const char *plan_name, const Plan &plan) noexcept
+{
+	p.hook_info = plan_name;
+
+	if (!debug_mode)
+		p.uid_gid = plan.uid_gid;
+
+	if (!plan.chroot.empty())
+		p.chroot = plan.chroot.c_str();
+
+	p.umask = plan.umask;
+	p.rlimits = plan.rlimits;
+	p.priority = plan.priority;
+	p.sched_idle = plan.sched_idle;
+	p.ioprio_idle = plan.ioprio_idle;
+	p.ns.enable_network = plan.private_network;
+
+	if (plan.private_tmp)
+		p.ns.mount.mount_tmp_tmpfs = "";
+
+	p.no_new_privs = true;
+}
+
+void
+PreparePlanCgroup(AllocatorPtr alloc, CgroupOptions &cgroup,
+		  const char *plan_name, const Plan &plan,
+		  const NumaNode *numa_node)
+{
+	cgroup.name = plan_name;
+
+	if (numa_node == nullptr) {
+		for (const auto &[name, value] : plan.cgroup_set)
+			cgroup.Set(alloc, name, value);
+		return;
+	}
+
+	/* plan names cannot contain a dot, so this cannot clash with
+	   another plan's cgroup */
+	cgroup.name = alloc.Concat(plan_name, '.', numa_node->name);
+
+	/* the spawner writes the attributes only to the cgroup it
+	   creates, so there is no shared parent which could hold
+	   the plan's limits; each node cgroup gets the full limits
+	   (dividing them would shrink the limits of a job which
+	   happens to be alone on its node) */
+	for (const auto &[name, value] : plan.cgroup_set)
+		cgroup.Set(alloc, name, value);
+
+	cgroup.Set(alloc, "cpuset.cpus", numa_node->cpus);
+	cgroup.Set(alloc, "cpuset.mems", numa_node->mems);
+}
+
+Co::Task<PlanProcess>
+SpawnPlanProcess(SpawnService &spawn_service,
+		 const char *plan_name, const Plan &plan,
+		 const char *session,
+		 NumaNodeLease numa_node)
+{
+	assert(!plan.translate);
+	assert(plan.control_channel);
+
+	co_await CoEnqueueSpawner{spawn_service};
+
+	PlanProcess process;
+
+	auto [stderr_r, stderr_w] = CreatePipe();
+	stderr_r.SetNonBlocking();
+	process.stderr_r = std::move(stderr_r);
+
+	auto [control_parent, control_child] = CreateSocketPair(SOCK_SEQPACKET);
+	control_parent.SetNonBlocking();
+	process.control = std::move(control_parent);
+
+	PreparedChildProcess p;
+	p.stderr_fd = p.stdout_fd = stderr_w;
+	p.control_fd = control_child.ToFileDescriptor();
+
+	PreparePlanChildProcess(p, plan_name, plan);
+
+	for (const auto &i : plan.args)
+		p.args.push_back(i.c_str());
+
+	/* use the per-plan cgroup, just like regular jobs */
+
+	Allocator alloc;
+	CgroupOptions cgroup;
+	UniqueSocketDescriptor return_cgroup;
+
+	if (auto *client = dynamic_cast<SpawnServerClient *>(&spawn_service);
+	    client != nullptr && client->SupportsCgroups()) {
+		PreparePlanCgroup(alloc, cgroup, plan_name, plan, numa_node.get());
+		p.cgroup = &cgroup;
+		p.cgroup_session = session;
+
+		std::tie(return_cgroup, p.return_cgroup) = CreateSocketPair(SOCK_SEQPACKET);
+	}
+
+	process.handle = spawn_service.SpawnChildProcess(session, std::move(p));
+	co_await CoWaitSpawnCompletion{*process.handle};
+
+	if (return_cgroup.IsDefined()) {
+		if (p.return_cgroup.IsDefined())
+			p.return_cgroup.Close();
+
+		process.cgroup = EasyReceiveMessageWithOneFD(return_cgroup);
+	}
+
+	process.numa_node = std::move(numa_node);
+	co_return process;
+}
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "NumaTopology.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+
+#include <memory>
+
+namespace Co { template<typename T> class Task; }
+struct Plan;
+struct PreparedChildProcess;
+struct CgroupOptions;
+class AllocatorPtr;
+class ChildProcessHandle;
+class SpawnService;
+
+/**
+ * A process of a (non-"translate") plan which was spawned before
+ * there was a job for it.  It waits for a job on its control
+ * channel.
+ */
+struct PlanProcess {
+	std::unique_ptr<ChildProcessHandle> handle;
+
+	/**
+	 * The read end of the process's stderr pipe.
+	 */
+	UniqueFileDescriptor stderr_r;
+
+	/**
+	 * Our side of the control channel.
+	 */
+	UniqueSocketDescriptor control;
+
+	/**
+	 * The cgroup of this process (if the spawner supports
+	 * cgroups).
+	 */
+	UniqueFileDescriptor cgroup;
+
+	/**
+	 * Has this process already run a job?  Then the peak memory
+	 * usage of its cgroup includes the previous jobs.
+	 */
+	bool reused = false;
+
+	/**
+	 * The NUMA node this process is confined to (plan option
+	 * "cpuset auto").
+	 */
+	NumaNodeLease numa_node;
+
+	PlanProcess() noexcept;
+	PlanProcess(PlanProcess &&) noexcept;
+	~PlanProcess() noexcept;
+	PlanProcess &operator=(PlanProcess &&) noexcept;
+
+	/**
+	 * Discard everything which is pending on the stderr pipe and
+	 * on the control channel.  This is called before a worker
+	 * process gets reused, so output and control messages
+	 * (e.g. a late "progress") of the previous job or written
+	 * while the process was parked are not charged to the next
+	 * job.
+	 */
+	void Drain() noexcept;
+};
+
+/**
+ * Apply the execution options of the given (non-"translate") plan
+ * (user, chroot, resource limits, scheduler settings, namespaces) to
+ * a #PreparedChildProcess.
+ */
+void
+PreparePlanChildProcess(PreparedChildProcess &p,
+			const char *plan_name, const Plan &plan) noexcept;
+
+/**
+ * Set up the per-plan cgroup: it is named after the plan, and the
+ * plan's cgroup attributes (#Plan::cgroup_set) are written to it.
+ *
+ * @param numa_node if not nullptr, then the process is confined to
+ * this NUMA node (plan option "cpuset auto"); each node has its own
+ * cgroup, and the plan's limits are divided among the nodes
+ */
+void
+PreparePlanCgroup(AllocatorPtr alloc, CgroupOptions &cgroup,
+		  const char *plan_name, const Plan &plan,
+		  const NumaNode *numa_node);
+
+/**
+ * Spawn a process of a plan with a control channel and a stderr
+ * pipe, but without a job.  It is launched in the plan's cgroup with
+ * the given session name.
+ *
+ * Throws on error.
+ *
+ * @param session a name for the process which is unique within
+ * this plan
+ * @param numa_node see PreparePlanCgroup(); it is moved to
+ * PlanProcess::numa_node
+ */
+Co::Task<PlanProcess>
+SpawnPlanProcess(SpawnService &spawn_service,
+		 const char *plan_name, const Plan &plan,
+		 const char *session,
+		 NumaNodeLease numa_node);
@@ -5,6 +5,7 @@
 #include "Library.hxx"
 #include "Plan.hxx"
 #include "PlanLoader.hxx"
+#include "PlanLoaderThread.hxx"
 #include "StatxTimestamp.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
 #include "util/Exception.hxx"
@@ -56,7 +57,10 @@ Library::CheckPlanModified(const char *name, PlanEntry &entry,
 	const auto new_mtime = stx.stx_mtime;
 	if (new_mtime != entry.mtime) {
 		entry.Enable();
-		entry.plan.reset();
+
+		/* keep using the old plan until the new one has been
+		   loaded */
+		entry.stale = true;
 
 		entry.mtime = new_mtime;
 	}
@@ -106,17 +110,30 @@ bool
 Library::LoadPlan(const char *name, PlanEntry &entry,
 		  std::chrono::steady_clock::time_point now) noexcept
 {
-	assert(entry.plan == nullptr);
+	auto plan_path = fmt::format("{}/{}", path, name);
+
+	if (loader != nullptr) {
+		if (!entry.loading) {
+			logger.Fmt(6, "loading plan {:?} asynchronously", name);
+
+			entry.loading = true;
+			entry.stale = false;
+			loader->Submit(*this, name, std::move(plan_path));
+		}
+
+		return false;
+	}
 
 	logger.Fmt(6, "loading plan {:?}", name);
 
-	const auto plan_path = fmt::format("{}/{}", path, name);
+	entry.stale = false;
 
 	try {
-		entry.plan.reset(new Plan(LoadPlanFile(plan_path)));
+		entry.plan = std::make_shared<Plan>(LoadPlanFile(plan_path));
 	} catch (...) {
 		logger.Fmt(1, "failed to load plan {:?}: {}",
 			   name, std::current_exception());
+		entry.plan.reset();
 		DisablePlan(entry, now, std::chrono::seconds(600));
 		return false;
 	}
@@ -133,8 +150,46 @@ Library::UpdatePlan(const char *name, PlanEntry &entry,
 	if (!CheckPlanModified(name, entry, now))
 		return entry.IsAvailable(now) != was_available;
 
-	if (entry.plan == nullptr && !LoadPlan(name, entry, now))
-		return false;
+	if ((entry.plan == nullptr || entry.stale) &&
+	    !LoadPlan(name, entry, now) &&
+	    entry.plan == nullptr)
+		return entry.IsAvailable(now) != was_available;
 
 	return ValidatePlan(entry, now) != was_available;
 }
+
+bool
+Library::OnPlanLoaded(std::chrono::steady_clock::time_point now,
+		      const std::string &name,
+		      std::shared_ptr<Plan> &&plan,
+		      std::exception_ptr error) noexcept
+{
+	auto i = plans.find(name);
+	if (i == plans.end())
+		/* the plan has been removed meanwhile */
+		return false;
+
+	PlanEntry &entry = i->second;
+	entry.loading = false;
+
+	const bool was_available = entry.IsAvailable(now);
+
+	if (plan) {
+		/* atomically replace the old plan; operators which
+		   are still running it keep their reference */
+		entry.plan = std::move(plan);
+	} else {
+		logger.Fmt(1, "failed to load plan {:?}: {}", name, error);
+		entry.plan.reset();
+		DisablePlan(entry, now, std::chrono::seconds(600));
+	}
+
+	if (entry.stale)
+		/* modified again while it was being loaded */
+		LoadPlan(name.c_str(), entry, now);
+
+	if (entry.plan)
+		ValidatePlan(entry, now);
+
+	return entry.IsAvailable(now) != was_available;
+}
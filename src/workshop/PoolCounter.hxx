@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+/**
+ * The accounting of a #PreforkPool in "reuse" mode: it counts the
+ * callers which have a (taken or self-spawned) process which will
+ * be given back, and decides whether returned processes are kept.
+ * The number of idle processes (parked or being spawned) is owned
+ * by the pool and passed as a parameter.
+ */
+class PoolCounter {
+	/**
+	 * The number of processes to keep.
+	 */
+	const std::size_t size;
+
+	/**
+	 * The number of callers accounted by Acquire() which have
+	 * not yet called Release() or Discard().
+	 */
+	std::size_t n_busy = 0;
+
+public:
+	explicit constexpr PoolCounter(std::size_t _size) noexcept
+		:size(_size) {}
+
+	constexpr std::size_t GetSize() const noexcept {
+		return size;
+	}
+
+	constexpr std::size_t GetBusy() const noexcept {
+		return n_busy;
+	}
+
+	/**
+	 * How many processes need to be spawned to complete the
+	 * pool?
+	 */
+	constexpr std::size_t GetMissing(std::size_t n_idle) const noexcept {
+		const std::size_t n = n_idle + n_busy;
+		return n < size ? size - n : 0;
+	}
+
+	/**
+	 * A caller has taken a process out of the pool (which has
+	 * already been subtracted from @n_idle) or, if none was
+	 * ready, is going to spawn its own.  The caller is accounted
+	 * as busy only if its process fits into the pool; a process
+	 * spawned while the pool is complete (e.g. because other
+	 * processes are still being spawned) is not.
+	 *
+	 * @return true if the caller was accounted; this value must
+	 * be passed to Release() or Discard()
+	 */
+	constexpr bool Acquire(std::size_t n_idle) noexcept {
+		if (n_idle + n_busy >= size)
+			return false;
+
+		++n_busy;
+		return true;
+	}
+
+	/**
+	 * A caller gives its process back.
+	 *
+	 * @param busy the return value of Acquire()
+	 * @return true if the process shall be parked in the pool,
+	 * false if it is surplus and shall be killed
+	 */
+	constexpr bool Release(std::size_t n_idle, bool busy) noexcept {
+		Discard(busy);
+		return n_idle + n_busy < size;
+	}
+
+	/**
+	 * A caller has no process to give back (it has exited or was
+	 * killed).
+	 *
+	 * @param busy the return value of Acquire()
+	 */
+	constexpr void Discard(bool busy) noexcept {
+		if (busy) {
+			assert(n_busy > 0);
+			--n_busy;
+		}
+	}
+};
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PreforkPool.hxx"
+#include "Plan.hxx"
+#include "NumaTopology.hxx"
+#include "spawn/ExitListener.hxx"
+#include "spawn/ProcessHandle.hxx"
+#include "co/InvokeTask.hxx"
+#include "co/Task.hxx"
+#include "lib/fmt/ExceptionFormatter.hxx"
+#include "util/DeleteDisposer.hxx"
+
+#include <fmt/core.h>
+
+#include <cassert>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Delay refilling the pool after a failure.
+ */
+static constexpr Event::Duration refill_delay = std::chrono::seconds{10};
+
+class PreforkPool::Item final
+	: public IntrusiveListHook<IntrusiveHookMode::NORMAL>, ExitListener
+{
+	PreforkPool &pool;
+
+	const std::string session;
+
+	PlanProcess process;
+
+	Co::InvokeTask task;
+
+	bool ready = false;
+
+public:
+	Item(PreforkPool &_pool, std::string &&_session) noexcept
+		:pool(_pool), session(std::move(_session)) {}
+
+	/**
+	 * Construct an item for a process which has already been
+	 * spawned and is ready.
+	 */
+	Item(PreforkPool &_pool, PlanProcess &&_process) noexcept
+		:pool(_pool), process(std::move(_process)), ready(true)
+	{
+		process.handle->SetExitListener(*this);
+	}
+
+	bool IsReady() const noexcept {
+		return ready;
+	}
+
+	void Start() noexcept {
+		task = Spawn();
+		task.Start(BIND_THIS_METHOD(OnSpawnCompletion));
+	}
+
+	PlanProcess Steal() noexcept {
+		assert(ready);
+
+		/* the new owner must install its own ExitListener */
+		return std::move(process);
+	}
+
+private:
+	Co::InvokeTask Spawn() {
+		process = co_await SpawnPlanProcess(pool.spawn_service,
+						    pool.plan_name.c_str(),
+						    *pool.plan,
+						    session.c_str(),
+						    pool.plan->cpuset_auto
+						    ? pool.numa.Acquire()
+						    : NumaNodeLease{});
+	}
+
+	void OnSpawnCompletion(std::exception_ptr &&error) noexcept {
+		if (error) {
+			pool.OnItemError(*this, std::move(error));
+			return;
+		}
+
+		ready = true;
+		process.handle->SetExitListener(*this);
+		pool.OnItemReady(*this);
+	}
+
+	/* virtual methods from ExitListener */
+	void OnChildProcessExit(int status) noexcept override {
+		process.handle.reset();
+		pool.OnItemExit(*this, status);
+	}
+};
+
+PreforkPool::PreforkPool(EventLoop &event_loop, SpawnService &_spawn_service,
+			 NumaTopology &_numa,
+			 const Logger &parent_logger,
+			 std::string_view _plan_name,
+			 std::shared_ptr<Plan> _plan,
+			 std::size_t _size, bool _reuse) noexcept
+	:spawn_service(_spawn_service), numa(_numa),
+	 logger(parent_logger, _reuse ? "worker" : "prefork"),
+	 plan_name(_plan_name), plan(std::move(_plan)),
+	 counter(_size), reuse(_reuse),
+	 refill_timer(event_loop, BIND_THIS_METHOD(OnRefillTimer))
+{
+}
+
+PreforkPool::~PreforkPool() noexcept
+{
+	/* this kills all parked processes */
+	items.clear_and_dispose(DeleteDisposer{});
+}
+
+void
+PreforkPool::Fill() noexcept
+{
+	if (refill_timer.IsPending())
+		/* wait for the delay after a failure */
+		return;
+
+	for (std::size_t n = counter.GetMissing(items.size()); n > 0; --n) {
+		auto *item = new Item(*this,
+				      fmt::format("{}-{}"sv,
+						  reuse ? "worker"sv : "prefork"sv,
+						  ++session_counter));
+		items.push_back(*item);
+		item->Start();
+	}
+}
+
+std::optional<PlanProcess>
+PreforkPool::Take(bool &busy) noexcept
+{
+	std::optional<PlanProcess> result;
+
+	for (auto &item : items) {
+		if (item.IsReady()) {
+			result = item.Steal();
+			items.erase_and_dispose(items.iterator_to(item),
+						DeleteDisposer{});
+			break;
+		}
+	}
+
+	/* if no process was ready, the caller spawns its own, which
+	   may fill the pool's vacancy; this must be accounted before
+	   Fill() to avoid spawning a duplicate */
+	busy = reuse && counter.Acquire(items.size());
+
+	if (result && reuse)
+		/* discard leftovers of the previous job and output
+		   written while the process was parked */
+		result->Drain();
+
+	Fill();
+	return result;
+}
+
+void
+PreforkPool::Put(PlanProcess &&process, bool busy) noexcept
+{
+	assert(reuse);
+	assert(process.handle);
+
+	if (!counter.Release(items.size(), busy))
+		/* the pool is already complete (this can happen
+		   after Take() had no process ready and the caller
+		   spawned its own); the PlanProcess destructor kills
+		   this one */
+		return;
+
+	process.Drain();
+	process.reused = true;
+	items.push_back(*new Item(*this, std::move(process)));
+}
+
+void
+PreforkPool::Discard(bool busy) noexcept
+{
+	assert(reuse);
+
+	counter.Discard(busy);
+	Fill();
+}
+
+inline void
+PreforkPool::OnItemReady(Item &) noexcept
+{
+	logger.Fmt(5, "Process of plan {:?} is ready"sv, plan_name);
+}
+
+inline void
+PreforkPool::OnItemError(Item &item, std::exception_ptr error) noexcept
+{
+	logger.Fmt(1, "Failed to spawn process of plan {:?}: {}"sv,
+		   plan_name, error);
+
+	items.erase_and_dispose(items.iterator_to(item), DeleteDisposer{});
+	refill_timer.Schedule(refill_delay);
+}
+
+inline void
+PreforkPool::OnItemExit(Item &item, int status) noexcept
+{
+	logger.Fmt(2, "Parked process of plan {:?} exited with status {}"sv,
+		   plan_name, status);
+
+	items.erase_and_dispose(items.iterator_to(item), DeleteDisposer{});
+	refill_timer.Schedule(refill_delay);
+}
+
+void
+PreforkPool::OnRefillTimer() noexcept
+{
+	Fill();
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "PlanProcess.hxx"
+#include "PoolCounter.hxx"
+#include "event/CoarseTimerEvent.hxx"
+#include "io/Logger.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+struct Plan;
+class SpawnService;
+class NumaTopology;
+
+/**
+ * A pool of pre-forked processes of one plan (plan options "prefork"
+ * and "worker").  Each process is spawned in the plan's sandbox and
+ * cgroup, and then waits on its control channel until a job gets
+ * assigned to it.
+ *
+ * In "reuse" mode (for worker plans), processes are given back with
+ * Put() after the job has finished, and the pool size includes the
+ * processes which are currently busy.
+ */
+class PreforkPool final {
+	SpawnService &spawn_service;
+
+	/**
+	 * Chooses the NUMA node of each process (plan option
+	 * "cpuset auto").
+	 */
+	NumaTopology &numa;
+
+	const ChildLogger logger;
+
+	const std::string plan_name;
+
+	/**
+	 * The plan the processes were spawned with.  If the plan
+	 * gets reloaded, this pool must be replaced.
+	 */
+	const std::shared_ptr<Plan> plan;
+
+	/**
+	 * The number of processes to keep and (in "reuse" mode) the
+	 * number of busy callers.
+	 */
+	PoolCounter counter;
+
+	const bool reuse;
+
+	class Item;
+	IntrusiveList<Item, IntrusiveListBaseHookTraits<Item>,
+		      IntrusiveListOptions{.constant_time_size = true}> items;
+
+	/**
+	 * Refills the pool after spawning a process failed or a
+	 * parked process exited prematurely.  This is delayed to
+	 * avoid a busy loop with a broken plan.
+	 */
+	CoarseTimerEvent refill_timer;
+
+	/**
+	 * Used to build unique session (cgroup) names.
+	 */
+	unsigned session_counter = 0;
+
+public:
+	PreforkPool(EventLoop &event_loop, SpawnService &_spawn_service,
+		    NumaTopology &_numa,
+		    const Logger &parent_logger,
+		    std::string_view _plan_name,
+		    std::shared_ptr<Plan> _plan,
+		    std::size_t _size, bool _reuse) noexcept;
+	~PreforkPool() noexcept;
+
+	PreforkPool(const PreforkPool &) = delete;
+	PreforkPool &operator=(const PreforkPool &) = delete;
+
+	const Plan *GetPlan() const noexcept {
+		return plan.get();
+	}
+
+	std::size_t GetSize() const noexcept {
+		return counter.GetSize();
+	}
+
+	/**
+	 * The number of processes which are parked or being
+	 * spawned.
+	 */
+	std::size_t GetIdleCount() const noexcept {
+		return items.size();
+	}
+
+	/**
+	 * Spawn processes until the pool has the configured size.
+	 */
+	void Fill() noexcept;
+
+	/**
+	 * Take a parked process out of the pool (and start spawning
+	 * a replacement unless in "reuse" mode).
+	 *
+	 * In "reuse" mode, the caller may be accounted as busy (see
+	 * PoolCounter::Acquire()) until it calls Put() or Discard().
+	 * A process which was parked by Put() is drained before it
+	 * is returned.
+	 *
+	 * @param busy on return, true if the caller was accounted as
+	 * busy ("reuse" mode only)
+	 * @return the process or std::nullopt if no process is ready
+	 */
+	std::optional<PlanProcess> Take(bool &busy) noexcept;
+
+	/**
+	 * Give a process back after its job has finished ("reuse"
+	 * mode only).  It is drained and parked, or killed if the
+	 * pool is already complete.
+	 *
+	 * @param busy the value returned by Take()
+	 */
+	void Put(PlanProcess &&process, bool busy) noexcept;
+
+	/**
+	 * The caller of Take() has no process to give back (it has
+	 * exited or was killed); spawn a replacement ("reuse" mode
+	 * only).
+	 *
+	 * @param busy the value returned by Take()
+	 */
+	void Discard(bool busy) noexcept;
+
+private:
+	void OnItemReady(Item &item) noexcept;
+	void OnItemError(Item &item, std::exception_ptr error) noexcept;
+	void OnItemExit(Item &item, int status) noexcept;
+
+	void OnRefillTimer() noexcept;
+};
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "PressureController.hxx"
+#include "PressureMath.hxx"
+#include "CgroupAccounting.hxx"
+#include "event/Loop.hxx"
+#include "io/Open.hxx"
+
+#include <algorithm> // for std::max()
+#include <stdexcept>
+#include <utility> // for std::exchange()
+
+#include <fcntl.h> // for O_DIRECTORY
+
+/**
+ * How often is the pressure sampled?  Each sample may change the
+ * number of slots by one.
+ */
+static constexpr Event::Duration PRESSURE_INTERVAL = std::chrono::seconds{5};
+
+static constexpr std::array<const char *, 3> PRESSURE_NAMES{
+	"cpu", "memory", "io",
+};
+
+PressureController::PressureController(EventLoop &event_loop,
+				       unsigned _threshold,
+				       std::size_t _max_slots,
+				       Callback _callback)
+	:directory(OpenPath("/proc/pressure", O_DIRECTORY)),
+	 timer(event_loop, BIND_THIS_METHOD(OnTimer)),
+	 callback(_callback),
+	 threshold(_threshold),
+	 max_slots(_max_slots), slots(_max_slots)
+{
+	if (!ReadPressureTotal(directory, "cpu"))
+		throw std::runtime_error{"Pressure stall information is not available"};
+
+	Sample();
+	timer.Schedule(PRESSURE_INTERVAL);
+}
+
+PressureController::~PressureController() noexcept = default;
+
+unsigned
+PressureController::Sample() noexcept
+{
+	const auto now = timer.GetEventLoop().SteadyNow();
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - last_time);
+	last_time = now;
+
+	unsigned result = 0;
+
+	for (std::size_t i = 0; i < PRESSURE_NAMES.size(); ++i) {
+		const auto total = ReadPressureTotal(directory, PRESSURE_NAMES[i]);
+		const auto last = std::exchange(last_totals[i], total);
+
+		if (const auto percent = CalcStallPercent(last, total, elapsed))
+			result = std::max(result, *percent);
+	}
+
+	return result;
+}
+
+void
+PressureController::OnTimer() noexcept
+{
+	const unsigned pressure = Sample();
+
+	const std::size_t old_slots = slots;
+	slots = AdjustPressureSlots(slots, max_slots, pressure, threshold);
+
+	timer.Schedule(PRESSURE_INTERVAL);
+
+	if (slots != old_slots)
+		callback(slots);
+}
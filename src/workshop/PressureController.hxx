@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include "event/CoarseTimerEvent.hxx"
+#include "event/Chrono.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/BindMethod.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Adaptive admission control: watches the pressure stall
+ * information of this computer (/proc/pressure/{cpu,memory,io}) and
+ * adjusts the number of job slots.  If tasks were stalled longer
+ * than the threshold (in percent of the wall clock time), one slot
+ * is taken away per interval; when the pressure falls below half
+ * the threshold, one slot is given back.
+ *
+ * There is only one instance (owned by the #Instance), because the
+ * pressure is a property of the whole computer; it applies the same
+ * number of slots to all partitions.
+ */
+class PressureController final {
+	const UniqueFileDescriptor directory;
+
+	CoarseTimerEvent timer;
+
+	using Callback = BoundMethod<void(std::size_t slots) noexcept>;
+	const Callback callback;
+
+	/**
+	 * The threshold in percent.
+	 */
+	const unsigned threshold;
+
+	/**
+	 * The configured number of slots ("concurrency"); this is
+	 * the upper bound of #slots.
+	 */
+	const std::size_t max_slots;
+
+	std::size_t slots;
+
+	Event::TimePoint last_time;
+
+	/**
+	 * The "some" stall totals of the previous sample (cpu,
+	 * memory, io).
+	 */
+	std::array<std::optional<std::chrono::microseconds>, 3> last_totals;
+
+public:
+	/**
+	 * Throws if pressure stall information is not available.
+	 */
+	PressureController(EventLoop &event_loop,
+			   unsigned _threshold, std::size_t _max_slots,
+			   Callback _callback);
+
+	~PressureController() noexcept;
+
+	PressureController(const PressureController &) = delete;
+	PressureController &operator=(const PressureController &) = delete;
+
+	std::size_t GetSlots() const noexcept {
+		return slots;
+	}
+
+private:
+	/**
+	 * Sample the stall totals.
+	 *
+	 * @return the highest stall time since the previous sample in
+	 * percent of the elapsed time
+	 */
+	unsigned Sample() noexcept;
+
+	void OnTimer() noexcept;
+};
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Calculate the stall time between two samples of a PSI "some"
+ * total.
+ *
+ * @return the stall time in percent of the elapsed time, or
+ * std::nullopt if a sample is missing or the counter was reset
+ */
+constexpr std::optional<unsigned>
+CalcStallPercent(std::optional<std::chrono::microseconds> last,
+		 std::optional<std::chrono::microseconds> total,
+		 std::chrono::microseconds elapsed) noexcept
+{
+	if (!total || !last || *total < *last || elapsed.count() <= 0)
+		return std::nullopt;
+
+	return (*total - *last) * 100 / elapsed;
+}
+
+/**
+ * Calculate the new number of job slots for the given pressure: one
+ * slot is taken away if the pressure exceeds the threshold, and one
+ * is given back when it falls below half the threshold.
+ *
+ * @param pressure the pressure in percent (see CalcStallPercent())
+ * @param threshold the threshold in percent
+ */
+constexpr std::size_t
+AdjustPressureSlots(std::size_t slots, std::size_t max_slots,
+		    unsigned pressure, unsigned threshold) noexcept
+{
+	if (pressure > threshold) {
+		if (slots > 1)
+			--slots;
+	} else if (pressure * 2 < threshold) {
+		/* not "pressure < threshold / 2", which would never
+		   be true with threshold 1 */
+		if (slots < max_slots)
+			++slots;
+	}
+
+	return slots;
+}
@@ -10,28 +10,18 @@
 ProgressReader::ProgressReader(EventLoop &event_loop,
 			       UniqueFileDescriptor _fd,
 			       Callback _callback) noexcept
-	:event(event_loop, BIND_THIS_METHOD(PipeReady), _fd.Release()),
+	:reader(event_loop, std::move(_fd), *this),
 	 callback(_callback)
 {
-	event.ScheduleRead();
 }
 
-void
-ProgressReader::PipeReady(unsigned) noexcept
+bool
+ProgressReader::OnPipeData(std::span<const std::byte> src) noexcept
 {
-	char buffer[512];
-	ssize_t nbytes, i;
 	unsigned new_progress = 0, p;
 
-	FileDescriptor fd(event.GetFileDescriptor());
-	nbytes = fd.Read(std::as_writable_bytes(std::span{buffer}));
-	if (nbytes <= 0) {
-		event.Close();
-		return;
-	}
-
-	for (i = 0; i < nbytes; ++i) {
-		char ch = buffer[i];
+	for (const std::byte b : src) {
+		const char ch = static_cast<char>(b);
 
 		if (ch >= '0' && ch <= '9' &&
 		    stdout_buffer.size() < stdout_buffer.max_size() - 1) {
@@ -52,4 +42,6 @@ ProgressReader::PipeReady(unsigned) noexcept
 		callback(new_progress);
 		last_progress = new_progress;
 	}
+
+	return true;
 }
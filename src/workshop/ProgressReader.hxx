@@ -4,14 +4,14 @@
 
 #pragma once
 
-#include "event/PipeEvent.hxx"
+#include "PipeReader.hxx"
 #include "util/BindMethod.hxx"
 #include "util/StaticVector.hxx"
 
 class UniqueFileDescriptor;
 
-class ProgressReader {
-	PipeEvent event;
+class ProgressReader final : PipeReaderHandler {
+	PipeReader reader;
 	StaticVector<char, 64> stdout_buffer;
 	unsigned last_progress = 0;
 
@@ -23,10 +23,8 @@ public:
 		       UniqueFileDescriptor _fd,
 		       Callback _callback) noexcept;
 
-	~ProgressReader() noexcept {
-		event.Close();
-	}
-
 private:
-	void PipeReady(unsigned) noexcept;
+	/* virtual methods from class PipeReaderHandler */
+	bool OnPipeData(std::span<const std::byte> src) noexcept override;
+	void OnPipeEnd() noexcept override {}
 };
@@ -6,18 +6,23 @@
 #include "PGQueue.hxx"
 #include "Job.hxx"
 #include "Plan.hxx"
+#include "PlanFilterTable.hxx"
 #include "StickyTable.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "pg/Array.hxx"
-#include "pg/Hex.hxx"
 #include "pg/Reflection.hxx"
 #include "event/Loop.hxx"
+#include "io/linux/MemFD.hxx"
 #include "util/StringAPI.hxx"
 #include "util/StringCompare.hxx"
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <ranges>
+#include <span>
 #include <stdexcept>
+#include <vector>
 
 #include <sys/types.h>
 #include <assert.h>
@@ -25,15 +30,24 @@
 #include <errno.h>
 #include <time.h>
 
+/**
+ * Retry a job after loading its stdin data has failed.
+ */
+static constexpr std::chrono::seconds stdin_retry_delay{30};
+
 WorkshopQueue::WorkshopQueue(const Logger &parent_logger,
 			     EventLoop &event_loop,
 			     const char *_node_name,
 			     Pg::Config &&_db_config,
 			     bool _sticky,
+			     bool _compress_log,
 			     WorkshopQueueHandler &_handler) noexcept
 	:logger(parent_logger, "queue"), node_name(_node_name),
 	 db(event_loop, std::move(_db_config), *this),
-	 sticky(_sticky),
+	 sticky(_sticky), compress_log(_compress_log),
+#ifdef HAVE_ZSTD
+	 log_compressor(event_loop),
+#endif
 	 check_notify_event(event_loop, BIND_THIS_METHOD(CheckNotify)),
 	 timer_event(event_loop, BIND_THIS_METHOD(OnTimer)),
 	 progress_notify_timer(event_loop, BIND_THIS_METHOD(OnProgressNotifyTimer)),
@@ -44,6 +58,12 @@ WorkshopQueue::WorkshopQueue(const Logger &parent_logger,
 WorkshopQueue::~WorkshopQueue() noexcept
 {
 	assert(!running);
+
+#ifdef HAVE_ZSTD
+	/* store the pending logs now, while all other members are
+	   still alive */
+	log_compressor.Stop();
+#endif
 }
 
 void
@@ -70,14 +90,12 @@ WorkshopQueue::GetNextScheduled(int *span_r)
 {
 	long span;
 
-	if (plans_include.empty()) {
+	if (plan_filter.empty()) {
 		*span_r = -1;
 		return false;
 	}
 
-	if (!pg_next_scheduled_job(db,
-				   plans_include.c_str(),
-				   &span)) {
+	if (!pg_next_scheduled_job(db, &span)) {
 		*span_r = -1;
 		return false;
 	}
@@ -104,7 +122,7 @@ MakeJob(WorkshopQueue &queue, const Pg::Result::Row &row)
 		STICKY_ID,
 		ARGS,
 		ENV,
-		STDIN,
+		HAS_STDIN,
 	};
 
 	WorkshopJob job(queue);
@@ -115,8 +133,7 @@ MakeJob(WorkshopQueue &queue, const Pg::Result::Row &row)
 	job.args = Pg::DecodeArray(row.GetValue(ARGS));
 	job.env = Pg::DecodeArray(row.GetValue(ENV));
 
-	if (!row.IsValueNull(STDIN))
-		job.stdin = Pg::DecodeHex(row.GetValueView(STDIN));
+	job.has_stdin = *row.GetValue(HAS_STDIN) == 't';
 
 	if (job.id.empty())
 		throw std::runtime_error("Job has no id");
@@ -145,54 +162,180 @@ get_and_claim_job(const ChildLogger &logger, const WorkshopJob &job,
 }
 
 /**
- * Copy a string.
+ * Load the stdin data of a job which has just been claimed into a
+ * new memfd.
  *
- * @return false if the string was not modified.
+ * Throws on (possibly transient) error.
+ *
+ * @return the memfd or an undefined file descriptor if the data is
+ * gone for good
  */
-static bool
-copy_string(std::string &dest, std::string &&src) noexcept
+static UniqueFileDescriptor
+LoadStdin(Pg::Connection &db, const WorkshopJob &job)
 {
-	if (dest == src)
-		return false;
+	auto fd = CreateMemFD("stdin", std::span<const std::byte>{});
+	if (!PgLoadStdin(db, job.id.c_str(), fd))
+		return {};
 
-	dest = std::move(src);
-	return true;
+	fd.Rewind();
+	return fd;
 }
 
 void
-WorkshopQueue::SetFilter(std::string &&_plans_include,
-			 std::string &&_plans_exclude,
-			 std::string &&_plans_lowprio) noexcept
-{
-	bool r1 = copy_string(plans_include, std::move(_plans_include));
-	bool r2 = copy_string(plans_exclude, std::move(_plans_exclude));
-	plans_lowprio = std::move(_plans_lowprio);
-
-	if (r1 || r2) {
-		if (running)
-			interrupt = true;
-		else if (db.IsReady())
-			Reschedule();
+WorkshopQueue::SetFilter(PlanFilter &&_plan_filter) noexcept
+{
+	if (_plan_filter == plan_filter)
+		return;
+
+	/* a change of the "running" flag alone does not need a new
+	   queue run; only added or removed plans do */
+	const bool modified = !std::ranges::equal(std::views::keys(_plan_filter),
+						  std::views::keys(plan_filter));
+
+	plan_filter = std::move(_plan_filter);
+
+	if (modified)
+		OnFilterModified();
+}
+
+void
+WorkshopQueue::UpdateFilter(std::string_view plan_name,
+			    std::optional<bool> new_running) noexcept
+{
+	auto i = plan_filter.find(plan_name);
+
+	if (!new_running) {
+		if (i != plan_filter.end()) {
+			plan_filter.erase(i);
+			OnFilterModified();
+		}
+	} else if (i == plan_filter.end()) {
+		plan_filter.emplace(plan_name, *new_running);
+		OnFilterModified();
+	} else
+		/* a change of the "running" flag alone does not need
+		   a new queue run */
+		i->second = *new_running;
+}
+
+inline void
+WorkshopQueue::OnFilterModified() noexcept
+{
+	if (running)
+		interrupt = true;
+	else if (db.IsReady())
+		Reschedule();
+}
+
+void
+WorkshopQueue::SyncPlanFilter()
+{
+	std::vector<std::string_view> remove, idle, running_plans;
+	bool inserted = false;
+
+	/* both maps are sorted; walk them in parallel to find the
+	   differences */
+	auto i = plan_filter_table.begin();
+	const auto i_end = plan_filter_table.end();
+	auto j = plan_filter.begin();
+	const auto j_end = plan_filter.end();
+
+	while (i != i_end || j != j_end) {
+		if (j == j_end || (i != i_end && i->first < j->first)) {
+			remove.emplace_back(i->first);
+			++i;
+		} else if (i == i_end || j->first < i->first) {
+			(j->second ? running_plans : idle).emplace_back(j->first);
+			inserted = true;
+			++j;
+		} else {
+			if (i->second != j->second)
+				(j->second ? running_plans : idle).emplace_back(j->first);
+			++i;
+			++j;
+		}
 	}
+
+	if (!remove.empty())
+		PlanFilterTable::Delete(db, Pg::EncodeArray(remove).c_str());
+
+	if (!idle.empty())
+		PlanFilterTable::Upsert(db, Pg::EncodeArray(idle).c_str(), false);
+
+	if (!running_plans.empty())
+		PlanFilterTable::Upsert(db, Pg::EncodeArray(running_plans).c_str(), true);
+
+	if (!remove.empty() || inserted)
+		/* temporary tables are not analyzed by autovacuum;
+		   without statistics, the planner would use default
+		   estimates for the join with the "jobs" table */
+		PlanFilterTable::Analyze(db);
+
+	/* apply the same differences to our copy */
+
+	for (const auto name : remove)
+		plan_filter_table.erase(plan_filter_table.find(name));
+
+	for (const auto name : idle)
+		plan_filter_table.insert_or_assign(std::string{name}, false);
+
+	for (const auto name : running_plans)
+		plan_filter_table.insert_or_assign(std::string{name}, true);
 }
 
 void
-WorkshopQueue::RunResult(const Pg::Result &result)
+WorkshopQueue::RunResult(const Pg::Result &result, bool batch)
 {
 	for (const auto &row : result) {
-		if (!IsEnabled() || interrupt)
+		if (batch ? !IsEnabledOrFull() : (!IsEnabled() || interrupt))
 			break;
 
 		auto job = MakeJob(*this, row);
 		auto plan = handler.GetWorkshopPlan(job.plan_name.c_str());
 
-		if (plan &&
-		    handler.CheckWorkshopJob(job, *plan) &&
-		    get_and_claim_job(logger, job,
-				      GetNodeName(),
-				      db, plan->timeout.c_str()))
-			handler.StartWorkshopJob(std::move(job),
-						 std::move(plan));
+		if (!plan ||
+		    !handler.CheckWorkshopJob(job, *plan) ||
+		    !get_and_claim_job(logger, job,
+				       GetNodeName(),
+				       db, plan->timeout.c_str()))
+			continue;
+
+		if (job.has_stdin) {
+			try {
+				job.stdin = LoadStdin(db, job);
+			} catch (...) {
+				/* this may be a transient (database)
+				   error; give the job back and retry
+				   later */
+				logger(1, "failed to load stdin of job ", job.id,
+				       ": ", std::current_exception());
+				job.SetAgain(stdin_retry_delay, nullptr);
+				continue;
+			}
+
+			if (!job.stdin.IsDefined()) {
+				logger(1, "stdin of job ", job.id, " is missing");
+				job.SetDone(-EIO, "Failed to load stdin");
+				continue;
+			}
+		}
+
+		handler.StartWorkshopJob(std::move(job),
+					 std::move(plan));
+	}
+}
+
+void
+WorkshopQueue::FillBatch(const char *plan_name, unsigned limit) noexcept
+{
+	if (!IsEnabledOrFull() || !db.IsReady())
+		return;
+
+	try {
+		const auto result = pg_select_batch_jobs(db, plan_name, limit);
+		RunResult(result, true);
+	} catch (...) {
+		db.CheckError(std::current_exception());
 	}
 }
 
@@ -205,9 +348,7 @@ WorkshopQueue::Run2()
 	assert(IsEnabled());
 	assert(running);
 
-	if (plans_include.empty() ||
-	    plans_include.compare("{}") == 0 ||
-	    plans_exclude.empty())
+	if (plan_filter.empty())
 		return;
 
 	/* check expired jobs from all other nodes except us */
@@ -227,17 +368,12 @@ WorkshopQueue::Run2()
 
 	interrupt = false;
 
-	logger(7, "requesting new jobs from database; "
-	       "plans_include=", plans_include,
-	       " plans_exclude=", plans_exclude,
-	       " plans_lowprio=", plans_lowprio);
+	SyncPlanFilter();
+
+	logger(7, "requesting new jobs from database");
 
 	constexpr unsigned MAX_JOBS = 16;
-	auto result =
-		pg_select_new_jobs(db,
-				   plans_include.c_str(), plans_exclude.c_str(),
-				   plans_lowprio.c_str(),
-				   MAX_JOBS);
+	auto result = pg_select_new_jobs(db, false, MAX_JOBS);
 	if (!result.IsEmpty()) {
 		RunResult(result);
 
@@ -246,17 +382,13 @@ WorkshopQueue::Run2()
 	}
 
 	if (IsEnabled() && !interrupt &&
-	    plans_lowprio.compare("{}") != 0) {
+	    std::ranges::any_of(std::views::values(plan_filter_table),
+				[](bool r){ return r; })) {
 		/* now also select plans which are already running */
 
-		logger(7, "requesting new jobs from database II; plans_lowprio=",
-		       plans_lowprio);
+		logger(7, "requesting new jobs from database II");
 
-		result = pg_select_new_jobs(db,
-					    plans_lowprio.c_str(),
-					    plans_exclude.c_str(),
-					    "{}",
-					    MAX_JOBS);
+		result = pg_select_new_jobs(db, true, MAX_JOBS);
 		if (!result.IsEmpty()) {
 			RunResult(result);
 
@@ -423,6 +555,22 @@ WorkshopQueue::SetJobEnv(const WorkshopJob &job, const char *more_env)
 	PgSetEnv(db, job.id.c_str(), more_env);
 }
 
+void
+WorkshopQueue::TouchJobs(const std::vector<std::string_view> &ids,
+			 const char *timeout) noexcept
+{
+	if (ids.empty())
+		return;
+
+	ScheduleCheckNotify();
+
+	try {
+		PgTouchJobs(db, Pg::EncodeArray(ids).c_str(), timeout);
+	} catch (...) {
+		db.CheckError(std::current_exception());
+	}
+}
+
 void
 WorkshopQueue::AgainJob(const WorkshopJob &job,
 			const char *log,
@@ -432,6 +580,13 @@ WorkshopQueue::AgainJob(const WorkshopJob &job,
 
 	logger(6, "rescheduling job ", job.id);
 
+#ifdef HAVE_ZSTD
+	if (compress_log && delay > std::chrono::seconds() &&
+	    log != nullptr && *log != 0 &&
+	    CompressLog(job, 0, delay, log))
+		return;
+#endif
+
 	try {
 		if (delay > std::chrono::seconds())
 			pg_again_job(db, job.id.c_str(), log, delay);
@@ -452,6 +607,12 @@ WorkshopQueue::SetJobDone(const WorkshopJob &job, int status,
 
 	logger(6, "job ", job.id, " done with status ", status);
 
+#ifdef HAVE_ZSTD
+	if (compress_log && log != nullptr && *log != 0 &&
+	    CompressLog(job, status, std::chrono::seconds{-1}, log))
+		return;
+#endif
+
 	try {
 		pg_set_job_done(db, job.id.c_str(), status, log);
 		ScheduleCheckNotify();
@@ -460,6 +621,56 @@ WorkshopQueue::SetJobDone(const WorkshopJob &job, int status,
 	}
 }
 
+#ifdef HAVE_ZSTD
+
+inline bool
+WorkshopQueue::CompressLog(const WorkshopJob &job, int status,
+			   std::chrono::seconds again,
+			   std::string_view log) noexcept
+{
+	try {
+		log_compressor.Submit(log, [this, id=job.id, status, again](const char *text,
+									    std::span<const std::byte> compressed){
+			OnLogCompressed(id.c_str(), status, again,
+					text, compressed);
+		});
+		return true;
+	} catch (...) {
+		logger(1, "Failed to start the log compressor: ",
+		       std::current_exception());
+		return false;
+	}
+}
+
+void
+WorkshopQueue::OnLogCompressed(const char *id, int status,
+			       std::chrono::seconds again,
+			       const char *log,
+			       std::span<const std::byte> compressed) noexcept
+{
+	try {
+		if (again.count() >= 0) {
+			if (compressed.empty())
+				pg_again_job(db, id, log, again);
+			else
+				PgAgainJobCompressed(db, id, compressed, again);
+			pg_notify(db);
+		} else {
+			if (compressed.empty())
+				pg_set_job_done(db, id, status, log);
+			else
+				PgSetJobDoneCompressed(db, id, status, compressed);
+		}
+
+		if (!log_compressor.IsStopped())
+			ScheduleCheckNotify();
+	} catch (...) {
+		db.CheckError(std::current_exception());
+	}
+}
+
+#endif // HAVE_ZSTD
+
 void
 WorkshopQueue::AddJobCpuUsage(const WorkshopJob &job,
 			      std::chrono::microseconds cpu_usage) noexcept
@@ -473,6 +684,39 @@ WorkshopQueue::AddJobCpuUsage(const WorkshopJob &job,
 	}
 }
 
+void
+WorkshopQueue::AddJobResourceUsage(const WorkshopJob &job,
+				   const CgroupResourceUsage &usage) noexcept
+{
+	assert(&job.queue == this);
+
+	if (!have_resource_usage)
+		return;
+
+	try {
+		PgAddJobResourceUsage(db, job.id.c_str(), usage);
+	} catch (...) {
+		db.CheckError(std::current_exception());
+	}
+}
+
+void
+WorkshopQueue::SetJobLogFile(const WorkshopJob &job, const char *path) noexcept
+{
+	assert(&job.queue == this);
+
+	if (!have_log_file) {
+		logger(2, "No column 'jobs.log_file'; please migrate the database");
+		return;
+	}
+
+	try {
+		PgSetJobLogFile(db, job.id.c_str(), path);
+	} catch (...) {
+		db.CheckError(std::current_exception());
+	}
+}
+
 unsigned
 WorkshopQueue::ReapFinishedJobs(const char *plan_name,
 				const char *reap_finished) noexcept
@@ -510,10 +754,20 @@ WorkshopQueue::OnConnect()
 					      name);
 
 	const bool have_sticky_id = sticky && Pg::ColumnExists(db, schema, "jobs", "sticky_id");
+	have_log_file = Pg::ColumnExists(db, schema, "jobs", "log_file");
+	have_resource_usage = Pg::ColumnExists(db, schema, "jobs", "memory_peak");
 	if (have_sticky_id)
 		StickyTable::Init(db);
 
-	pg_init(db, schema, have_sticky_id);
+	/* the temporary table is new; SyncPlanFilter() will fill
+	   it */
+	PlanFilterTable::Init(db);
+	plan_filter_table.clear();
+
+	if (compress_log && !Pg::ColumnExists(db, schema, "jobs", "log_zstd"))
+		throw std::runtime_error{"No column 'jobs.log_zstd'; please migrate the database"};
+
+	pg_init(db, schema, have_sticky_id, compress_log);
 
 	db.Execute("LISTEN new_job");
 
@@ -4,18 +4,30 @@
 
 #pragma once
 
+#include "PlanFilter.hxx"
 #include "event/DeferEvent.hxx"
 #include "event/FineTimerEvent.hxx"
 #include "pg/AsyncConnection.hxx"
 #include "io/Logger.hxx"
+#include "config.h"
 
+#ifdef HAVE_ZSTD
+#include "LogCompressor.hxx"
+#endif
+
+#include <memory>
+#include <optional>
 #include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <chrono>
 
 struct WorkshopJob;
 struct Plan;
 class EventLoop;
+struct CgroupResourceUsage;
 
 class WorkshopQueueHandler {
 public:
@@ -41,6 +53,32 @@ class WorkshopQueue final : private Pg::AsyncConnectionHandler {
 
 	const bool sticky;
 
+	/**
+	 * Store logs zstd-compressed in the "log_zstd" column
+	 * (setting "compress_log")?
+	 */
+	const bool compress_log;
+
+	/**
+	 * Does the "jobs" table have the column "log_file"?
+	 */
+	bool have_log_file = false;
+
+	/**
+	 * Does the "jobs" table have the resource usage columns
+	 * ("memory_peak" etc.)?
+	 */
+	bool have_resource_usage = false;
+
+#ifdef HAVE_ZSTD
+	/**
+	 * Compresses logs if #compress_log is enabled.  It is
+	 * stopped by the destructor, which stores the pending
+	 * results.
+	 */
+	LogCompressor log_compressor;
+#endif
+
 	/**
 	 * Was the queue enabled by #StateDirectories?
 	 */
@@ -88,7 +126,18 @@ class WorkshopQueue final : private Pg::AsyncConnectionHandler {
 	 */
 	std::set<std::string, std::less<>> progress_notify_plans;
 
-	std::string plans_include, plans_exclude, plans_lowprio;
+	/**
+	 * The plan filter configured with SetFilter().
+	 */
+	PlanFilter plan_filter;
+
+	/**
+	 * The contents of the #PlanFilterTable in the current
+	 * database session.  SyncPlanFilter() submits the difference
+	 * to #plan_filter.
+	 */
+	PlanFilter plan_filter_table;
+
 	std::chrono::steady_clock::time_point next_expire_check =
 		std::chrono::steady_clock::time_point::min();
 
@@ -99,6 +148,7 @@ public:
 		      const char *_node_name,
 		      Pg::Config &&_db_config,
 		      bool _sticky,
+		      bool _compress_log,
 		      WorkshopQueueHandler &handler) noexcept;
 	~WorkshopQueue() noexcept;
 
@@ -118,8 +168,16 @@ public:
 	/**
 	 * Configure a "plan" filter.
 	 */
-	void SetFilter(std::string &&plans_include, std::string &&plans_exclude,
-		       std::string &&plans_lowprio) noexcept;
+	void SetFilter(PlanFilter &&_plan_filter) noexcept;
+
+	/**
+	 * Update one entry of the "plan" filter.
+	 *
+	 * @param running the new "running" flag of this plan, or
+	 * std::nullopt to remove it from the filter
+	 */
+	void UpdateFilter(std::string_view plan_name,
+			  std::optional<bool> running) noexcept;
 
 	bool IsEnabledOrFull() const noexcept {
 		return enabled_state && enabled_admin;
@@ -156,6 +214,15 @@ public:
 	 */
 	void EnableFull() noexcept;
 
+	/**
+	 * A new batch (plan option "batch") of this plan has been
+	 * started; claim up to #limit more jobs for it with one
+	 * query.  This ignores the plan filter and DisableFull()
+	 * because the jobs join the batch without occupying
+	 * another slot.
+	 */
+	void FillBatch(const char *plan_name, unsigned limit) noexcept;
+
 	void InsertStickyNonLocal(const char *sticky_id) noexcept;
 	void FlushSticky() noexcept;
 
@@ -179,6 +246,13 @@ public:
 
 	void SetJobEnv(const WorkshopJob &job, const char *more_env);
 
+	/**
+	 * Refresh the timeout of jobs which have been claimed, but
+	 * are still waiting in a batch.
+	 */
+	void TouchJobs(const std::vector<std::string_view> &ids,
+		       const char *timeout) noexcept;
+
 	/**
 	 * Reschedule the given job after it has been executed already.
 	 *
@@ -194,14 +268,38 @@ public:
 	void AddJobCpuUsage(const WorkshopJob &job,
 			    std::chrono::microseconds cpu_usage) noexcept;
 
+	/**
+	 * Add cgroup resource usage to the job's columns.  This is
+	 * silently ignored if the database has not been migrated.
+	 */
+	void AddJobResourceUsage(const WorkshopJob &job,
+				 const CgroupResourceUsage &usage) noexcept;
+
+	void SetJobLogFile(const WorkshopJob &job, const char *path) noexcept;
+
 	unsigned ReapFinishedJobs(const char *plan_name,
 				  const char *reap_finished) noexcept;
 
 private:
 	/**
+	 * Submit changes of #plan_filter to the database.
+	 *
 	 * Throws on error.
 	 */
-	void RunResult(const Pg::Result &result);
+	void SyncPlanFilter();
+
+	/**
+	 * Plans have been added to or removed from #plan_filter;
+	 * start a new queue run.
+	 */
+	void OnFilterModified() noexcept;
+
+	/**
+	 * Throws on error.
+	 *
+	 * @param batch the result comes from FillBatch()
+	 */
+	void RunResult(const Pg::Result &result, bool batch=false);
 
 	/**
 	 * Throws on error.
@@ -254,6 +352,25 @@ private:
 	 */
 	bool GetNextScheduled(int *span_r);
 
+#ifdef HAVE_ZSTD
+	/**
+	 * Submit the log to the #LogCompressor; the job record will
+	 * be updated by OnLogCompressed().
+	 *
+	 * @param again the "again" delay; negative if the job is
+	 * done
+	 * @return false if the #LogCompressor is not available
+	 */
+	bool CompressLog(const WorkshopJob &job, int status,
+			 std::chrono::seconds again,
+			 std::string_view log) noexcept;
+
+	void OnLogCompressed(const char *id, int status,
+			     std::chrono::seconds again,
+			     const char *log,
+			     std::span<const std::byte> compressed) noexcept;
+#endif
+
 	/* virtual methods from Pg::AsyncConnectionHandler */
 	void OnConnect() override;
 	void OnDisconnect() noexcept override;
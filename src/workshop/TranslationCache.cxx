@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "TranslationCache.hxx"
+#include "translation/Protocol.hxx"
+#include "util/SpanCast.hxx"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Invoke a callback for each packet in a buffer containing
+ * translation packets.
+ *
+ * @return false if the buffer is malformed
+ */
+static bool
+ForEachTranslationPacket(std::span<const std::byte> src, auto &&f)
+{
+	while (!src.empty()) {
+		TranslationHeader header;
+		if (src.size() < sizeof(header))
+			return false;
+
+		memcpy(&header, src.data(), sizeof(header));
+		src = src.subspan(sizeof(header));
+
+		if (src.size() < header.length)
+			return false;
+
+		f(header.command, src.first(header.length));
+		src = src.subspan(header.length);
+	}
+
+	return true;
+}
+
+static std::chrono::seconds
+FindMaxAge(std::span<const std::byte> response) noexcept
+{
+	std::chrono::seconds max_age{};
+
+	ForEachTranslationPacket(response, [&max_age](TranslationCommand command,
+						      std::span<const std::byte> payload){
+		if (command == TranslationCommand::MAX_AGE &&
+		    payload.size() == sizeof(uint32_t)) {
+			uint32_t value;
+			memcpy(&value, payload.data(), sizeof(value));
+			max_age = std::chrono::seconds{value};
+		}
+	});
+
+	return max_age;
+}
+
+std::string
+TranslationCache::MakeKey(std::string_view plan_name, const char *tag,
+			  const std::forward_list<std::string> &args,
+			  std::span<const unsigned> arg_indices) noexcept
+{
+	std::string key{plan_name};
+	key.push_back('\0');
+
+	if (tag != nullptr)
+		key.append(tag);
+	key.push_back('\0');
+
+	for (const unsigned i : arg_indices) {
+		unsigned n = 1;
+		auto a = args.begin();
+		while (a != args.end() && n < i) {
+			++a;
+			++n;
+		}
+
+		if (a != args.end()) {
+			key.push_back('+');
+			key.append(*a);
+		} else
+			/* distinguish between missing and empty */
+			key.push_back('-');
+
+		key.push_back('\0');
+	}
+
+	return key;
+}
+
+std::span<const std::byte>
+TranslationCache::Get(std::string_view key,
+		      clock_type::time_point now) noexcept
+{
+	auto i = index.find(key);
+	if (i == index.end())
+		return {};
+
+	auto item = i->second;
+	if (now >= item->expires) {
+		Remove(item);
+		return {};
+	}
+
+	/* move to the front of the LRU list */
+	items.splice(items.begin(), items, item);
+	return item->response;
+}
+
+void
+TranslationCache::Put(std::string &&key, std::string_view plan_name,
+		      std::vector<std::byte> &&response,
+		      clock_type::time_point now) noexcept
+{
+	if (!IsEnabled() || response.empty())
+		return;
+
+	const auto max_age = FindMaxAge(response);
+	if (max_age.count() <= 0)
+		/* the translation server did not allow caching */
+		return;
+
+	if (auto i = index.find(key); i != index.end())
+		Remove(i->second);
+
+	while (items.size() >= max_items)
+		Remove(std::prev(items.end()));
+
+	auto &item = items.emplace_front(std::move(key), plan_name,
+					 std::move(response),
+					 now + max_age);
+	index.emplace(item.key, items.begin());
+}
+
+void
+TranslationCache::Invalidate(std::span<const std::byte> payload)
+{
+	std::vector<std::string_view> plans;
+
+	if (!ForEachTranslationPacket(payload, [&plans](TranslationCommand command,
+							std::span<const std::byte> value){
+		if (command == TranslationCommand::PLAN)
+			plans.emplace_back(ToStringView(value));
+	}))
+		throw std::runtime_error{"Malformed TCACHE_INVALIDATE packet"};
+
+	if (plans.empty()) {
+		Flush();
+		return;
+	}
+
+	for (const auto plan_name : plans)
+		InvalidatePlan(plan_name);
+}
+
+void
+TranslationCache::InvalidatePlan(std::string_view plan_name) noexcept
+{
+	for (auto i = items.begin(); i != items.end();) {
+		auto next = std::next(i);
+		if (i->plan_name == plan_name)
+			Remove(i);
+		i = next;
+	}
+}
+
+void
+TranslationCache::Flush() noexcept
+{
+	index.clear();
+	items.clear();
+}
+
+inline void
+TranslationCache::Remove(std::list<Item>::iterator i) noexcept
+{
+	index.erase(i->key);
+	items.erase(i);
+}
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <forward_list>
+#include <list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A bounded LRU cache for raw translation responses of plans with
+ * the "translate_cache" option.  A response is only stored if the
+ * translation server has sent a MAX_AGE packet; it decides how long
+ * the response may be reused.
+ */
+class TranslationCache {
+	using clock_type = std::chrono::steady_clock;
+
+	struct Item {
+		std::string key;
+
+		/**
+		 * The plan name, for InvalidatePlan().
+		 */
+		std::string plan_name;
+
+		std::vector<std::byte> response;
+
+		clock_type::time_point expires;
+
+		Item(std::string &&_key, std::string_view _plan_name,
+		     std::vector<std::byte> &&_response,
+		     clock_type::time_point _expires) noexcept
+			:key(std::move(_key)), plan_name(_plan_name),
+			 response(std::move(_response)),
+			 expires(_expires) {}
+	};
+
+	/**
+	 * All items; the most recently used one is at the front.
+	 */
+	std::list<Item> items;
+
+	struct Hash {
+		using is_transparent = void;
+
+		[[gnu::pure]]
+		std::size_t operator()(std::string_view s) const noexcept {
+			return std::hash<std::string_view>{}(s);
+		}
+	};
+
+	std::unordered_map<std::string_view, std::list<Item>::iterator,
+			   Hash, std::equal_to<>> index;
+
+	const std::size_t max_items;
+
+public:
+	explicit TranslationCache(std::size_t _max_items) noexcept
+		:max_items(_max_items) {}
+
+	TranslationCache(const TranslationCache &) = delete;
+	TranslationCache &operator=(const TranslationCache &) = delete;
+
+	bool IsEnabled() const noexcept {
+		return max_items > 0;
+	}
+
+	/**
+	 * Build a cache key from all parameters which get
+	 * transmitted to the translation server.
+	 *
+	 * @param arg_indices the (1-based) indices of job arguments
+	 * which are part of the key; all others are ignored
+	 */
+	[[gnu::pure]]
+	static std::string MakeKey(std::string_view plan_name,
+				   const char *tag,
+				   const std::forward_list<std::string> &args,
+				   std::span<const unsigned> arg_indices) noexcept;
+
+	/**
+	 * Look up a response.
+	 *
+	 * @return the raw response or an empty span if there is no
+	 * (valid) item; the span is valid until the cache gets
+	 * modified
+	 */
+	std::span<const std::byte> Get(std::string_view key,
+				       clock_type::time_point now) noexcept;
+
+	/**
+	 * Add a response to the cache if it contains a (non-zero)
+	 * MAX_AGE packet.
+	 */
+	void Put(std::string &&key, std::string_view plan_name,
+		 std::vector<std::byte> &&response,
+		 clock_type::time_point now) noexcept;
+
+	/**
+	 * Handle a TCACHE_INVALIDATE control packet.  Its payload
+	 * consists of translation packets; each PLAN packet
+	 * invalidates all responses of that plan.  Without any PLAN
+	 * packet, the whole cache is flushed.
+	 *
+	 * Throws on malformed payload.
+	 */
+	void Invalidate(std::span<const std::byte> payload);
+
+	void InvalidatePlan(std::string_view plan_name) noexcept;
+
+	void Flush() noexcept;
+
+private:
+	void Remove(std::list<Item>::iterator i) noexcept;
+};
@@ -4,9 +4,10 @@
 
 #include "Workplace.hxx"
 #include "Operator.hxx"
+#include "PlanProcess.hxx"
+#include "PreforkPool.hxx"
 #include "Plan.hxx"
 #include "Job.hxx"
-#include "pg/Array.hxx"
 #include "spawn/Prepared.hxx"
 #include "spawn/CgroupOptions.hxx"
 #include "spawn/Interface.hxx"
@@ -17,10 +18,9 @@
 #include "io/Pipe.hxx"
 #include "util/DeleteDisposer.hxx"
 
+#include <algorithm> // for std::min()
 #include <cassert>
 #include <string>
-#include <map>
-#include <set>
 #include <list>
 #include <tuple> // for std::tie()
 
@@ -30,19 +30,35 @@ WorkshopWorkplace::WorkshopWorkplace(SpawnService &_spawn_service,
 				     ExitListener &_exit_listener,
 				     const Logger &parent_logger,
 				     const char *_node_name,
-				     SocketAddress _translation_socket,
+				     TranslationService *_translation_service,
 				     const char *_listener_tag,
+				     std::size_t _translation_cache_size,
 				     std::size_t _max_operators,
-				     bool _enable_journal) noexcept
+				     std::string_view _log_spool,
+				     SocketDescriptor _pond_socket,
+				     bool _enable_journal,
+				     unsigned _journal_rate) noexcept
 	:spawn_service(_spawn_service), exit_listener(_exit_listener),
 	 logger(parent_logger, "workplace"),
 	 node_name(_node_name),
-	 translation_socket(_translation_socket),
+	 translation_service(_translation_service),
 	 listener_tag(_listener_tag),
+	 translation_cache(_translation_cache_size),
 	 max_operators(_max_operators),
-	 enable_journal(_enable_journal)
+	 slot_limit(_max_operators),
+	 log_spool(_log_spool),
+	 pond_socket(_pond_socket),
+	 enable_journal(_enable_journal),
+	 journal_rate(_journal_rate)
 {
 	assert(max_operators > 0);
+
+	try {
+		numa.Load();
+	} catch (...) {
+		logger(2, "Failed to read the NUMA topology: ",
+		       std::current_exception());
+	}
 }
 
 WorkshopWorkplace::~WorkshopWorkplace() noexcept
@@ -50,57 +66,220 @@ WorkshopWorkplace::~WorkshopWorkplace() noexcept
 	assert(operators.empty());
 }
 
-std::string
-WorkshopWorkplace::GetRunningPlanNames() const noexcept
+bool
+WorkshopWorkplace::IsFull() const noexcept
+{
+	std::size_t n = operators.size();
+
+	for (const auto &[name, pool] : prefork_pools)
+		if (pool->GetPlan()->worker > 0)
+			n += pool->GetIdleCount();
+
+	return n >= slot_limit;
+}
+
+PreforkPool &
+WorkshopWorkplace::MakePool(EventLoop &event_loop,
+			    std::string_view plan_name,
+			    const std::shared_ptr<Plan> &plan) noexcept
 {
-	std::set<std::string_view, std::less<>> list;
-	for (const auto &o : operators)
-		list.emplace(o.GetPlanName());
+	auto i = prefork_pools.find(plan_name);
+	if (i == prefork_pools.end())
+		i = prefork_pools.emplace(plan_name, nullptr).first;
+	else if (i->second && i->second->GetPlan() == plan.get())
+		return *i->second;
+
+	/* (re)create the pool; after the plan has been reloaded, the
+	   old processes are obsolete */
+	i->second.reset();
+
+	std::size_t size = plan->prefork;
+	const bool reuse = plan->worker > 0;
+
+	if (reuse) {
+		/* idle workers occupy slots; leave at least one slot
+		   for other plans to avoid starving them */
+		std::size_t reserved = 1;
+		for (const auto &[name, pool] : prefork_pools)
+			if (pool && pool->GetPlan()->worker > 0)
+				reserved += pool->GetSize();
+
+		size = reserved < max_operators
+			? std::min<std::size_t>(plan->worker,
+						max_operators - reserved)
+			: 0;
+	}
+
+	i->second = std::make_unique<PreforkPool>(event_loop,
+						  spawn_service,
+						  numa,
+						  logger,
+						  plan_name, plan,
+						  size, reuse);
+	return *i->second;
+}
 
-	return Pg::EncodeArray(list);
+std::optional<PlanProcess>
+WorkshopWorkplace::TakePreforked(EventLoop &event_loop,
+				 std::string_view plan_name,
+				 const std::shared_ptr<Plan> &plan,
+				 bool &busy) noexcept
+{
+	return MakePool(event_loop, plan_name, plan).Take(busy);
 }
 
-std::string
-WorkshopWorkplace::GetFullPlanNames() const noexcept
+void
+WorkshopWorkplace::ReleaseWorker(std::string_view plan_name,
+				 const Plan &plan,
+				 PlanProcess *process, bool busy) noexcept
 {
-	std::map<std::string_view, std::size_t, std::less<>> counters;
-	std::set<std::string_view, std::less<>> list;
-	for (const auto &o : operators) {
-		const Plan &plan = o.GetPlan();
-		if (plan.concurrency == 0)
-			continue;
+	auto i = prefork_pools.find(plan_name);
+	if (i == prefork_pools.end() || !i->second ||
+	    i->second->GetPlan() != &plan)
+		/* the plan has been reloaded or removed meanwhile;
+		   discard this obsolete process */
+		return;
 
-		const std::string_view plan_name = o.GetPlanName();
+	if (process != nullptr)
+		i->second->Put(std::move(*process), busy);
+	else
+		i->second->Discard(busy);
+}
 
-		auto i = counters.emplace(plan_name, 0);
-		std::size_t &n = i.first->second;
+WorkshopWorkplace::PlanState
+WorkshopWorkplace::GetPlanState(std::string_view plan_name) const noexcept
+{
+	auto i = running_plans.find(plan_name);
+	if (i == running_plans.end())
+		return PlanState::IDLE;
 
-		++n;
+	return i->second.IsFull()
+		? PlanState::FULL
+		: PlanState::RUNNING;
+}
 
-		if (n >= plan.concurrency)
-			list.emplace(plan_name);
+void
+WorkshopWorkplace::AddRunningPlan(std::string_view plan_name,
+				  const Plan &plan) noexcept
+{
+	bool inserted = false;
+	auto i = running_plans.find(plan_name);
+	if (i == running_plans.end()) {
+		i = running_plans.emplace(plan_name, RunningPlan{}).first;
+		inserted = true;
 	}
 
-	return Pg::EncodeArray(list);
+	RunningPlan &rp = i->second;
+
+	const bool was_full = rp.IsFull();
+
+	++rp.n;
+	rp.concurrency = plan.concurrency;
+
+	if (plan.worker > 0 &&
+	    (rp.concurrency == 0 || rp.concurrency > plan.worker))
+		/* never run more jobs than there are workers */
+		rp.concurrency = plan.worker;
+
+	if (inserted || rp.IsFull() != was_full)
+		changed_plans.emplace(plan_name);
+}
+
+void
+WorkshopWorkplace::RemoveRunningPlan(std::string_view plan_name) noexcept
+{
+	auto i = running_plans.find(plan_name);
+	assert(i != running_plans.end());
+
+	RunningPlan &rp = i->second;
+	assert(rp.n > 0);
+
+	const bool was_full = rp.IsFull();
+
+	if (--rp.n == 0) {
+		changed_plans.emplace(plan_name);
+		running_plans.erase(i);
+	} else if (rp.IsFull() != was_full)
+		changed_plans.emplace(plan_name);
 }
 
 void
-WorkshopWorkplace::Start(EventLoop &event_loop, const WorkshopJob &job,
+WorkshopWorkplace::OnBatchLaunched(WorkshopOperator &o) noexcept
+{
+	if (auto i = collecting_batches.find(o.GetPlanName());
+	    i != collecting_batches.end() && i->second == &o)
+		collecting_batches.erase(i);
+}
+
+void
+WorkshopWorkplace::Start(EventLoop &event_loop, WorkshopJob &&job,
 			 std::shared_ptr<Plan> plan,
 			 size_t max_log) noexcept
 {
 	assert(plan->translate || !plan->args.empty());
 
+	if (plan->batch > 0) {
+		if (auto i = collecting_batches.find(job.plan_name);
+		    i != collecting_batches.end()) {
+			auto &o = *i->second;
+			if (&o.GetPlan() == plan.get()) {
+				o.AddBatchJob(std::move(job));
+
+				if (o.GetBatchSize() >= plan->batch) {
+					/* the batch is complete */
+					collecting_batches.erase(i);
+					o.LaunchBatch();
+				}
+
+				return;
+			}
+
+			/* the plan has been reloaded; launch the old
+			   batch now and start a new one */
+			collecting_batches.erase(i);
+			o.LaunchBatch();
+		}
+
+		AddRunningPlan(job.plan_name, *plan);
+
+		auto *o = new WorkshopOperator(event_loop, *this,
+					       std::move(job), std::move(plan));
+		operators.push_back(*o);
+
+		collecting_batches.emplace(o->GetPlanName(), o);
+		o->CollectBatch(max_log, enable_journal);
+		return;
+	}
+
+	const bool worker = plan->worker > 0;
+
+	std::optional<PlanProcess> process;
+	bool busy = false;
+	if (plan->prefork > 0 || worker)
+		process = TakePreforked(event_loop, job.plan_name, plan, busy);
+
 	/* create operator object */
 
-	auto *o = new WorkshopOperator(event_loop, *this, job, std::move(plan));
+	AddRunningPlan(job.plan_name, *plan);
+
+	auto *o = new WorkshopOperator(event_loop, *this,
+				       std::move(job), std::move(plan));
 	operators.push_back(*o);
-	o->Start(max_log, enable_journal);
+
+	if (worker)
+		o->StartWorker(max_log, enable_journal, std::move(process),
+			       busy);
+	else if (process)
+		o->Start(max_log, enable_journal, std::move(*process));
+	else
+		o->Start(max_log, enable_journal);
 }
 
 void
 WorkshopWorkplace::OnExit(WorkshopOperator *o) noexcept
 {
+	RemoveRunningPlan(o->GetPlanName());
+
 	operators.erase_and_dispose(operators.iterator_to(*o),
 				    DeleteDisposer{});
 
@@ -118,13 +297,22 @@ WorkshopWorkplace::CancelJob(std::string_view id) noexcept
 {
 	const auto n = operators.remove_and_dispose_if([id](const auto &o){
 		return o.IsId(id);
-	}, [](auto *o) {
+	}, [this](auto *o) {
 		o->Cancel();
+		RemoveRunningPlan(o->GetPlanName());
 		delete o;
 	});
 
-	if (n > 0)
+	if (n > 0) {
 		exit_listener.OnChildProcessExit(-1);
+		return;
+	}
+
+	/* not the current job of an operator; maybe it is waiting in
+	   a batch */
+	for (auto &o : operators)
+		if (o.CancelBatchJob(id))
+			break;
 }
 
 void
@@ -132,8 +320,9 @@ WorkshopWorkplace::CancelTag(std::string_view tag) noexcept
 {
 	const auto n = operators.remove_and_dispose_if([tag](const auto &o){
 		return o.IsChildTag(tag);
-	}, [](auto *o) {
+	}, [this](auto *o) {
 		o->Cancel();
+		RemoveRunningPlan(o->GetPlanName());
 		delete o;
 	});
 
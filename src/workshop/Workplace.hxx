@@ -4,19 +4,30 @@
 
 #pragma once
 
+#include "TranslationCache.hxx"
+#include "NumaTopology.hxx"
 #include "io/Logger.hxx"
-#include "net/SocketAddress.hxx"
+#include "net/SocketDescriptor.hxx"
 #include "util/IntrusiveList.hxx"
 
+#include <algorithm> // for std::min()
+#include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <utility> // for std::exchange()
 
 struct Plan;
+struct PlanProcess;
 struct WorkshopJob;
+class PreforkPool;
 class WorkshopOperator;
 class EventLoop;
 class SpawnService;
 class ExitListener;
+class TranslationService;
 
 class WorkshopWorkplace {
 	SpawnService &spawn_service;
@@ -33,21 +44,107 @@ class WorkshopWorkplace {
 
 	OperatorList operators;
 
-	const SocketAddress translation_socket;
+	struct RunningPlan {
+		/**
+		 * The number of operators executing this plan.
+		 */
+		std::size_t n = 0;
+
+		/**
+		 * A copy of #Plan::concurrency of the most recently
+		 * started operator (limited to #Plan::worker for
+		 * worker plans).
+		 */
+		unsigned concurrency = 0;
+
+		[[gnu::pure]]
+		bool IsFull() const noexcept {
+			return concurrency > 0 && n >= concurrency;
+		}
+	};
+
+	/**
+	 * Per-plan operator counters.  They are updated
+	 * incrementally each time an operator is added or removed.
+	 */
+	std::map<std::string, RunningPlan, std::less<>> running_plans;
+
+	/**
+	 * The names of plans whose #PlanState has flipped since the
+	 * last TakeChangedPlans() call.
+	 */
+	std::set<std::string, std::less<>> changed_plans;
+
+	/**
+	 * Connections to the translation server; nullptr if none was
+	 * configured.
+	 */
+	TranslationService *const translation_service;
 	const char *const listener_tag;
 
+	TranslationCache translation_cache;
+
+	/**
+	 * Jobs of plans with "cpuset auto" are distributed over
+	 * these NUMA nodes.  Declared before #prefork_pools, because
+	 * their processes refer to the nodes.
+	 */
+	NumaTopology numa;
+
+	/**
+	 * Pools of pre-forked processes for plans with the "prefork"
+	 * or "worker" option.
+	 */
+	std::map<std::string, std::unique_ptr<PreforkPool>, std::less<>> prefork_pools;
+
+	/**
+	 * Operators of plans with the "batch" option which are still
+	 * collecting jobs.
+	 */
+	std::map<std::string, WorkshopOperator *, std::less<>> collecting_batches;
+
 	const std::size_t max_operators;
+
+	/**
+	 * The number of slots which may currently be occupied; this
+	 * may be lowered below #max_operators by the
+	 * #PressureController.
+	 */
+	std::size_t slot_limit;
+
+
+	/**
+	 * The directory for log files (configuration setting
+	 * "log_spool"); empty if disabled.
+	 */
+	const std::string log_spool;
+
+	/**
+	 * Job output is sent to this Pond server (configuration
+	 * setting "pond_server"); undefined if disabled.
+	 */
+	const SocketDescriptor pond_socket;
+
 	const bool enable_journal;
 
+	/**
+	 * See WorkshopPartitionConfig::journal_rate.
+	 */
+	const unsigned journal_rate;
+
 public:
 	WorkshopWorkplace(SpawnService &_spawn_service,
 			  ExitListener &_exit_listener,
 			  const Logger &parent_logger,
 			  const char *_node_name,
-			  SocketAddress _translation_socket,
+			  TranslationService *_translation_service,
 			  const char *_listener_tag,
+			  std::size_t _translation_cache_size,
 			  std::size_t _max_operators,
-			  bool _enable_journal) noexcept;
+			  std::string_view _log_spool,
+			  SocketDescriptor _pond_socket,
+			  bool _enable_journal,
+			  unsigned _journal_rate) noexcept;
 
 	WorkshopWorkplace(const WorkshopWorkplace &other) = delete;
 	WorkshopWorkplace &operator=(const WorkshopWorkplace &other) = delete;
@@ -63,42 +160,170 @@ public:
 		return operators.empty();
 	}
 
-	bool IsFull() const noexcept {
-		return operators.size() == max_operators;
+	/**
+	 * Are all slots occupied?  Idle worker processes (plan option
+	 * "worker") occupy a slot, too.
+	 *
+	 * Parked "prefork" processes do not: they are only spares for
+	 * jobs which would occupy a slot anyway, and their number is
+	 * bounded by the plan option.  Pools of plans which
+	 * disappear are discarded by PrunePools().
+	 */
+	[[gnu::pure]]
+	bool IsFull() const noexcept;
+
+	/**
+	 * Change the number of slots which may be occupied (clamped
+	 * to the configured maximum).
+	 */
+	void SetSlotLimit(std::size_t n) noexcept {
+		slot_limit = std::min(n, max_operators);
+	}
+
+	/**
+	 * Is there a batch of this plan which is still collecting
+	 * jobs?  Adding a job to it does not need another slot.
+	 */
+	[[gnu::pure]]
+	bool IsCollectingBatch(std::string_view plan_name) const noexcept {
+		return collecting_batches.contains(plan_name);
 	}
 
 	auto &GetSpawnService() const noexcept {
 		return spawn_service;
 	}
 
-	SocketAddress GetTranslationSocket() const noexcept {
-		return translation_socket;
+	/**
+	 * Choose the NUMA node for a new process of a plan with
+	 * "cpuset auto".
+	 *
+	 * @return the node or an empty lease if this is not a NUMA
+	 * machine
+	 */
+	NumaNodeLease AcquireNumaNode() noexcept {
+		return numa.Acquire();
+	}
+
+	TranslationService *GetTranslationService() const noexcept {
+		return translation_service;
 	}
 
 	const char *GetListenerTag() const noexcept {
 		return listener_tag;
 	}
 
+	TranslationCache &GetTranslationCache() noexcept {
+		return translation_cache;
+	}
+
+	std::string_view GetLogSpool() const noexcept {
+		return log_spool;
+	}
+
+	SocketDescriptor GetPondSocket() const noexcept {
+		return pond_socket;
+	}
+
+	unsigned GetJournalRate() const noexcept {
+		return journal_rate;
+	}
+
+	enum class PlanState {
+		/**
+		 * No job of this plan is running.
+		 */
+		IDLE,
+
+		/**
+		 * At least one job of this plan is running.
+		 */
+		RUNNING,
+
+		/**
+		 * The plan has reached its concurrency limit.
+		 */
+		FULL,
+	};
+
 	[[gnu::pure]]
-	std::string GetRunningPlanNames() const noexcept;
+	PlanState GetPlanState(std::string_view plan_name) const noexcept;
 
 	/**
-	 * Returns the plan names which have reached their concurrency
-	 * limit.
+	 * Returns the names of all plans whose GetPlanState() result
+	 * has changed since the last call.
 	 */
-	[[gnu::pure]]
-	std::string GetFullPlanNames() const noexcept;
+	std::set<std::string, std::less<>> TakeChangedPlans() noexcept {
+		return std::exchange(changed_plans, {});
+	}
+
+	/**
+	 * Discard the pools of plans which have been removed,
+	 * disabled, deinstalled or reloaded; this kills their parked
+	 * processes.  Busy worker processes of those plans are killed
+	 * when their job finishes.
+	 *
+	 * @param is_current a function which gets the plan name and
+	 * the #Plan of a pool and returns true if this is still the
+	 * current version of an available plan
+	 */
+	template<typename F>
+	void PrunePools(F &&is_current) noexcept {
+		std::erase_if(prefork_pools, [&is_current](const auto &i){
+			return !i.second ||
+				!is_current(i.first, *i.second->GetPlan());
+		});
+	}
 
 	/**
 	 * Throws std::runtime_error on error.
 	 */
-	void Start(EventLoop &event_loop, const WorkshopJob &job,
+	void Start(EventLoop &event_loop, WorkshopJob &&job,
 		   std::shared_ptr<Plan> plan,
 		   size_t max_log) noexcept;
 
+	/**
+	 * The operator has stopped collecting jobs for its batch (or
+	 * is being destroyed).
+	 */
+	void OnBatchLaunched(WorkshopOperator &o) noexcept;
+
 	void OnExit(WorkshopOperator *o) noexcept;
 	void OnTimeout(WorkshopOperator *o) noexcept;
 
+	/**
+	 * An operator of a worker plan has finished.  Give its worker
+	 * process back to the pool.
+	 *
+	 * @param process the worker process or nullptr if it has
+	 * exited or shall be killed
+	 * @param busy the value returned by PreforkPool::Take()
+	 */
+	void ReleaseWorker(std::string_view plan_name, const Plan &plan,
+			   PlanProcess *process, bool busy) noexcept;
+
 	void CancelJob(std::string_view id) noexcept;
 	void CancelTag(std::string_view tag) noexcept;
+
+private:
+	/**
+	 * Return the plan's #PreforkPool, creating it if necessary.
+	 */
+	PreforkPool &MakePool(EventLoop &event_loop,
+			      std::string_view plan_name,
+			      const std::shared_ptr<Plan> &plan) noexcept;
+
+	/**
+	 * Take a pre-forked process from the plan's pool (creating
+	 * the pool if necessary).
+	 *
+	 * @param busy see PreforkPool::Take()
+	 */
+	std::optional<PlanProcess> TakePreforked(EventLoop &event_loop,
+						 std::string_view plan_name,
+						 const std::shared_ptr<Plan> &plan,
+						 bool &busy) noexcept;
+
+	void AddRunningPlan(std::string_view plan_name,
+			    const Plan &plan) noexcept;
+	void RemoveRunningPlan(std::string_view plan_name) noexcept;
 };
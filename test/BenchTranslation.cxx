@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+/*
+ * Benchmark for the translation client: sends many TranslateSpawn()
+ * requests to a trivial in-process translation server, either over
+ * pooled connections (the default) or with one new connection per
+ * request (--connect, which is what Workshop used to do).
+ *
+ * Usage: BenchTranslation [--connect] [REQUESTS [CONCURRENCY]]
+ */
+
+#include "translation/Marshal.hxx"
+#include "translation/SpawnClient.hxx"
+#include "translation/Stock.hxx"
+#include "translation/Response.hxx"
+#include "AllocatorPtr.hxx"
+#include "event/Loop.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+#include "co/InvokeTask.hxx"
+#include "co/Task.hxx"
+#include "util/BindMethod.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringCompare.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <forward_list>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+/**
+ * Serve one connection: reply to each request with an empty
+ * response.
+ */
+static void
+ServeConnection(int fd) noexcept
+{
+	TranslationMarshaller m;
+	m.Write(TranslationCommand::BEGIN);
+	m.Write(TranslationCommand::END);
+	const auto response = m.Commit();
+
+	std::vector<std::byte> buffer;
+	std::byte tmp[4096];
+
+	while (true) {
+		ssize_t nbytes = recv(fd, tmp, sizeof(tmp), 0);
+		if (nbytes <= 0)
+			break;
+
+		buffer.insert(buffer.end(), tmp, tmp + nbytes);
+
+		/* find complete requests (terminated by an END
+		   packet) */
+		std::size_t position = 0;
+		while (buffer.size() - position >= sizeof(TranslationHeader)) {
+			TranslationHeader header;
+			memcpy(&header, buffer.data() + position, sizeof(header));
+
+			const std::size_t packet_size = sizeof(header) + header.length;
+			if (buffer.size() - position < packet_size)
+				break;
+
+			position += packet_size;
+
+			if (header.command == TranslationCommand::END) {
+				if (send(fd, response.data(), response.size(),
+					 MSG_NOSIGNAL) < 0) {
+					close(fd);
+					return;
+				}
+
+				buffer.erase(buffer.begin(), buffer.begin() + position);
+				position = 0;
+			}
+		}
+	}
+
+	close(fd);
+}
+
+static void
+RunServer(int listen_fd) noexcept
+{
+	while (true) {
+		int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0)
+			break;
+
+		std::thread{ServeConnection, fd}.detach();
+	}
+}
+
+static AllocatedSocketAddress
+StartServer()
+{
+	int fd = socket(AF_LOCAL, SOCK_STREAM|SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		throw std::runtime_error{"socket() failed"};
+
+	/* an abstract socket with a unique name */
+	const auto name = fmt::format("\0cm4all-workshop-bench-translation-{}"sv,
+				      getpid());
+
+	struct sockaddr_un sun{};
+	sun.sun_family = AF_LOCAL;
+	memcpy(sun.sun_path, name.data(), name.size());
+	const auto size = offsetof(struct sockaddr_un, sun_path) + name.size();
+
+	if (bind(fd, (const struct sockaddr *)&sun, size) < 0 ||
+	    listen(fd, 256) < 0)
+		throw std::runtime_error{"Failed to bind the translation server socket"};
+
+	std::thread{RunServer, fd}.detach();
+
+	return AllocatedSocketAddress{SocketAddress{(const struct sockaddr *)&sun,
+						    static_cast<SocketAddress::size_type>(size)}};
+}
+
+struct Benchmark {
+	EventLoop event_loop;
+
+	const SocketAddress address;
+
+	TranslationStock stock;
+
+	unsigned remaining;
+	unsigned running = 0;
+	unsigned errors = 0;
+
+	const bool connect;
+
+	Benchmark(SocketAddress _address, unsigned requests,
+		  unsigned concurrency, bool _connect) noexcept
+		:address(_address),
+		 stock(event_loop, address, concurrency),
+		 remaining(requests),
+		 connect(_connect) {}
+};
+
+class Worker {
+	Benchmark &benchmark;
+
+	Co::InvokeTask task;
+
+public:
+	explicit Worker(Benchmark &_benchmark) noexcept
+		:benchmark(_benchmark) {}
+
+	void Start() noexcept {
+		++benchmark.running;
+		task = Run();
+		task.Start(BIND_THIS_METHOD(OnCompletion));
+	}
+
+private:
+	Co::Task<void> Request(TranslationStock &stock) {
+		Allocator alloc;
+		co_await TranslateSpawn(stock, alloc, nullptr,
+					"bench", "", nullptr, {});
+	}
+
+	Co::InvokeTask Run() {
+		while (benchmark.remaining > 0) {
+			--benchmark.remaining;
+
+			if (benchmark.connect) {
+				/* a throw-away stock which creates one
+				   new connection */
+				TranslationStock stock{benchmark.event_loop,
+						       benchmark.address, 1};
+				co_await Request(stock);
+			} else
+				co_await Request(benchmark.stock);
+		}
+	}
+
+	void OnCompletion(std::exception_ptr &&error) noexcept {
+		if (error) {
+			PrintException(error);
+			++benchmark.errors;
+		}
+
+		if (--benchmark.running == 0)
+			benchmark.event_loop.Break();
+	}
+};
+
+int
+main(int argc, char **argv)
+try {
+	bool connect = false;
+	unsigned requests = 100000, concurrency = 16;
+
+	int i = 1;
+	if (i < argc && StringIsEqual(argv[i], "--connect")) {
+		connect = true;
+		++i;
+	}
+
+	if (i < argc)
+		requests = strtoul(argv[i++], nullptr, 10);
+
+	if (i < argc)
+		concurrency = strtoul(argv[i++], nullptr, 10);
+
+	if (requests == 0 || concurrency == 0)
+		throw std::runtime_error{"Invalid arguments"};
+
+	const auto address = StartServer();
+
+	Benchmark benchmark{address, requests, concurrency, connect};
+
+	std::forward_list<Worker> workers;
+	for (unsigned j = 0; j < concurrency; ++j)
+		workers.emplace_front(benchmark);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (auto &w : workers)
+		w.Start();
+
+	benchmark.event_loop.Run();
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("{} requests in {:.3f}s ({:.0f} requests/s), {} errors\n",
+		   requests, duration.count(),
+		   requests / duration.count(),
+		   benchmark.errors);
+
+	return benchmark.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
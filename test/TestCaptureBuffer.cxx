@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "CaptureBuffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace std::string_view_literals;
+
+static void
+Append(CaptureBuffer &b, std::string_view s) noexcept
+{
+	b.Append(std::span{s.data(), s.size()});
+}
+
+TEST(CaptureBuffer, Small)
+{
+	CaptureBuffer b{256};
+	EXPECT_TRUE(b.IsEmpty());
+
+	Append(b, "foo\n"sv);
+	Append(b, "bar\n"sv);
+
+	EXPECT_FALSE(b.IsEmpty());
+	EXPECT_FALSE(b.IsTruncated());
+	EXPECT_EQ(b.GetText(), "foo\nbar\n");
+}
+
+TEST(CaptureBuffer, ExactlyFull)
+{
+	CaptureBuffer b{256};
+
+	const std::string s(256, 'x');
+	Append(b, s);
+
+	EXPECT_FALSE(b.IsTruncated());
+	EXPECT_EQ(b.GetText(), s);
+}
+
+TEST(CaptureBuffer, KeepsHeadAndTail)
+{
+	CaptureBuffer b{256};
+
+	Append(b, "first line\n"sv);
+	for (unsigned i = 0; i < 1000; ++i)
+		Append(b, "filler filler filler\n"sv);
+	Append(b, "error: last line\n"sv);
+
+	EXPECT_TRUE(b.IsTruncated());
+
+	const auto text = b.GetText();
+	EXPECT_LE(text.size(), 256u);
+	EXPECT_TRUE(text.starts_with("first line\n"sv));
+	EXPECT_TRUE(text.ends_with("error: last line\n"sv));
+	EXPECT_NE(text.find(" bytes omitted ...]\n"sv), text.npos);
+}
+
+TEST(CaptureBuffer, HugeAppend)
+{
+	CaptureBuffer b{256};
+
+	std::string s(10000, 'x');
+	s.front() = 'A';
+	s.back() = 'Z';
+	Append(b, s);
+
+	const auto text = b.GetText();
+	EXPECT_LE(text.size(), 256u);
+	EXPECT_EQ(text.front(), 'A');
+	EXPECT_EQ(text.back(), 'Z');
+}
+
+TEST(CaptureBuffer, OmittedCount)
+{
+	CaptureBuffer b{256};
+
+	/* head=64, tail=192; this discards 256 bytes from the ring
+	   buffer, and GetText() sacrifices 48 more for the marker */
+	Append(b, std::string(512, 'x'));
+
+	const auto text = b.GetText();
+	EXPECT_NE(text.find("[... 304 bytes omitted ...]"sv), text.npos);
+	EXPECT_EQ(text.size(), 64 + 29 + 144);
+}
+
+TEST(CaptureBuffer, Clear)
+{
+	CaptureBuffer b{256};
+
+	Append(b, std::string(1000, 'x'));
+	EXPECT_TRUE(b.IsTruncated());
+
+	b.Clear();
+	EXPECT_TRUE(b.IsEmpty());
+	EXPECT_FALSE(b.IsTruncated());
+
+	Append(b, "foo"sv);
+	EXPECT_EQ(b.GetText(), "foo");
+}
+
+TEST(CaptureBuffer, UTF8)
+{
+	CaptureBuffer b{256};
+
+	/* "ä" is 2 bytes; an odd filler size puts the truncation
+	   points in the middle of a sequence */
+	std::string s = "x";
+	for (unsigned i = 0; i < 500; ++i)
+		s += "ä";
+	s += "x";
+	Append(b, s);
+
+	const auto text = b.GetText();
+	const auto marker = text.find("\n[..."sv);
+	ASSERT_NE(marker, text.npos);
+
+	/* the head does not end with an incomplete sequence */
+	EXPECT_NE(static_cast<unsigned char>(text[marker - 1]), 0xc3);
+
+	/* the tail does not begin with a continuation byte */
+	const auto tail = text.find("...]\n"sv) + 5;
+	EXPECT_EQ(static_cast<unsigned char>(text[tail]), 0xc3);
+}
+
+TEST(CaptureBuffer, ASCII)
+{
+	CaptureBuffer b{256, UTF8Sanitizer::Mode::ASCII};
+
+	Append(b, "foo\tbär\x01\n"sv);
+
+	EXPECT_EQ(b.GetText(), "foo\tb  r \n");
+}
+
+TEST(CaptureBuffer, Sanitize)
+{
+	CaptureBuffer b{256};
+
+	/* a sequence split between two chunks, an invalid byte and
+	   an incomplete sequence at the end */
+	Append(b, "a\xc3"sv);
+	Append(b, "\xa4\xff\x01" "b\xe2\x82"sv);
+
+	EXPECT_EQ(b.GetText(), "a\xc3\xa4\xef\xbf\xbd b\xef\xbf\xbd");
+}
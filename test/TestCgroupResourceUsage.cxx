@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "CgroupResourceUsage.hxx"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(CgroupResourceUsage, ParsePressureTotal)
+{
+	EXPECT_EQ(ParsePressureTotal("some avg10=0.00 avg60=0.12 avg300=0.05 total=1234567"),
+		  1234567us);
+	EXPECT_EQ(ParsePressureTotal("some avg10=0.00 avg60=0.00 avg300=0.00 total=0"),
+		  0us);
+
+	/* only the "some" line counts */
+	EXPECT_FALSE(ParsePressureTotal("full avg10=0.00 avg60=0.00 avg300=0.00 total=42"));
+
+	EXPECT_FALSE(ParsePressureTotal(""));
+	EXPECT_FALSE(ParsePressureTotal("some avg10=0.00"));
+	EXPECT_FALSE(ParsePressureTotal("some total=x"));
+}
+
+TEST(CgroupResourceUsage, IoStat)
+{
+	CgroupResourceUsage u;
+	u.AddIoStatLine("8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 dbytes=0 dios=0");
+	u.AddIoStatLine("8:16 rbytes=800 wbytes=200 rios=1 wios=1 dbytes=0 dios=0");
+	EXPECT_EQ(u.io_read_bytes, 1460000u);
+	EXPECT_EQ(u.io_write_bytes, 314773704u);
+
+	/* other keys do not create the values */
+	CgroupResourceUsage v;
+	v.AddIoStatLine("8:0 rios=192 wios=353");
+	EXPECT_FALSE(v.io_read_bytes);
+	EXPECT_FALSE(v.io_write_bytes);
+}
+
+TEST(CgroupResourceUsage, Update)
+{
+	CgroupResourceUsage u;
+	u.memory_peak = 1000;
+	u.io_read_bytes = 10;
+	u.cpu_pressure = 5us;
+
+	CgroupResourceUsage newer;
+	newer.memory_peak = 500;
+	newer.io_read_bytes = 20;
+	newer.io_write_bytes = 7;
+	u.Update(newer);
+
+	/* the peak keeps the maximum */
+	EXPECT_EQ(u.memory_peak, 1000u);
+
+	/* cumulative counters are replaced */
+	EXPECT_EQ(u.io_read_bytes, 20u);
+	EXPECT_EQ(u.io_write_bytes, 7u);
+
+	/* missing values are kept */
+	EXPECT_EQ(u.cpu_pressure, 5us);
+	EXPECT_FALSE(u.memory_pressure);
+
+	newer = {};
+	newer.memory_peak = 2000;
+	u.Update(newer);
+	EXPECT_EQ(u.memory_peak, 2000u);
+	EXPECT_EQ(u.io_read_bytes, 20u);
+}
+
+TEST(CgroupResourceUsage, Since)
+{
+	CgroupResourceUsage start;
+	start.memory_peak = 1000;
+	start.io_read_bytes = 10;
+	start.io_write_bytes = 100;
+	start.cpu_pressure = 5us;
+
+	CgroupResourceUsage end;
+	end.memory_peak = 3000;
+	end.io_read_bytes = 15;
+	end.io_write_bytes = 50;
+	end.cpu_pressure = 8us;
+	end.memory_pressure = 4us;
+
+	const auto d = end.Since(start);
+	EXPECT_EQ(d.memory_peak, 3000u);
+	EXPECT_EQ(d.io_read_bytes, 5u);
+
+	/* the counter was reset */
+	EXPECT_EQ(d.io_write_bytes, 50u);
+
+	EXPECT_EQ(d.cpu_pressure, 3us);
+
+	/* no start value */
+	EXPECT_EQ(d.memory_pressure, 4us);
+
+	/* no end value */
+	EXPECT_FALSE(d.io_pressure);
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/CgroupValue.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+TEST(CgroupValue, Memory)
+{
+	EXPECT_EQ(ParseCgroupMemory("max", "x"), "max");
+	EXPECT_EQ(ParseCgroupMemory("4096", "x"), "4096");
+
+	/* both cases are accepted for all suffixes */
+	EXPECT_EQ(ParseCgroupMemory("2k", "x"), "2048");
+	EXPECT_EQ(ParseCgroupMemory("2K", "x"), "2048");
+	EXPECT_EQ(ParseCgroupMemory("3m", "x"), "3145728");
+	EXPECT_EQ(ParseCgroupMemory("3M", "x"), "3145728");
+	EXPECT_EQ(ParseCgroupMemory("1g", "x"), "1073741824");
+	EXPECT_EQ(ParseCgroupMemory("1G", "x"), "1073741824");
+	EXPECT_EQ(ParseCgroupMemory("1t", "x"), "1099511627776");
+	EXPECT_EQ(ParseCgroupMemory("1T", "x"), "1099511627776");
+
+	EXPECT_THROW(ParseCgroupMemory("", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMemory("0", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMemory("k", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMemory("1x", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMemory("1kB", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMemory("1 M", "x"), std::runtime_error);
+
+	/* overflow */
+	EXPECT_THROW(ParseCgroupMemory("16777216T", "x"), std::runtime_error);
+	EXPECT_EQ(ParseCgroupMemory("16777215T", "x"), "18446742974197923840");
+}
+
+TEST(CgroupValue, Max)
+{
+	EXPECT_EQ(ParseCgroupMax("max", "x"), "max");
+	EXPECT_EQ(ParseCgroupMax("42", "x"), "42");
+
+	EXPECT_THROW(ParseCgroupMax("0", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMax("", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMax("42k", "x"), std::runtime_error);
+	EXPECT_THROW(ParseCgroupMax("MAX", "x"), std::runtime_error);
+}
+
+TEST(CgroupValue, Unsigned)
+{
+	EXPECT_EQ(ParseUnsigned("1", 1, 10000, "x"), 1u);
+	EXPECT_EQ(ParseUnsigned("10000", 1, 10000, "x"), 10000u);
+
+	EXPECT_THROW(ParseUnsigned("0", 1, 10000, "x"), std::runtime_error);
+	EXPECT_THROW(ParseUnsigned("10001", 1, 10000, "x"), std::runtime_error);
+	EXPECT_THROW(ParseUnsigned("1.5", 1, 10000, "x"), std::runtime_error);
+}
@@ -46,3 +46,34 @@ TEST(Expand, LeavesUnterminatedPlaceholderLiteral)
 
 	EXPECT_EQ(value, "prefix-${JOB");
 }
+
+TEST(ExpandTemplate, MatchesExpand)
+{
+	static constexpr std::string_view names[] = {"JOB"sv, "PLAN"sv};
+	static constexpr std::string_view values[] = {"42"sv, "nightly"sv};
+
+	StringMap vars{
+		{"JOB"sv, "42"sv},
+		{"PLAN"sv, "nightly"sv},
+	};
+
+	for (const char *src : {"", "plain", "${PLAN}", "a-${JOB}-${PLAN}-b",
+				"${MISSING}x", "prefix-${JOB"}) {
+		const ExpandTemplate t{src, names};
+
+		std::string expected = src;
+		Expand(expected, vars);
+
+		EXPECT_EQ(t.Expand(values), expected);
+	}
+}
+
+TEST(ExpandTemplate, IsConstant)
+{
+	static constexpr std::string_view names[] = {"JOB"sv};
+
+	EXPECT_TRUE((ExpandTemplate{"plain"sv, names}.IsConstant()));
+	EXPECT_TRUE((ExpandTemplate{"prefix-${JOB"sv, names}.IsConstant()));
+	EXPECT_FALSE((ExpandTemplate{"${JOB}"sv, names}.IsConstant()));
+	EXPECT_FALSE((ExpandTemplate{"${MISSING}"sv, names}.IsConstant()));
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/LogTail.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+static std::string
+Tail(std::string_view src, bool truncated)
+{
+	std::string buffer{src};
+	SanitizeLogTail(buffer, truncated);
+	return buffer;
+}
+
+TEST(LogTail, Complete)
+{
+	/* not truncated: nothing is discarded */
+	EXPECT_EQ(Tail("", false), "");
+	EXPECT_EQ(Tail("foo\nbar\n", false), "foo\nbar\n");
+	EXPECT_EQ(Tail("foo", false), "foo");
+}
+
+TEST(LogTail, LineBoundary)
+{
+	/* the incomplete first line is discarded */
+	EXPECT_EQ(Tail("oo\nbar\n", true), "bar\n");
+	EXPECT_EQ(Tail("oo\nbar", true), "bar");
+
+	/* the cut is exactly at a line boundary; the (complete)
+	   first line can't be told apart and is discarded, too */
+	EXPECT_EQ(Tail("foo\nbar\n", true), "bar\n");
+
+	/* only a trailing line break: keep the text */
+	EXPECT_EQ(Tail("foo\n", true), "foo\n");
+}
+
+TEST(LogTail, UTF8Boundary)
+{
+	/* "ä" is "\xc3\xa4"; the cut is inside it, and there is no
+	   line break */
+	EXPECT_EQ(Tail("\xa4" "bc", true), "bc");
+
+	/* the cut is inside a 3-byte sequence ("€" is
+	   "\xe2\x82\xac") */
+	EXPECT_EQ(Tail("\x82\xac" "x\xe2\x82\xac", true), "x\xe2\x82\xac");
+
+	/* continuation bytes only */
+	EXPECT_EQ(Tail("\x82\xac", true), "");
+
+	/* the line break wins over the UTF-8 rule */
+	EXPECT_EQ(Tail("\xa4\nb\xc3\xa4", true), "b\xc3\xa4");
+}
+
+TEST(LogTail, Invalid)
+{
+	/* invalid sequences are replaced even if not truncated */
+	const auto s = Tail("a\xff" "b\n", false);
+	EXPECT_EQ(s.front(), 'a');
+	EXPECT_NE(s.find('b'), s.npos);
+	EXPECT_EQ(s.find('\xff'), s.npos);
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/NumaTopology.hxx"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <stdlib.h>
+
+/**
+ * A fake sysfs node directory.
+ */
+class FakeNodeDirectory {
+	std::filesystem::path path;
+
+public:
+	FakeNodeDirectory() {
+		char buffer[] = "/tmp/TestNumaTopology.XXXXXX";
+		if (mkdtemp(buffer) == nullptr)
+			throw std::runtime_error{"mkdtemp() failed"};
+		path = buffer;
+	}
+
+	~FakeNodeDirectory() noexcept {
+		std::error_code ec;
+		std::filesystem::remove_all(path, ec);
+	}
+
+	void AddNode(const char *name, const char *cpulist) {
+		std::filesystem::create_directory(path / name);
+		std::ofstream{path / name / "cpulist"} << cpulist << '\n';
+	}
+
+	const char *c_str() const noexcept {
+		return path.c_str();
+	}
+};
+
+TEST(NumaTopology, Single)
+{
+	FakeNodeDirectory d;
+	d.AddNode("node0", "0-7");
+
+	NumaTopology numa;
+	numa.Load(d.c_str());
+	EXPECT_EQ(numa.size(), 1u);
+
+	/* not a NUMA machine */
+	EXPECT_EQ(numa.Acquire().get(), nullptr);
+}
+
+TEST(NumaTopology, Acquire)
+{
+	FakeNodeDirectory d;
+	d.AddNode("node1", "4-7");
+	d.AddNode("node0", "0-3");
+	d.AddNode("node2", ""); // memory-only
+	std::ofstream{std::filesystem::path{d.c_str()} / "possible"} << "0-2\n";
+
+	NumaTopology numa;
+	numa.Load(d.c_str());
+	ASSERT_EQ(numa.size(), 2u);
+
+	auto a = numa.Acquire();
+	ASSERT_NE(a.get(), nullptr);
+	EXPECT_EQ(a.get()->name, "node0");
+	EXPECT_EQ(a.get()->mems, "0");
+	EXPECT_EQ(a.get()->cpus, "0-3");
+
+	auto b = numa.Acquire();
+	ASSERT_NE(b.get(), nullptr);
+	EXPECT_EQ(b.get()->name, "node1");
+
+	/* both have one process: round-robin */
+	auto c = numa.Acquire();
+	EXPECT_EQ(c.get()->name, "node0");
+	EXPECT_EQ(c.get()->n_processes, 2u);
+
+	auto e = numa.Acquire();
+	EXPECT_EQ(e.get()->name, "node1");
+
+	/* node1 has the fewest processes, even though it's node0's
+	   turn */
+	b = {};
+	auto f = numa.Acquire();
+	EXPECT_EQ(f.get()->name, "node1");
+	EXPECT_EQ(f.get()->n_processes, 2u);
+
+	/* releasing processes from node0 makes it preferred */
+	a = {};
+	c = {};
+	auto g = numa.Acquire();
+	EXPECT_EQ(g.get()->name, "node0");
+	EXPECT_EQ(g.get()->n_processes, 1u);
+
+	/* moving a lease does not count twice */
+	NumaNodeLease h = std::move(g);
+	EXPECT_EQ(g.get(), nullptr);
+	EXPECT_EQ(h.get()->n_processes, 1u);
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/PoolCounter.hxx"
+
+#include <gtest/gtest.h>
+
+TEST(PoolCounter, Basic)
+{
+	PoolCounter c{2};
+	EXPECT_EQ(c.GetMissing(0), 2u);
+	EXPECT_EQ(c.GetMissing(2), 0u);
+	EXPECT_EQ(c.GetMissing(3), 0u);
+
+	/* take one of two parked processes */
+	EXPECT_TRUE(c.Acquire(1));
+	EXPECT_EQ(c.GetBusy(), 1u);
+	EXPECT_EQ(c.GetMissing(1), 0u);
+
+	/* take the other one */
+	EXPECT_TRUE(c.Acquire(0));
+	EXPECT_EQ(c.GetBusy(), 2u);
+	EXPECT_EQ(c.GetMissing(0), 0u);
+
+	/* both are given back and parked again */
+	EXPECT_TRUE(c.Release(0, true));
+	EXPECT_TRUE(c.Release(1, true));
+	EXPECT_EQ(c.GetBusy(), 0u);
+	EXPECT_EQ(c.GetMissing(2), 0u);
+}
+
+TEST(PoolCounter, Discard)
+{
+	PoolCounter c{2};
+
+	EXPECT_TRUE(c.Acquire(1));
+
+	/* the process has exited: a replacement is needed */
+	c.Discard(true);
+	EXPECT_EQ(c.GetBusy(), 0u);
+	EXPECT_EQ(c.GetMissing(1), 1u);
+
+	/* unaccounted callers don't change anything */
+	c.Discard(false);
+	EXPECT_EQ(c.GetMissing(1), 1u);
+}
+
+/**
+ * No process is ready, but the pool has a vacancy: the caller's own
+ * process fills it, and no duplicate gets spawned.
+ */
+TEST(PoolCounter, SpawnOwnWithVacancy)
+{
+	PoolCounter c{2};
+
+	/* one process is being spawned, one slot is free */
+	EXPECT_TRUE(c.Acquire(1));
+	EXPECT_EQ(c.GetMissing(1), 0u);
+
+	/* the caller's process is parked */
+	EXPECT_TRUE(c.Release(1, true));
+	EXPECT_EQ(c.GetMissing(2), 0u);
+}
+
+/**
+ * No process is ready and the pool is complete (because processes
+ * are still being spawned): the caller is not accounted, and only
+ * its process is killed after the job, not a pooled one.
+ */
+TEST(PoolCounter, SpawnOwnWhenComplete)
+{
+	PoolCounter c{2};
+
+	/* one worker is busy, one process is being spawned */
+	EXPECT_TRUE(c.Acquire(1));
+
+	/* no process is ready */
+	EXPECT_FALSE(c.Acquire(1));
+	EXPECT_EQ(c.GetBusy(), 1u);
+	EXPECT_EQ(c.GetMissing(1), 0u);
+
+	/* the first worker is given back and parked */
+	EXPECT_TRUE(c.Release(1, true));
+
+	/* the unaccounted process is surplus */
+	EXPECT_FALSE(c.Release(2, false));
+	EXPECT_EQ(c.GetBusy(), 0u);
+	EXPECT_EQ(c.GetMissing(2), 0u);
+}
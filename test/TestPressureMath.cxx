@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/PressureMath.hxx"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(PressureMath, StallPercent)
+{
+	EXPECT_EQ(CalcStallPercent(1000us, 1000us, 5s), 0u);
+	EXPECT_EQ(CalcStallPercent(1000us, 2501000us, 5s), 50u);
+	EXPECT_EQ(CalcStallPercent(0us, 5s, 5s), 100u);
+
+	/* rounded down */
+	EXPECT_EQ(CalcStallPercent(0us, 49999us, 5s), 0u);
+	EXPECT_EQ(CalcStallPercent(0us, 50000us, 5s), 1u);
+
+	/* missing samples */
+	EXPECT_FALSE(CalcStallPercent(std::nullopt, 1000us, 5s));
+	EXPECT_FALSE(CalcStallPercent(1000us, std::nullopt, 5s));
+
+	/* counter reset */
+	EXPECT_FALSE(CalcStallPercent(2000us, 1000us, 5s));
+
+	/* no time has elapsed */
+	EXPECT_FALSE(CalcStallPercent(1000us, 2000us, 0us));
+}
+
+TEST(PressureMath, AdjustSlots)
+{
+	/* above the threshold: shrink, but not below 1 */
+	EXPECT_EQ(AdjustPressureSlots(4, 4, 30, 20), 3u);
+	EXPECT_EQ(AdjustPressureSlots(1, 4, 30, 20), 1u);
+
+	/* between half the threshold and the threshold: keep */
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 20, 20), 3u);
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 10, 20), 3u);
+
+	/* below half the threshold: grow, but not above the maximum */
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 9, 20), 4u);
+	EXPECT_EQ(AdjustPressureSlots(4, 4, 0, 20), 4u);
+
+	/* an odd threshold */
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 2, 5), 4u);
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 3, 5), 3u);
+
+	/* threshold 1: slots come back when there is no pressure */
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 2, 1), 2u);
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 1, 1), 3u);
+	EXPECT_EQ(AdjustPressureSlots(3, 4, 0, 1), 4u);
+}
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "workshop/TranslationCache.hxx"
+#include "translation/Protocol.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+using namespace std::chrono_literals;
+
+static void
+AppendPacket(std::vector<std::byte> &dest, TranslationCommand command,
+	     const void *payload, std::size_t size)
+{
+	const TranslationHeader header{
+		.length = static_cast<uint16_t>(size),
+		.command = command,
+	};
+
+	const auto *h = reinterpret_cast<const std::byte *>(&header);
+	dest.insert(dest.end(), h, h + sizeof(header));
+
+	const auto *p = static_cast<const std::byte *>(payload);
+	dest.insert(dest.end(), p, p + size);
+}
+
+/**
+ * Build a response with a MAX_AGE packet (if non-zero) and a PLAN
+ * packet which makes responses distinguishable.
+ */
+static std::vector<std::byte>
+MakeResponse(std::string_view marker, uint32_t max_age)
+{
+	std::vector<std::byte> response;
+	if (max_age > 0)
+		AppendPacket(response, TranslationCommand::MAX_AGE,
+			     &max_age, sizeof(max_age));
+	AppendPacket(response, TranslationCommand::PLAN,
+		     marker.data(), marker.size());
+	return response;
+}
+
+static bool
+Contains(std::span<const std::byte> haystack, std::string_view needle)
+{
+	const std::string_view s{reinterpret_cast<const char *>(haystack.data()),
+				 haystack.size()};
+	return s.find(needle) != s.npos;
+}
+
+static std::string
+Key(std::string_view plan, const char *tag=nullptr)
+{
+	return TranslationCache::MakeKey(plan, tag, {}, {});
+}
+
+TEST(TranslationCache, MaxAge)
+{
+	const auto now = std::chrono::steady_clock::now();
+	TranslationCache cache{16};
+
+	/* without MAX_AGE, nothing is cached */
+	cache.Put(Key("a"), "a", MakeResponse("r0", 0), now);
+	EXPECT_TRUE(cache.Get(Key("a"), now).empty());
+
+	cache.Put(Key("a"), "a", MakeResponse("r1", 10), now);
+	EXPECT_TRUE(Contains(cache.Get(Key("a"), now), "r1"));
+	EXPECT_TRUE(Contains(cache.Get(Key("a"), now + 9s), "r1"));
+
+	/* expired */
+	EXPECT_TRUE(cache.Get(Key("a"), now + 10s).empty());
+	EXPECT_TRUE(cache.Get(Key("a"), now).empty());
+}
+
+TEST(TranslationCache, LRU)
+{
+	const auto now = std::chrono::steady_clock::now();
+	TranslationCache cache{2};
+
+	cache.Put(Key("a"), "a", MakeResponse("ra", 60), now);
+	cache.Put(Key("b"), "b", MakeResponse("rb", 60), now);
+
+	/* use "a", so "b" is the least recently used one */
+	EXPECT_FALSE(cache.Get(Key("a"), now).empty());
+
+	cache.Put(Key("c"), "c", MakeResponse("rc", 60), now);
+	EXPECT_TRUE(Contains(cache.Get(Key("a"), now), "ra"));
+	EXPECT_TRUE(cache.Get(Key("b"), now).empty());
+	EXPECT_TRUE(Contains(cache.Get(Key("c"), now), "rc"));
+
+	/* replacing an item does not evict another one */
+	cache.Put(Key("c"), "c", MakeResponse("rc2", 60), now);
+	EXPECT_TRUE(Contains(cache.Get(Key("a"), now), "ra"));
+	EXPECT_TRUE(Contains(cache.Get(Key("c"), now), "rc2"));
+}
+
+TEST(TranslationCache, Key)
+{
+	const std::forward_list<std::string> args1{"x", "y"};
+	const std::forward_list<std::string> args2{"x", "z"};
+	const std::forward_list<std::string> args3{"x"};
+	const std::forward_list<std::string> args4{"x", ""};
+	static constexpr unsigned first[] = {1};
+	static constexpr unsigned second[] = {2};
+
+	/* plan name and listener tag are separated */
+	EXPECT_NE(Key("a"), Key("b"));
+	EXPECT_NE(Key("a"), Key("a", "tag"));
+	EXPECT_NE(Key("a", "b"), Key("ab"));
+
+	/* only the selected arguments are part of the key */
+	EXPECT_EQ(TranslationCache::MakeKey("a", nullptr, args1, first),
+		  TranslationCache::MakeKey("a", nullptr, args2, first));
+	EXPECT_NE(TranslationCache::MakeKey("a", nullptr, args1, second),
+		  TranslationCache::MakeKey("a", nullptr, args2, second));
+
+	/* a missing argument is not the same as an empty one */
+	EXPECT_NE(TranslationCache::MakeKey("a", nullptr, args3, second),
+		  TranslationCache::MakeKey("a", nullptr, args4, second));
+
+	const auto now = std::chrono::steady_clock::now();
+	TranslationCache cache{16};
+	cache.Put(Key("a"), "a", MakeResponse("ra", 60), now);
+	EXPECT_TRUE(cache.Get(Key("a", "tag"), now).empty());
+	EXPECT_TRUE(cache.Get(Key("b"), now).empty());
+}
+
+TEST(TranslationCache, InvalidatePlan)
+{
+	const auto now = std::chrono::steady_clock::now();
+	TranslationCache cache{16};
+
+	cache.Put(Key("a"), "a", MakeResponse("ra", 60), now);
+	cache.Put(Key("a", "tag"), "a", MakeResponse("ra2", 60), now);
+	cache.Put(Key("b"), "b", MakeResponse("rb", 60), now);
+
+	cache.InvalidatePlan("a");
+	EXPECT_TRUE(cache.Get(Key("a"), now).empty());
+	EXPECT_TRUE(cache.Get(Key("a", "tag"), now).empty());
+	EXPECT_FALSE(cache.Get(Key("b"), now).empty());
+
+	cache.Flush();
+	EXPECT_TRUE(cache.Get(Key("b"), now).empty());
+}
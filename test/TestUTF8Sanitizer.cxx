@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <max.kellermann@ionos.com>
+
+#include "UTF8Sanitizer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace std::string_view_literals;
+
+static std::string
+Sanitize(std::string_view src,
+	 UTF8Sanitizer::Mode mode=UTF8Sanitizer::Mode::UTF8)
+{
+	std::string result;
+	const auto append = [&result](std::string_view s){ result.append(s); };
+
+	UTF8Sanitizer sanitizer{mode};
+	sanitizer.Feed(src, append);
+	sanitizer.Finish(append);
+	return result;
+}
+
+/**
+ * Like Sanitize(), but feed one byte at a time.
+ */
+static std::string
+SanitizeBytewise(std::string_view src)
+{
+	std::string result;
+	const auto append = [&result](std::string_view s){ result.append(s); };
+
+	UTF8Sanitizer sanitizer;
+	for (const char ch : src)
+		sanitizer.Feed({&ch, 1}, append);
+	sanitizer.Finish(append);
+	return result;
+}
+
+TEST(UTF8Sanitizer, Valid)
+{
+	static constexpr std::string_view valid[] = {
+		""sv,
+		"foo\tbar\r\n"sv,
+		"\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80"sv,
+		"\xed\x9f\xbf\xee\x80\x80\xf4\x8f\xbf\xbf"sv,
+		/* long enough for the SIMD code paths */
+		"The quick brown fox jumps over the lazy dog.\n"
+		"Fix, Schwyz! quäkt Jürgen blöd vom Paß.\n"sv,
+	};
+
+	for (const auto i : valid) {
+		EXPECT_EQ(UTF8Sanitizer::FindInvalid(i, UTF8Sanitizer::Mode::UTF8),
+			  i.size());
+		EXPECT_EQ(Sanitize(i), i);
+		EXPECT_EQ(SanitizeBytewise(i), i);
+	}
+}
+
+TEST(UTF8Sanitizer, ControlCharacters)
+{
+	const std::string s = std::string(40, 'x') + "\x1b[1m\x7f" + std::string(40, 'y');
+	EXPECT_EQ(UTF8Sanitizer::FindInvalid(s, UTF8Sanitizer::Mode::UTF8), 40u);
+	EXPECT_EQ(Sanitize(s), std::string(40, 'x') + " [1m " + std::string(40, 'y'));
+
+	EXPECT_EQ(Sanitize("a\0b"sv), "a b");
+}
+
+TEST(UTF8Sanitizer, Invalid)
+{
+	/* stray continuation byte, invalid lead bytes */
+	EXPECT_EQ(Sanitize("a\x80z"sv), "a\xef\xbf\xbdz");
+	EXPECT_EQ(Sanitize("a\xc0\xafz"sv), "a\xef\xbf\xbd\xef\xbf\xbdz");
+	EXPECT_EQ(Sanitize("a\xffz"sv), "a\xef\xbf\xbdz");
+
+	/* overlong, surrogate, beyond U+10FFFF */
+	EXPECT_EQ(Sanitize("\xe0\x80\x80"sv),
+		  "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd");
+	EXPECT_EQ(Sanitize("\xed\xa0\x80"sv),
+		  "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd");
+	EXPECT_EQ(Sanitize("\xf4\x90\x80\x80"sv),
+		  "\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd");
+
+	/* a truncated sequence is replaced with just one U+FFFD */
+	EXPECT_EQ(Sanitize("\xe2\x82z"sv), "\xef\xbf\xbdz");
+	EXPECT_EQ(SanitizeBytewise("\xe2\x82z"sv), "\xef\xbf\xbdz");
+	EXPECT_EQ(SanitizeBytewise("\xf0\x9f\x98\xc3\xa4"sv),
+		  "\xef\xbf\xbd\xc3\xa4");
+
+	/* incomplete sequence at the end */
+	EXPECT_EQ(Sanitize("a\xf0\x9f"sv), "a\xef\xbf\xbd");
+}
+
+TEST(UTF8Sanitizer, Split)
+{
+	std::string result;
+	const auto append = [&result](std::string_view s){ result.append(s); };
+
+	UTF8Sanitizer sanitizer;
+	sanitizer.Feed("a\xf0\x9f"sv, append);
+	EXPECT_TRUE(sanitizer.HasPending());
+	EXPECT_EQ(result, "a");
+
+	sanitizer.Feed("\x98"sv, append);
+	sanitizer.Feed("\x80" "b"sv, append);
+	EXPECT_FALSE(sanitizer.HasPending());
+	EXPECT_EQ(result, "a\xf0\x9f\x98\x80" "b");
+}
+
+TEST(UTF8Sanitizer, ASCII)
+{
+	EXPECT_EQ(Sanitize("b\xc3\xa4r\x01\n"sv, UTF8Sanitizer::Mode::ASCII),
+		  "b  r \n");
+	EXPECT_EQ(UTF8Sanitizer::FindInvalid("b\xc3\xa4r"sv,
+					     UTF8Sanitizer::Mode::ASCII),
+		  1u);
+}